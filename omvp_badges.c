@@ -0,0 +1,164 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "omvp_badges.h"
+
+/* the health badge at the top right corner of a tile. */
+#define _OMVP_BADGES_SIZE 0.06f
+
+static void _omvp_badges_finalize(GObject *object);
+static void _omvp_badges_paint_node(ClutterActor *actor,
+  ClutterPaintNode *root);
+static gboolean _omvp_badges_get_paint_volume(ClutterActor *actor,
+  ClutterPaintVolume *volume);
+
+G_DEFINE_TYPE(OMVPBadges, omvp_badges, CLUTTER_TYPE_ACTOR)
+
+static void omvp_badges_class_init(OMVPBadgesClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS(klass);
+
+  gobject_class->finalize = _omvp_badges_finalize;
+  actor_class->paint_node = _omvp_badges_paint_node;
+  actor_class->get_paint_volume = _omvp_badges_get_paint_volume;
+}
+
+static void omvp_badges_init(OMVPBadges *badges) {
+  badges->min_x = 0;
+  badges->max_x = -1;
+  badges->min_y = 0;
+  badges->max_y = -1;
+}
+
+static void _omvp_badges_finalize(GObject *object) {
+  OMVPBadges *badges = OMVP_BADGES(object);
+
+  g_free(badges->colors);
+
+  G_OBJECT_CLASS(omvp_badges_parent_class)->finalize(object);
+}
+
+/*
+  The badges are a separate actor from the labels, so they stay on screen
+  while the labels are faded out.
+*/
+static void _omvp_badges_paint_node(ClutterActor *actor,
+  ClutterPaintNode *root) {
+  OMVPBadges *badges = OMVP_BADGES(actor);
+  ClutterPaintNode *node;
+  ClutterActorBox box;
+  ClutterColor color;
+  guint8 opacity;
+  gfloat offset, size;
+  gint vid_idx;
+  gint x, y;
+
+  if (badges->vids == NULL) {
+    return;
+  }
+
+  opacity = clutter_actor_get_paint_opacity(actor);
+  offset = badges->tile_size * (1.0f - badges->tile_scale) / 2.0f;
+  size = badges->tile_size * badges->tile_scale * _OMVP_BADGES_SIZE;
+
+  for (y = badges->min_y; y <= badges->max_y; y++) {
+    for (x = badges->min_x; x <= badges->max_x; x++) {
+      vid_idx = y * badges->num_per_row + x;
+      if (vid_idx >= badges->vids->num_vids) {
+        break;
+      }
+      color = badges->colors[vid_idx];
+      if (color.alpha == 0) {
+        continue;
+      }
+      color.alpha = color.alpha * opacity / 255;
+
+      box.x2 = (gfloat)(x + 1) * badges->tile_size - offset;
+      box.y1 = (gfloat)y * badges->tile_size + offset;
+      box.x1 = box.x2 - size;
+      box.y2 = box.y1 + size;
+
+      node = clutter_color_node_new(&color);
+      clutter_paint_node_set_name(node, "OMVP Badge");
+      clutter_paint_node_add_rectangle(node, &box);
+      clutter_paint_node_add_child(root, node);
+      clutter_paint_node_unref(node);
+    }
+  }
+}
+
+static gboolean _omvp_badges_get_paint_volume(ClutterActor *actor,
+  ClutterPaintVolume *volume) {
+
+  return clutter_paint_volume_set_from_allocation(volume, actor);
+}
+
+ClutterActor *omvp_badges_new(gfloat tile_size, gfloat tile_scale) {
+  OMVPBadges *badges;
+
+  badges = g_object_new(OMVP_TYPE_BADGES, NULL);
+  badges->tile_size = tile_size;
+  badges->tile_scale = tile_scale;
+
+  return CLUTTER_ACTOR(badges);
+}
+
+gint omvp_badges_set_vids(OMVPBadges *badges, OMVPVids *vids,
+  gint num_per_row) {
+
+  badges->vids = vids;
+  badges->num_per_row = num_per_row;
+  g_free(badges->colors);
+  badges->colors = NULL;
+  if (vids) {
+    badges->colors = g_new0(ClutterColor, vids->num_vids);
+  }
+  clutter_actor_queue_redraw(CLUTTER_ACTOR(badges));
+
+  return 0;
+}
+
+gint omvp_badges_set_window(OMVPBadges *badges, gint min_x, gint max_x,
+  gint min_y, gint max_y) {
+
+  badges->min_x = min_x;
+  badges->max_x = max_x;
+  badges->min_y = min_y;
+  badges->max_y = max_y;
+  clutter_actor_queue_redraw(CLUTTER_ACTOR(badges));
+
+  return 0;
+}
+
+/* a NULL color removes the badge of vid_idx. */
+gint omvp_badges_set_badge(OMVPBadges *badges, gint vid_idx,
+  const ClutterColor *color) {
+  static const ClutterColor none = {0, 0, 0, 0};
+
+  if (badges->vids == NULL || vid_idx < 0 ||
+    vid_idx >= badges->vids->num_vids) {
+    return -1;
+  }
+
+  badges->colors[vid_idx] = color ? *color : none;
+  clutter_actor_queue_redraw(CLUTTER_ACTOR(badges));
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_BADGES_H_
+#define _OMVP_BADGES_H_
+
+#include <clutter/clutter.h>
+#include "omvp_vids.h"
+
+#define OMVP_TYPE_BADGES (omvp_badges_get_type())
+#define OMVP_BADGES(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), OMVP_TYPE_BADGES, OMVPBadges))
+#define OMVP_BADGES_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), OMVP_TYPE_BADGES, OMVPBadgesClass))
+#define OMVP_IS_BADGES(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), OMVP_TYPE_BADGES))
+#define OMVP_IS_BADGES_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), OMVP_TYPE_BADGES))
+#define OMVP_BADGES_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), OMVP_TYPE_BADGES, OMVPBadgesClass))
+
+typedef struct _OMVPBadgesClass OMVPBadgesClass;
+typedef struct _OMVPBadges OMVPBadges;
+
+struct _OMVPBadgesClass {
+  ClutterActorClass parent_class;
+};
+
+struct _OMVPBadges {
+  ClutterActor parent_instance;
+
+  gfloat tile_size;
+  gfloat tile_scale;
+
+  OMVPVids *vids;
+  gint num_per_row;
+  ClutterColor *colors;
+
+  gint min_x;
+  gint max_x;
+  gint min_y;
+  gint max_y;
+};
+
+extern GType omvp_badges_get_type(void);
+extern ClutterActor *omvp_badges_new(gfloat tile_size, gfloat tile_scale);
+extern gint omvp_badges_set_vids(OMVPBadges *badges, OMVPVids *vids,
+  gint num_per_row);
+extern gint omvp_badges_set_window(OMVPBadges *badges, gint min_x,
+  gint max_x, gint min_y, gint max_y);
+extern gint omvp_badges_set_badge(OMVPBadges *badges, gint vid_idx,
+  const ClutterColor *color);
+
+#endif /* _OMVP_BADGES_H_ */
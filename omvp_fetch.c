@@ -0,0 +1,301 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include "config.h"
+#include "omvp_fetch.h"
+
+#define _OMVP_FETCH_GROUP "fetch"
+/* in seconds, so a cold start on a dead server doesn't hang the player. */
+#define _OMVP_FETCH_TIMEOUT 10
+
+typedef struct _OMVPFetchImpl {
+  SoupSession *session;
+  gchar *uri;
+  gchar *filename;
+  gchar *meta_filename;
+  gchar *etag;
+  gchar *last_modified;
+  gboolean is_fetching;
+  guint refresh_timeout_id;
+} OMVPFetchImpl;
+
+static gchar *_omvp_fetch_get_ext(const gchar *uri);
+static gint _omvp_fetch_load_meta(OMVPFetchImpl *fetch_impl);
+static gint _omvp_fetch_save_meta(OMVPFetchImpl *fetch_impl);
+static SoupMessage *_omvp_fetch_new_message(OMVPFetchImpl *fetch_impl);
+static gint _omvp_fetch_on_response(OMVPFetchImpl *fetch_impl,
+  SoupMessage *msg);
+static void _omvp_fetch_on_message(SoupSession *session, SoupMessage *msg,
+  gpointer user_data);
+static gboolean _omvp_fetch_refresh(gpointer user_data);
+
+/* the playlist parser picks the format by extension, so keep it. */
+static gchar *_omvp_fetch_get_ext(const gchar *uri) {
+  const gchar *path_end;
+  const gchar *ext;
+  const gchar *p;
+
+  path_end = uri + strcspn(uri, "?#");
+  ext = NULL;
+  for (p = uri; p < path_end; p++) {
+    if (*p == '.') {
+      ext = p + 1;
+    } else if (*p == '/') {
+      ext = NULL;
+    }
+  }
+  if (!ext || ext == path_end) {
+    return g_strdup("m3u");
+  }
+
+  return g_strndup(ext, path_end - ext);
+}
+
+static gint _omvp_fetch_load_meta(OMVPFetchImpl *fetch_impl) {
+  GKeyFile *key_file;
+  gchar *uri;
+
+  key_file = g_key_file_new();
+  if (!g_key_file_load_from_file(key_file, fetch_impl->meta_filename,
+    G_KEY_FILE_NONE, NULL)) {
+    g_key_file_free(key_file);
+    return -1;
+  }
+  uri = g_key_file_get_string(key_file, _OMVP_FETCH_GROUP, "uri", NULL);
+  if (uri && strcmp(uri, fetch_impl->uri) == 0) {
+    fetch_impl->etag = g_key_file_get_string(key_file, _OMVP_FETCH_GROUP,
+      "etag", NULL);
+    fetch_impl->last_modified = g_key_file_get_string(key_file,
+      _OMVP_FETCH_GROUP, "last-modified", NULL);
+  }
+  g_free(uri);
+  g_key_file_free(key_file);
+
+  return 0;
+}
+
+static gint _omvp_fetch_save_meta(OMVPFetchImpl *fetch_impl) {
+  GKeyFile *key_file;
+  gchar *data;
+  gsize len;
+
+  key_file = g_key_file_new();
+  g_key_file_set_string(key_file, _OMVP_FETCH_GROUP, "uri", fetch_impl->uri);
+  if (fetch_impl->etag) {
+    g_key_file_set_string(key_file, _OMVP_FETCH_GROUP, "etag",
+      fetch_impl->etag);
+  }
+  if (fetch_impl->last_modified) {
+    g_key_file_set_string(key_file, _OMVP_FETCH_GROUP, "last-modified",
+      fetch_impl->last_modified);
+  }
+  data = g_key_file_to_data(key_file, &len, NULL);
+  g_file_set_contents(fetch_impl->meta_filename, data, len, NULL);
+  g_free(data);
+  g_key_file_free(key_file);
+
+  return 0;
+}
+
+static SoupMessage *_omvp_fetch_new_message(OMVPFetchImpl *fetch_impl) {
+  SoupMessage *msg;
+
+  msg = soup_message_new("GET", fetch_impl->uri);
+  if (!msg) {
+    return NULL;
+  }
+  if (fetch_impl->etag) {
+    soup_message_headers_append(msg->request_headers, "If-None-Match",
+      fetch_impl->etag);
+  }
+  if (fetch_impl->last_modified) {
+    soup_message_headers_append(msg->request_headers, "If-Modified-Since",
+      fetch_impl->last_modified);
+  }
+
+  return msg;
+}
+
+/*
+  A changed playlist replaces the cache file atomically, and the playlist
+  file monitor of the player picks it up from there.
+*/
+static gint _omvp_fetch_on_response(OMVPFetchImpl *fetch_impl,
+  SoupMessage *msg) {
+  const gchar *value;
+  GError *error = NULL;
+
+  g_debug("omvp_fetch uri(%s) status(%u)", fetch_impl->uri,
+    msg->status_code);
+
+  if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+    return 0;
+  }
+  if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) ||
+    msg->response_body->length <= 0) {
+    return -1;
+  }
+
+  if (!g_file_set_contents(fetch_impl->filename, msg->response_body->data,
+    msg->response_body->length, &error)) {
+    g_debug("omvp_fetch can't write %s: %s", fetch_impl->filename,
+      error->message);
+    g_error_free(error);
+    return -1;
+  }
+
+  g_free(fetch_impl->etag);
+  g_free(fetch_impl->last_modified);
+  value = soup_message_headers_get_one(msg->response_headers, "ETag");
+  fetch_impl->etag = g_strdup(value);
+  value = soup_message_headers_get_one(msg->response_headers,
+    "Last-Modified");
+  fetch_impl->last_modified = g_strdup(value);
+  _omvp_fetch_save_meta(fetch_impl);
+
+  return 0;
+}
+
+static void _omvp_fetch_on_message(SoupSession *session, SoupMessage *msg,
+  gpointer user_data) {
+  OMVPFetchImpl *fetch_impl;
+
+  (void)session;
+
+  if (msg->status_code == SOUP_STATUS_CANCELLED) {
+    return;
+  }
+
+  fetch_impl = (OMVPFetchImpl *)user_data;
+  fetch_impl->is_fetching = FALSE;
+  _omvp_fetch_on_response(fetch_impl, msg);
+}
+
+static gboolean _omvp_fetch_refresh(gpointer user_data) {
+  OMVPFetchImpl *fetch_impl;
+  SoupMessage *msg;
+
+  fetch_impl = (OMVPFetchImpl *)user_data;
+  if (fetch_impl->is_fetching) {
+    return TRUE;
+  }
+
+  msg = _omvp_fetch_new_message(fetch_impl);
+  if (msg) {
+    fetch_impl->is_fetching = TRUE;
+    soup_session_queue_message(fetch_impl->session, msg,
+      _omvp_fetch_on_message, fetch_impl);
+  }
+
+  return TRUE;
+}
+
+gboolean omvp_fetch_is_remote(const gchar *uri) {
+  return g_ascii_strncasecmp(uri, "http://", 7) == 0 ||
+    g_ascii_strncasecmp(uri, "https://", 8) == 0;
+}
+
+/*
+  Keeps a copy of a remote playlist in the user cache directory. The cached
+  copy is used right away when it exists, and is otherwise fetched before
+  returning, for at most _OMVP_FETCH_TIMEOUT seconds. It is refreshed with
+  conditional requests every refresh_interval seconds.
+*/
+OMVPFetch omvp_fetch_open(const gchar *uri, gint refresh_interval) {
+  OMVPFetchImpl *fetch_impl;
+  SoupMessage *msg;
+  gchar *dirname;
+  gchar *checksum;
+  gchar *ext;
+  gchar *basename;
+
+  fetch_impl = g_malloc0(sizeof(OMVPFetchImpl));
+  fetch_impl->uri = g_strdup(uri);
+  fetch_impl->session = soup_session_new_with_options(
+    SOUP_SESSION_USER_AGENT, PACKAGE_STRING,
+    SOUP_SESSION_TIMEOUT, _OMVP_FETCH_TIMEOUT, NULL);
+
+  dirname = g_build_filename(g_get_user_cache_dir(), PACKAGE, NULL);
+  g_mkdir_with_parents(dirname, 0700);
+  checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, uri, -1);
+  ext = _omvp_fetch_get_ext(uri);
+  basename = g_strdup_printf("%s.%s", checksum, ext);
+  fetch_impl->filename = g_build_filename(dirname, basename, NULL);
+  fetch_impl->meta_filename = g_strdup_printf("%s.meta",
+    fetch_impl->filename);
+  g_free(basename);
+  g_free(ext);
+  g_free(checksum);
+  g_free(dirname);
+
+  if (g_file_test(fetch_impl->filename, G_FILE_TEST_EXISTS)) {
+    _omvp_fetch_load_meta(fetch_impl);
+    _omvp_fetch_refresh(fetch_impl);
+  } else {
+    msg = _omvp_fetch_new_message(fetch_impl);
+    if (msg) {
+      soup_session_send_message(fetch_impl->session, msg);
+      _omvp_fetch_on_response(fetch_impl, msg);
+      g_object_unref(msg);
+    }
+  }
+
+  if (refresh_interval > 0) {
+    fetch_impl->refresh_timeout_id = g_timeout_add_seconds(refresh_interval,
+      _omvp_fetch_refresh, fetch_impl);
+  }
+
+  g_debug("omvp_fetch_open uri(%s) filename(%s)", uri, fetch_impl->filename);
+
+  return (OMVPFetch)fetch_impl;
+}
+
+gint omvp_fetch_close(OMVPFetch fetch) {
+  OMVPFetchImpl *fetch_impl;
+
+  fetch_impl = (OMVPFetchImpl *)fetch;
+  if (fetch_impl) {
+    if (fetch_impl->refresh_timeout_id) {
+      g_source_remove(fetch_impl->refresh_timeout_id);
+    }
+    soup_session_abort(fetch_impl->session);
+    g_object_unref(fetch_impl->session);
+    g_free(fetch_impl->uri);
+    g_free(fetch_impl->filename);
+    g_free(fetch_impl->meta_filename);
+    g_free(fetch_impl->etag);
+    g_free(fetch_impl->last_modified);
+    g_free(fetch_impl);
+  }
+
+  return 0;
+}
+
+const gchar *omvp_fetch_get_filename(OMVPFetch fetch) {
+  OMVPFetchImpl *fetch_impl;
+
+  g_assert(fetch);
+  fetch_impl = (OMVPFetchImpl *)fetch;
+
+  return fetch_impl->filename;
+}
@@ -0,0 +1,274 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <libsoup/soup.h>
+#include "config.h"
+#include "omvp_fetch.h"
+#include "omvp_test_util.h"
+
+#define _OMVP_FETCH_TEST_LAST_MODIFIED "Mon, 17 Oct 2016 00:00:00 GMT"
+
+/* the server runs in its own thread, so the state is shared under a lock. */
+typedef struct _OMVPFetchTestServer {
+  GMutex lock;
+  OMVPTestUtilServer server;
+  gchar *uri;
+  gchar *body;
+  gchar *etag;
+  gint num_requests;
+  gint num_not_modified;
+  gchar *if_none_match;
+  gchar *if_modified_since;
+} OMVPFetchTestServer;
+
+typedef struct _OMVPFetchTestContents {
+  const gchar *filename;
+  const gchar *contents;
+} OMVPFetchTestContents;
+
+static OMVPFetchTestServer _omvp_fetch_test_server;
+static gchar *_omvp_fetch_test_dir;
+
+static void _omvp_fetch_test_on_request(SoupServer *server, SoupMessage *msg,
+  const char *path, GHashTable *query, SoupClientContext *client,
+  gpointer user_data);
+static gint _omvp_fetch_test_server_start(void);
+static gint _omvp_fetch_test_server_stop(void);
+static gint _omvp_fetch_test_set_body(const gchar *body, const gchar *etag);
+static gint _omvp_fetch_test_get_num_requests(void);
+static gboolean _omvp_fetch_test_has_requests(gpointer user_data);
+static gboolean _omvp_fetch_test_has_contents(gpointer user_data);
+static gboolean _omvp_fetch_test_wait_requests(gint num_requests);
+static gboolean _omvp_fetch_test_wait_contents(const gchar *filename,
+  const gchar *contents);
+static gint _omvp_fetch_test_remove(const gchar *filename);
+static void _omvp_fetch_test_refresh(void);
+
+static void _omvp_fetch_test_on_request(SoupServer *server, SoupMessage *msg,
+  const char *path, GHashTable *query, SoupClientContext *client,
+  gpointer user_data) {
+  OMVPFetchTestServer *test_server;
+  const gchar *if_none_match;
+
+  (void)server;
+  (void)path;
+  (void)query;
+  (void)client;
+
+  test_server = (OMVPFetchTestServer *)user_data;
+
+  g_mutex_lock(&test_server->lock);
+  test_server->num_requests++;
+  if_none_match = soup_message_headers_get_one(msg->request_headers,
+    "If-None-Match");
+  g_free(test_server->if_none_match);
+  test_server->if_none_match = g_strdup(if_none_match);
+  g_free(test_server->if_modified_since);
+  test_server->if_modified_since = g_strdup(soup_message_headers_get_one(
+    msg->request_headers, "If-Modified-Since"));
+
+  soup_message_headers_replace(msg->response_headers, "ETag",
+    test_server->etag);
+  soup_message_headers_replace(msg->response_headers, "Last-Modified",
+    _OMVP_FETCH_TEST_LAST_MODIFIED);
+  if (g_strcmp0(if_none_match, test_server->etag) == 0) {
+    test_server->num_not_modified++;
+    soup_message_set_status(msg, SOUP_STATUS_NOT_MODIFIED);
+  } else {
+    soup_message_set_status(msg, SOUP_STATUS_OK);
+    soup_message_set_response(msg, "audio/x-mpegurl", SOUP_MEMORY_COPY,
+      test_server->body, strlen(test_server->body));
+  }
+  g_mutex_unlock(&test_server->lock);
+}
+
+/* omvp_fetch_open() blocks the main thread on the first request. */
+static gint _omvp_fetch_test_server_start(void) {
+  OMVPFetchTestServer *test_server;
+
+  test_server = &_omvp_fetch_test_server;
+  g_mutex_init(&test_server->lock);
+  test_server->server = omvp_test_util_server_open(
+    _omvp_fetch_test_on_request, test_server);
+  test_server->uri = omvp_test_util_server_get_uri(test_server->server,
+    "/omvp.m3u");
+
+  return 0;
+}
+
+static gint _omvp_fetch_test_server_stop(void) {
+  OMVPFetchTestServer *test_server;
+
+  test_server = &_omvp_fetch_test_server;
+  omvp_test_util_server_close(test_server->server);
+  g_free(test_server->uri);
+  g_free(test_server->body);
+  g_free(test_server->etag);
+  g_free(test_server->if_none_match);
+  g_free(test_server->if_modified_since);
+  g_mutex_clear(&test_server->lock);
+
+  return 0;
+}
+
+static gint _omvp_fetch_test_set_body(const gchar *body, const gchar *etag) {
+  OMVPFetchTestServer *test_server;
+
+  test_server = &_omvp_fetch_test_server;
+  g_mutex_lock(&test_server->lock);
+  g_free(test_server->body);
+  test_server->body = g_strdup(body);
+  g_free(test_server->etag);
+  test_server->etag = g_strdup(etag);
+  g_mutex_unlock(&test_server->lock);
+
+  return 0;
+}
+
+static gint _omvp_fetch_test_get_num_requests(void) {
+  OMVPFetchTestServer *test_server;
+  gint num_requests;
+
+  test_server = &_omvp_fetch_test_server;
+  g_mutex_lock(&test_server->lock);
+  num_requests = test_server->num_requests;
+  g_mutex_unlock(&test_server->lock);
+
+  return num_requests;
+}
+
+static gboolean _omvp_fetch_test_has_requests(gpointer user_data) {
+  return _omvp_fetch_test_get_num_requests() >= GPOINTER_TO_INT(user_data);
+}
+
+static gboolean _omvp_fetch_test_has_contents(gpointer user_data) {
+  OMVPFetchTestContents *contents;
+  gchar *data;
+  gboolean ok;
+
+  contents = (OMVPFetchTestContents *)user_data;
+  data = NULL;
+  g_file_get_contents(contents->filename, &data, NULL, NULL);
+  ok = g_strcmp0(data, contents->contents) == 0;
+  g_free(data);
+
+  return ok;
+}
+
+static gboolean _omvp_fetch_test_wait_requests(gint num_requests) {
+  return omvp_test_util_wait(_omvp_fetch_test_has_requests,
+    GINT_TO_POINTER(num_requests));
+}
+
+static gboolean _omvp_fetch_test_wait_contents(const gchar *filename,
+  const gchar *contents) {
+  OMVPFetchTestContents test_contents;
+
+  test_contents.filename = filename;
+  test_contents.contents = contents;
+
+  return omvp_test_util_wait(_omvp_fetch_test_has_contents,
+    &test_contents);
+}
+
+static gint _omvp_fetch_test_remove(const gchar *filename) {
+  gchar *meta_filename;
+
+  meta_filename = g_strdup_printf("%s.meta", filename);
+  g_unlink(meta_filename);
+  g_unlink(filename);
+  g_free(meta_filename);
+
+  return 0;
+}
+
+/*
+  A cold start fetches the playlist before returning. A warm start sends a
+  conditional request and keeps the cache on 304, and a changed playlist
+  replaces the cache.
+*/
+static void _omvp_fetch_test_refresh(void) {
+  OMVPFetchTestServer *test_server;
+  OMVPFetch fetch;
+  gchar *filename;
+  gchar *data;
+  gboolean ok;
+
+  test_server = &_omvp_fetch_test_server;
+  _omvp_fetch_test_set_body("#EXTM3U\n#EXTINF:1,One\nudp://@239.0.0.1:1234\n",
+    "\"1\"");
+
+  fetch = omvp_fetch_open(test_server->uri, 0);
+  g_assert(fetch);
+  filename = g_strdup(omvp_fetch_get_filename(fetch));
+  g_assert_cmpint(_omvp_fetch_test_get_num_requests(), ==, 1);
+  ok = g_file_get_contents(filename, &data, NULL, NULL);
+  g_assert(ok);
+  g_assert_cmpstr(data, ==, test_server->body);
+  g_free(data);
+  omvp_fetch_close(fetch);
+
+  fetch = omvp_fetch_open(test_server->uri, 0);
+  ok = _omvp_fetch_test_wait_requests(2);
+  g_assert(ok);
+  g_mutex_lock(&test_server->lock);
+  g_assert_cmpstr(test_server->if_none_match, ==, "\"1\"");
+  g_assert_cmpstr(test_server->if_modified_since, ==,
+    _OMVP_FETCH_TEST_LAST_MODIFIED);
+  g_assert_cmpint(test_server->num_not_modified, ==, 1);
+  g_mutex_unlock(&test_server->lock);
+  omvp_fetch_close(fetch);
+
+  _omvp_fetch_test_set_body("#EXTM3U\n#EXTINF:2,Two\nudp://@239.0.0.2:1234\n",
+    "\"2\"");
+  fetch = omvp_fetch_open(test_server->uri, 0);
+  ok = _omvp_fetch_test_wait_contents(filename, test_server->body);
+  g_assert(ok);
+  omvp_fetch_close(fetch);
+  _omvp_fetch_test_remove(filename);
+  g_free(filename);
+}
+
+int main(int argc, char *argv[]) {
+  gchar *dirname;
+  gint ret;
+
+  g_test_init(&argc, &argv, NULL);
+
+  /* the cache goes to a scratch directory instead of the user's. */
+  _omvp_fetch_test_dir = g_dir_make_tmp("omvp_fetch_test-XXXXXX", NULL);
+  g_assert(_omvp_fetch_test_dir);
+  g_setenv("XDG_CACHE_HOME", _omvp_fetch_test_dir, TRUE);
+
+  _omvp_fetch_test_server_start();
+  g_test_add_func("/fetch/refresh", _omvp_fetch_test_refresh);
+  ret = g_test_run();
+  _omvp_fetch_test_server_stop();
+
+  dirname = g_build_filename(_omvp_fetch_test_dir, PACKAGE, NULL);
+  g_rmdir(dirname);
+  g_free(dirname);
+  g_rmdir(_omvp_fetch_test_dir);
+  g_free(_omvp_fetch_test_dir);
+
+  return ret;
+}
@@ -19,7 +19,24 @@
 */
 
 #include <string.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
 #include "omvp_gst.h"
+#include "omvp_hls.h"
+
+/* how often the source element of a focus video posts its stats, in ms. */
+#define _OMVP_GST_STATS_INTERVAL 1000
+#define _OMVP_GST_DISPLAY_KEY "omvp-gst-display"
+
+/*
+  The clutter-gst sink of a tile. It stays with the tile across pipelines
+  and is fed from the main thread, so the last frame stays on screen.
+*/
+typedef struct _OMVPGstDisplay {
+  GstElement *sink;
+  GstPad *pad;
+  GstCaps *caps;
+} OMVPGstDisplay;
 
 typedef struct _OMVPGstImpl {
   GstElement *play;
@@ -27,18 +44,467 @@ typedef struct _OMVPGstImpl {
   gchar *video_caps_str;
   gchar *audio_tags_str;
   gchar *video_tags_str;
+  gpointer audio_caps_pending;
+  gpointer video_caps_pending;
+  gint num_audio;
+  gint current_audio;
+  gint num_bytes;
+  GstStructure *source_stats;
   guint bus_watch_id;
-  gpointer instance;
-  gulong handler_id;
+  gpointer texture;
   gdouble volume;
   gboolean mute;
   OMVPGstCallback callback;
   gpointer callback_data;
+  gpointer frame_mailbox;
+  gint num_frames;
+  gint num_buffers;
+  gint num_dropped_frames;
+  gint is_frame_pending;
+  gboolean scan;
+  gboolean throttle;
+  gint throttle_epoch;
+  gint start_bitrate;
+  gpointer hls_demux;
+  GstElement *thumbnail_src;
+  OMVPHlsRequest thumbnail_request;
 } OMVPGstImpl;
 
+static gint _omvp_gst_throttle_enabled;
+static gint _omvp_gst_throttle_epoch;
+/*
+  The pipelines with a new frame in their mailbox, in arrival order. One
+  source shared by all pipelines wakes the main loop at most once per
+  iteration however many frames arrived.
+*/
+static GMutex _omvp_gst_pending_lock;
+static GQueue _omvp_gst_pending = G_QUEUE_INIT;
+static GSource *_omvp_gst_frame_source;
+
+static void _omvp_gst_display_free(gpointer data);
+static OMVPGstDisplay *_omvp_gst_get_display(ClutterActor *texture);
+static GstFlowReturn _omvp_gst_on_new_sample(GstAppSink *sink,
+  gpointer user_data);
+static void _omvp_gst_show_frame(OMVPGstImpl *gst_impl, GstSample *sample);
+static gboolean _omvp_gst_frame_source_dispatch(GSource *source,
+  GSourceFunc callback, gpointer user_data);
+static gboolean _omvp_gst_on_frames(gpointer user_data);
+static gchar *_omvp_gst_exchange_str(gpointer *slot, gchar *str);
+static void _omvp_gst_on_caps_notify(GObject *pad, GParamSpec *pspec,
+  gpointer user_data);
+static void _omvp_gst_on_audio_changed(GstElement *play, gpointer user_data);
+static GstPadProbeReturn _omvp_gst_byte_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer user_data);
+static GstPadProbeReturn _omvp_gst_buffer_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer user_data);
+static void _omvp_gst_on_source_pad_added(GstElement *source, GstPad *pad,
+  gpointer user_data);
+static void _omvp_gst_on_source_setup(GstElement *play, GstElement *source,
+  gpointer user_data);
+static void _omvp_gst_on_deep_element_added(GstBin *bin, GstBin *sub_bin,
+  GstElement *element, gpointer user_data);
+static void _omvp_gst_release_hls_demux(OMVPGstImpl *gst_impl,
+  gboolean adapt);
+static void _omvp_gst_on_decode_pad_added(GstElement *decode, GstPad *pad,
+  gpointer user_data);
+static void _omvp_gst_on_thumbnail(GBytes *data, gpointer user_data);
 static gboolean _omvp_gst_bus_callback(
   GstBus *bus, GstMessage *message, gpointer data);
-static void _omvp_gst_on_new_frame(gpointer priv, gpointer user_data);
+
+static GSourceFuncs _omvp_gst_frame_source_funcs = {
+  NULL, NULL, _omvp_gst_frame_source_dispatch, NULL, NULL, NULL
+};
+
+static void _omvp_gst_display_free(gpointer data) {
+  OMVPGstDisplay *display;
+
+  display = (OMVPGstDisplay *)data;
+  gst_element_set_state(display->sink, GST_STATE_NULL);
+  gst_object_unref(GST_OBJECT(display->pad));
+  gst_object_unref(GST_OBJECT(display->sink));
+  if (display->caps) {
+    gst_caps_unref(display->caps);
+  }
+  g_free(display);
+}
+
+/*
+  The sink runs outside of any pipeline, without clock sync, and uploads
+  the frames it is given to the GPU like it did at the end of a pipeline.
+*/
+static OMVPGstDisplay *_omvp_gst_get_display(ClutterActor *texture) {
+  OMVPGstDisplay *display;
+  GstSegment segment;
+
+  display = g_object_get_data(G_OBJECT(texture), _OMVP_GST_DISPLAY_KEY);
+  if (display) {
+    return display;
+  }
+
+  display = g_malloc0(sizeof(OMVPGstDisplay));
+#if CLUTTER_GST_MAJOR_VERSION > 2
+  {
+    ClutterGstVideoSink *gst_video_sink;
+    ClutterContent *content;
+    gst_video_sink = clutter_gst_video_sink_new();
+    content = clutter_gst_content_new_with_sink(gst_video_sink);
+    clutter_actor_set_content(texture, content);
+    display->sink = GST_ELEMENT(gst_video_sink);
+  }
+#else
+  display->sink = gst_element_factory_make("cluttersink", NULL);
+  g_object_set(display->sink, "texture", texture, NULL);
+#endif
+  gst_object_ref_sink(display->sink);
+  g_object_set(display->sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_element_set_state(display->sink, GST_STATE_PLAYING);
+  display->pad = gst_element_get_static_pad(display->sink, "sink");
+  gst_pad_send_event(display->pad, gst_event_new_stream_start("omvp"));
+  gst_segment_init(&segment, GST_FORMAT_TIME);
+  gst_pad_send_event(display->pad, gst_event_new_segment(&segment));
+  g_object_set_data_full(G_OBJECT(texture), _OMVP_GST_DISPLAY_KEY, display,
+    _omvp_gst_display_free);
+
+  return display;
+}
+
+/*
+  Every pipeline owns a single-slot mailbox that the appsink fills from the
+  streaming thread. The slot always holds the newest frame, and a frame
+  that is replaced before a paint takes it is counted as dropped, so stale
+  frames never queue in front of the sink of the tile. The appsink takes
+  the formats of that sink, so the frames are not converted on the CPU.
+*/
+static GstFlowReturn _omvp_gst_on_new_sample(GstAppSink *sink,
+  gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  GstSample *sample;
+  GstSample *old_sample;
+
+  gst_impl = (OMVPGstImpl *)user_data;
+  sample = gst_app_sink_pull_sample(sink);
+  if (!sample) {
+    return GST_FLOW_OK;
+  }
+
+  /* a throttled pipeline passes at most one frame per throttle epoch. */
+  if (gst_impl->throttle && g_atomic_int_get(&_omvp_gst_throttle_enabled)) {
+    gint throttle_epoch;
+    throttle_epoch = g_atomic_int_get(&_omvp_gst_throttle_epoch);
+    if (gst_impl->throttle_epoch == throttle_epoch) {
+      gst_sample_unref(sample);
+      g_atomic_int_inc(&gst_impl->num_dropped_frames);
+      return GST_FLOW_OK;
+    }
+    gst_impl->throttle_epoch = throttle_epoch;
+  }
+
+  old_sample = g_atomic_pointer_exchange(&gst_impl->frame_mailbox, sample);
+  if (old_sample) {
+    gst_sample_unref(old_sample);
+    g_atomic_int_inc(&gst_impl->num_dropped_frames);
+  }
+  if (g_atomic_int_compare_and_exchange(&gst_impl->is_frame_pending, 0, 1)) {
+    g_mutex_lock(&_omvp_gst_pending_lock);
+    g_queue_push_tail(&_omvp_gst_pending, gst_impl);
+    g_mutex_unlock(&_omvp_gst_pending_lock);
+    g_source_set_ready_time(_omvp_gst_frame_source, 0);
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* a new caps event is followed by the segment again, in sticky order. */
+static void _omvp_gst_show_frame(OMVPGstImpl *gst_impl, GstSample *sample) {
+  OMVPGstDisplay *display;
+  GstSegment segment;
+  GstCaps *caps;
+  GstFlowReturn ret;
+
+  if (!gst_impl->texture) {
+    return;
+  }
+  display = _omvp_gst_get_display(CLUTTER_ACTOR(gst_impl->texture));
+  caps = gst_sample_get_caps(sample);
+  if (caps && (!display->caps || !gst_caps_is_equal(caps, display->caps))) {
+    gst_caps_replace(&display->caps, caps);
+    gst_pad_send_event(display->pad, gst_event_new_caps(caps));
+    gst_segment_init(&segment, GST_FORMAT_TIME);
+    gst_pad_send_event(display->pad, gst_event_new_segment(&segment));
+  }
+  ret = gst_pad_chain(display->pad,
+    gst_buffer_ref(gst_sample_get_buffer(sample)));
+  if (ret != GST_FLOW_OK) {
+    g_debug("omvp_gst show gst(%p) |%s|", (void *)gst_impl,
+      gst_flow_get_name(ret));
+  }
+}
+
+static gboolean _omvp_gst_frame_source_dispatch(GSource *source,
+  GSourceFunc callback, gpointer user_data) {
+
+  g_source_set_ready_time(source, -1);
+
+  if (!callback) {
+    return FALSE;
+  }
+
+  return callback(user_data);
+}
+
+/*
+  Wakes the stage for the pipelines with a new frame. The frames themselves
+  are taken and announced by omvp_gst_update_frames() when it is painted.
+*/
+static gboolean _omvp_gst_on_frames(gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  ClutterActor *texture;
+  ClutterActor *stage;
+  GList *link;
+
+  (void)user_data;
+
+  stage = NULL;
+  g_mutex_lock(&_omvp_gst_pending_lock);
+  for (link = _omvp_gst_pending.head; link; link = link->next) {
+    gst_impl = (OMVPGstImpl *)link->data;
+    texture = gst_impl->texture;
+    if (!texture) {
+      continue;
+    }
+    if (CLUTTER_ACTOR_IS_MAPPED(texture)) {
+      clutter_actor_queue_redraw(texture);
+    } else if (!stage) {
+      /* the frame still has to be taken, so the stage paints anyway. */
+      stage = clutter_actor_get_stage(texture);
+    }
+  }
+  g_mutex_unlock(&_omvp_gst_pending_lock);
+  if (stage) {
+    clutter_actor_queue_redraw(stage);
+  }
+
+  return TRUE;
+}
+
+/*
+  Stream state used by the debug text is pushed from the streaming threads
+  when it changes, so reading it never queries the pipeline. A new caps
+  string is parked in a pending slot until the main thread picks it up.
+*/
+static gchar *_omvp_gst_exchange_str(gpointer *slot, gchar *str) {
+
+  return (gchar *)g_atomic_pointer_exchange(slot, str);
+}
+
+static void _omvp_gst_on_caps_notify(GObject *pad, GParamSpec *pspec,
+  gpointer user_data) {
+  GstCaps *caps;
+  gchar *str;
+
+  (void)pspec;
+
+  caps = gst_pad_get_current_caps(GST_PAD(pad));
+  if (!caps) {
+    return;
+  }
+  str = gst_caps_to_string(caps);
+  gst_caps_unref(caps);
+  g_free(_omvp_gst_exchange_str((gpointer *)user_data, str));
+}
+
+static void _omvp_gst_on_audio_changed(GstElement *play, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  gint num_audio;
+  gint current_audio;
+
+  gst_impl = (OMVPGstImpl *)user_data;
+  g_object_get(play, "n-audio", &num_audio,
+    "current-audio", &current_audio, NULL);
+  g_atomic_int_set(&gst_impl->num_audio, num_audio);
+  g_atomic_int_set(&gst_impl->current_audio, current_audio);
+}
+
+static GstPadProbeReturn _omvp_gst_byte_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  gsize size;
+
+  (void)pad;
+
+  gst_impl = (OMVPGstImpl *)user_data;
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list;
+    guint i, len;
+    list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+    len = gst_buffer_list_length(list);
+    size = 0;
+    for (i = 0; i < len; i++) {
+      size += gst_buffer_get_size(gst_buffer_list_get(list, i));
+    }
+  } else {
+    size = gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info));
+  }
+  g_atomic_int_add(&gst_impl->num_bytes, (gint)size);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* counts the decoded frames whether the stage paints them or not. */
+static GstPadProbeReturn _omvp_gst_buffer_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+
+  (void)pad;
+  (void)info;
+  gst_impl = (OMVPGstImpl *)user_data;
+  g_atomic_int_inc(&gst_impl->num_buffers);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void _omvp_gst_on_source_pad_added(GstElement *source, GstPad *pad,
+  gpointer user_data) {
+
+  (void)source;
+
+  if (GST_PAD_IS_SRC(pad)) {
+    gst_pad_add_probe(pad,
+      GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
+      _omvp_gst_byte_probe, user_data, NULL);
+  }
+}
+
+static void _omvp_gst_on_source_setup(GstElement *play, GstElement *source,
+  gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  GstPad *pad;
+
+  (void)play;
+  gst_impl = (OMVPGstImpl *)user_data;
+
+  /* a scan video only needs a snapshot, as soon as possible. */
+  if (gst_impl->scan && g_object_class_find_property(
+    G_OBJECT_GET_CLASS(source), "adaptive-latency")) {
+    guint min_latency;
+    g_object_get(G_OBJECT(source), "min-latency", &min_latency, NULL);
+    g_object_set(G_OBJECT(source),
+      "adaptive-latency", FALSE,
+      "latency", min_latency,
+      NULL);
+  }
+
+  /* only the focus video shows its receive rate and source stats. */
+  if (gst_impl->scan) {
+    return;
+  }
+  if (g_object_class_find_property(G_OBJECT_GET_CLASS(source),
+    "stats-interval")) {
+    g_object_set(G_OBJECT(source), "stats-interval", _OMVP_GST_STATS_INTERVAL,
+      NULL);
+  }
+  pad = gst_element_get_static_pad(source, "src");
+  if (pad) {
+    _omvp_gst_on_source_pad_added(source, pad, user_data);
+    gst_object_unref(GST_OBJECT(pad));
+  } else {
+    g_signal_connect(source, "pad-added",
+      G_CALLBACK(_omvp_gst_on_source_pad_added), user_data);
+  }
+}
+
+/*
+  A focus video starts on a low HLS variant and lets the demuxer move up.
+  hlsdemux2 has a start bitrate for that. The older hlsdemux is held at the
+  variant by its connection speed until the first frame.
+*/
+static void _omvp_gst_on_deep_element_added(GstBin *bin, GstBin *sub_bin,
+  GstElement *element, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  GstElementFactory *factory;
+
+  (void)bin;
+  (void)sub_bin;
+  gst_impl = (OMVPGstImpl *)user_data;
+
+  factory = gst_element_get_factory(element);
+  if (!factory ||
+    !g_str_has_prefix(GST_OBJECT_NAME(factory), "hlsdemux")) {
+    return;
+  }
+  if (g_object_class_find_property(G_OBJECT_GET_CLASS(element),
+    "start-bitrate")) {
+    g_object_set(G_OBJECT(element),
+      "start-bitrate", (guint)gst_impl->start_bitrate, NULL);
+  } else if (g_object_class_find_property(G_OBJECT_GET_CLASS(element),
+    "connection-speed")) {
+    g_object_set(G_OBJECT(element),
+      "connection-speed", (guint)(gst_impl->start_bitrate / 1000 + 1), NULL);
+    if (!g_atomic_pointer_compare_and_exchange(&gst_impl->hls_demux, NULL,
+      element)) {
+      return;
+    }
+    gst_object_ref(element);
+  }
+}
+
+static void _omvp_gst_release_hls_demux(OMVPGstImpl *gst_impl,
+  gboolean adapt) {
+  gpointer element;
+
+  element = g_atomic_pointer_exchange(&gst_impl->hls_demux, NULL);
+  if (!element) {
+    return;
+  }
+  if (adapt) {
+    g_object_set(G_OBJECT(element), "connection-speed", 0u, NULL);
+  }
+  gst_object_unref(element);
+}
+
+static void _omvp_gst_on_decode_pad_added(GstElement *decode, GstPad *pad,
+  gpointer user_data) {
+  GstCaps *caps;
+  GstPad *sinkpad;
+
+  (void)decode;
+
+  caps = gst_pad_get_current_caps(pad);
+  if (!caps) {
+    return;
+  }
+  if (g_str_has_prefix(
+    gst_structure_get_name(gst_caps_get_structure(caps, 0)), "video/")) {
+    sinkpad = gst_element_get_static_pad(GST_ELEMENT(user_data), "sink");
+    if (!gst_pad_is_linked(sinkpad)) {
+      gst_pad_link(pad, sinkpad);
+    }
+    gst_object_unref(sinkpad);
+  }
+  gst_caps_unref(caps);
+}
+
+/* the keyframe is decoded as a whole stream of its own. */
+static void _omvp_gst_on_thumbnail(GBytes *data, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+  GstBuffer *buffer;
+  gsize size;
+
+  gst_impl = (OMVPGstImpl *)user_data;
+  gst_impl->thumbnail_request = NULL;
+  if (!data) {
+    GST_ELEMENT_ERROR(gst_impl->thumbnail_src, RESOURCE, READ,
+      ("failed to fetch the keyframe"), (NULL));
+    return;
+  }
+  size = g_bytes_get_size(data);
+  buffer = gst_buffer_new_wrapped_full(GST_MEMORY_FLAG_READONLY,
+    (gpointer)g_bytes_get_data(data, NULL), size, 0, size,
+    g_bytes_ref(data), (GDestroyNotify)g_bytes_unref);
+  g_atomic_int_add(&gst_impl->num_bytes, (gint)size);
+  gst_app_src_push_buffer(GST_APP_SRC(gst_impl->thumbnail_src), buffer);
+  gst_app_src_end_of_stream(GST_APP_SRC(gst_impl->thumbnail_src));
+}
 
 static gboolean _omvp_gst_bus_callback(
   GstBus *bus, GstMessage *message, gpointer data) {
@@ -95,6 +561,18 @@ static gboolean _omvp_gst_bus_callback(
         g_free(str);
       }
       break;
+    case GST_MESSAGE_ELEMENT:
+      {
+        const GstStructure *stats;
+        stats = gst_message_get_structure(message);
+        if (gst_structure_has_name(stats, "omvprtpsrc-stats")) {
+          if (gst_impl->source_stats) {
+            gst_structure_free(gst_impl->source_stats);
+          }
+          gst_impl->source_stats = gst_structure_copy(stats);
+        }
+      }
+      break;
     case GST_MESSAGE_ERROR:
       {
         GError *err;
@@ -122,20 +600,6 @@ static gboolean _omvp_gst_bus_callback(
   return TRUE;
 }
 
-static void _omvp_gst_on_new_frame(gpointer priv, gpointer user_data) {
-  OMVPGstImpl *gst_impl;
-
-  (void)priv;
-
-  g_assert(user_data);
-
-  gst_impl = (OMVPGstImpl *)user_data;
-
-  g_assert(gst_impl->callback);
-
-  gst_impl->callback(OMVP_GST_CALLBACK_ID_NEW_FRAME, gst_impl->callback_data);
-}
-
 OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   ClutterActor *texture, gboolean scan, gint scan_width, gint scan_height,
   OMVPGstCallback callback, gpointer user_data) {
@@ -144,7 +608,11 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   gchar *protocol;
   gchar *location;
   gchar *real_uri;
+  gchar *variant_uri;
+  const OMVPHlsVariant *variant;
+  const OMVPHlsVariant *thumbnail;
   GstElement *play;
+  GstElement *decode;
   GstElement *scalesink;
   GstElement *scale;
   GstElement *sink;
@@ -152,9 +620,66 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   GstPad *ghostpad;
   GstCaps *caps;
   GstBus *bus;
+  GstAppSinkCallbacks callbacks;
 
   gst_impl = g_malloc0(sizeof(OMVPGstImpl));
-  gst_impl->play = play = gst_element_factory_make("playbin", "play");
+  gst_impl->current_audio = -1;
+
+  /*
+    A scan video of an HLS stream decodes a single keyframe, the newest one
+    of the I-frame playlist, or else the first one of the newest segment of
+    the variant, fetched by byte range. Neither playbin nor an adaptive
+    demuxer runs, and no whole segment is downloaded.
+  */
+  decode = NULL;
+  if (!proxy_uri && scan && omvp_hls_is_playlist_uri(uri)) {
+    thumbnail = omvp_hls_lookup_variant(uri, scan_width, scan_height, TRUE);
+    if (thumbnail) {
+      gst_impl->thumbnail_request = omvp_hls_fetch_iframe(thumbnail->uri,
+        _omvp_gst_on_thumbnail, gst_impl);
+    } else {
+      thumbnail = omvp_hls_lookup_variant(uri, scan_width, scan_height,
+        FALSE);
+      if (thumbnail) {
+        gst_impl->thumbnail_request = omvp_hls_fetch_keyframe(
+          thumbnail->uri, _omvp_gst_on_thumbnail, gst_impl);
+      }
+    }
+  }
+  if (gst_impl->thumbnail_request) {
+    gst_impl->play = play = gst_pipeline_new("play");
+    gst_impl->thumbnail_src = gst_element_factory_make("appsrc", "src");
+    decode = gst_element_factory_make("decodebin", "decode");
+    gst_bin_add_many(GST_BIN(play), gst_impl->thumbnail_src, decode, NULL);
+    gst_element_link(gst_impl->thumbnail_src, decode);
+  } else {
+    gst_impl->play = play = gst_element_factory_make("playbin", "play");
+    g_signal_connect(play, "audio-changed",
+      G_CALLBACK(_omvp_gst_on_audio_changed), gst_impl);
+    g_signal_connect(play, "source-setup",
+      G_CALLBACK(_omvp_gst_on_source_setup), gst_impl);
+  }
+
+  /*
+    Otherwise a scan video plays the lowest HLS variant that covers the scan
+    size, without adaptive switching, instead of downloading a high variant
+    for a small picture.
+  */
+  variant_uri = NULL;
+  if (!gst_impl->thumbnail_src && !proxy_uri &&
+    omvp_hls_is_playlist_uri(uri)) {
+    variant = omvp_hls_lookup_variant(uri, scan ? scan_width : 0,
+      scan ? scan_height : 0, FALSE);
+    if (variant && scan) {
+      variant_uri = g_strdup(variant->uri);
+      uri = variant_uri;
+    } else if (variant) {
+      gst_impl->start_bitrate = variant->bandwidth;
+      g_signal_connect(play, "deep-element-added",
+        G_CALLBACK(_omvp_gst_on_deep_element_added), gst_impl);
+    }
+  }
+
   if (gst_uri_is_valid(uri)) {
     protocol = gst_uri_get_protocol(uri);
     if (protocol) {
@@ -174,6 +699,11 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
               protocol = g_strdup("ortp");
             }
           }
+          if (strcmp(protocol, "udp") == 0) {
+            /* omvprtpsrc detects RTP or raw MPEG-TS without typefinding */
+            g_free(protocol);
+            protocol = g_strdup("ortp");
+          }
           real_uri = g_strdup_printf("%s://%s", protocol, location);
         }
         g_free(location);
@@ -187,51 +717,39 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   } else {
     real_uri = g_strdup(uri);
   }
-  g_object_set(G_OBJECT(play), "uri", real_uri, NULL);
-  scale = gst_element_factory_make("videoscale", "scale");
-#if CLUTTER_GST_MAJOR_VERSION > 2
-  {
-    ClutterGstVideoSink *gst_video_sink;
-    ClutterContent *content;
-    content = clutter_actor_get_content(texture);
-    if (content) {
-      gst_video_sink = clutter_gst_content_get_sink(
-        CLUTTER_GST_CONTENT(content));
-    } else {
-      gst_video_sink = clutter_gst_video_sink_new();
-      content = clutter_gst_content_new_with_sink(gst_video_sink);
-      clutter_actor_set_content(texture, content);
-    }
-    sink = GST_ELEMENT(gst_video_sink);
-    if (callback) {
-      gst_impl->instance = sink;
-      g_object_add_weak_pointer(gst_impl->instance, &gst_impl->instance);
-      gst_impl->callback = callback;
-      gst_impl->callback_data = user_data;
-      gst_impl->handler_id =
-        g_signal_connect(sink, "new-frame", G_CALLBACK(_omvp_gst_on_new_frame),
-          gst_impl);
-    }
+  if (!gst_impl->thumbnail_src) {
+    g_object_set(G_OBJECT(play), "uri", real_uri, NULL);
   }
-#else
-  {
-    sink = gst_element_factory_make("autocluttersink", NULL);
-    g_object_set(sink, "texture", texture, NULL);
-    if (callback) {
-      gst_impl->instance = texture;
-      g_object_add_weak_pointer(gst_impl->instance, &gst_impl->instance);
-      gst_impl->callback = callback;
-      gst_impl->callback_data = user_data;
-      gst_impl->handler_id =
-        g_signal_connect(texture, "pixbuf-change",
-          G_CALLBACK(_omvp_gst_on_new_frame), gst_impl);
-    }
+  scale = gst_element_factory_make("videoscale", "scale");
+  sink = gst_element_factory_make("appsink", "sink");
+  caps = gst_pad_query_caps(_omvp_gst_get_display(texture)->pad, NULL);
+  g_object_set(sink, "caps", caps, "enable-last-sample", FALSE, NULL);
+  gst_caps_unref(caps);
+  memset(&callbacks, 0, sizeof(callbacks));
+  callbacks.new_sample = _omvp_gst_on_new_sample;
+  gst_app_sink_set_callbacks(GST_APP_SINK(sink), &callbacks, gst_impl, NULL);
+  gst_impl->texture = texture;
+  g_object_add_weak_pointer(gst_impl->texture, &gst_impl->texture);
+  gst_impl->callback = callback;
+  gst_impl->callback_data = user_data;
+  if (!_omvp_gst_frame_source) {
+    _omvp_gst_frame_source = g_source_new(&_omvp_gst_frame_source_funcs,
+      sizeof(GSource));
+    g_source_set_callback(_omvp_gst_frame_source, _omvp_gst_on_frames,
+      NULL, NULL);
+    g_source_attach(_omvp_gst_frame_source, NULL);
   }
-#endif
+  gst_impl->scan = scan;
+  gst_impl->throttle = scan;
+  gst_impl->throttle_epoch = g_atomic_int_get(&_omvp_gst_throttle_epoch) - 1;
   scalesink = gst_bin_new("scalesink");
   gst_bin_add_many(GST_BIN(scalesink), scale, sink, NULL);
   pad = gst_element_get_static_pad(scale, "sink");
+  gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, _omvp_gst_buffer_probe,
+    gst_impl, NULL);
   ghostpad = gst_ghost_pad_new("sink", pad);
+  g_signal_connect(ghostpad, "notify::caps",
+    G_CALLBACK(_omvp_gst_on_caps_notify), &gst_impl->video_caps_pending);
   gst_element_add_pad(scalesink, ghostpad);
   gst_object_unref(GST_OBJECT(pad));
   if (scan) {
@@ -241,9 +759,11 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
       "height", G_TYPE_INT, scan_height, NULL);
     gst_element_link_filtered(scale, sink, caps);
     gst_caps_unref(caps);
-    g_object_get(play, "flags", &flags, NULL);
-    flags &= (~0x00000002);
-    g_object_set(play, "flags", flags, NULL);
+    if (!gst_impl->thumbnail_src) {
+      g_object_get(play, "flags", &flags, NULL);
+      flags &= (~0x00000002);
+      g_object_set(play, "flags", flags, NULL);
+    }
   } else {
     GstElement *convertaudiosink;
     GstElement *convert;
@@ -257,17 +777,27 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
       convert, resample, audiosink, NULL);
     pad = gst_element_get_static_pad(convert, "sink");
     ghostpad = gst_ghost_pad_new("sink", pad);
+    g_signal_connect(ghostpad, "notify::caps",
+      G_CALLBACK(_omvp_gst_on_caps_notify), &gst_impl->audio_caps_pending);
     gst_element_add_pad(convertaudiosink, ghostpad);
     gst_object_unref(GST_OBJECT(pad));
     gst_element_link_many(convert, resample, audiosink, NULL);
     g_object_set(play, "audio-sink", convertaudiosink, NULL);
     gst_element_link(scale, sink);
   }
-  g_object_set(play, "video-sink", scalesink, NULL);
+  if (gst_impl->thumbnail_src) {
+    gst_bin_add(GST_BIN(play), scalesink);
+    g_signal_connect(decode, "pad-added",
+      G_CALLBACK(_omvp_gst_on_decode_pad_added), scalesink);
+  } else {
+    g_object_set(play, "video-sink", scalesink, NULL);
+  }
 
   /* mute property doesn't work in some platform. */
   gst_impl->mute = TRUE;
-  g_object_set(play, "volume", 0.0f, NULL);
+  if (!gst_impl->thumbnail_src) {
+    g_object_set(play, "volume", 0.0f, NULL);
+  }
 
   bus = gst_element_get_bus(play);
   gst_impl->bus_watch_id =
@@ -279,6 +809,7 @@ OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   g_debug("omvp_gst_open uri(%s) real_uri(%s) texture(%p) gst(%p)",
     uri, real_uri, (void *)texture, (void *)gst_impl);
   g_free(real_uri);
+  g_free(variant_uri);
 
   return (OMVPGst)gst_impl;
 }
@@ -290,33 +821,53 @@ gint omvp_gst_cancel_new_frame_callback(OMVPGst gst) {
 
   gst_impl = (OMVPGstImpl *)gst;
   if (gst_impl) {
-    if (gst_impl->instance && gst_impl->handler_id) {
-      g_signal_handler_disconnect(gst_impl->instance, gst_impl->handler_id);
-      gst_impl->instance = NULL;
-      gst_impl->handler_id = 0;
-    }
+    gst_impl->callback = NULL;
+    gst_impl->callback_data = NULL;
   }
 
   return 0;
 }
 
+gint omvp_gst_set_callback_data(OMVPGst gst, gpointer user_data) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+
+  gst_impl = (OMVPGstImpl *)gst;
+  gst_impl->callback_data = user_data;
+
+  return 0;
+}
+
 gint omvp_gst_close(OMVPGst gst) {
   OMVPGstImpl *gst_impl;
   gst_impl = (OMVPGstImpl *)gst;
   if (gst_impl) {
-    if (gst_impl->instance && gst_impl->handler_id) {
-      g_signal_handler_disconnect(gst_impl->instance, gst_impl->handler_id);
-      gst_impl->instance = NULL;
-      gst_impl->handler_id = 0;
-      gst_impl->callback = NULL;
-      gst_impl->callback_data = NULL;
+    if (gst_impl->texture) {
+      g_object_remove_weak_pointer(gst_impl->texture, &gst_impl->texture);
+      gst_impl->texture = NULL;
     }
+    gst_impl->callback = NULL;
+    gst_impl->callback_data = NULL;
+    omvp_hls_cancel(gst_impl->thumbnail_request);
     gst_element_set_state(gst_impl->play, GST_STATE_NULL);
+    _omvp_gst_release_hls_demux(gst_impl, FALSE);
     g_source_remove(gst_impl->bus_watch_id);
+    g_mutex_lock(&_omvp_gst_pending_lock);
+    g_queue_remove(&_omvp_gst_pending, gst_impl);
+    g_mutex_unlock(&_omvp_gst_pending_lock);
+    if (gst_impl->frame_mailbox) {
+      gst_sample_unref(gst_impl->frame_mailbox);
+    }
+    g_free(gst_impl->audio_caps_pending);
+    g_free(gst_impl->video_caps_pending);
     g_free(gst_impl->audio_caps_str);
     g_free(gst_impl->video_caps_str);
     g_free(gst_impl->audio_tags_str);
     g_free(gst_impl->video_tags_str);
+    if (gst_impl->source_stats) {
+      gst_structure_free(gst_impl->source_stats);
+    }
     gst_object_unref(gst_impl->play);
     g_free(gst_impl);
   }
@@ -326,6 +877,64 @@ gint omvp_gst_close(OMVPGst gst) {
   return 0;
 }
 
+/*
+  Takes the newest frame out of the mailbox of every pipeline that got one,
+  hands it to the sink of its tile and calls the new frame callback, once per
+  pipeline. Called right before the stage is painted, so the main loop
+  work follows the refresh rate instead of tiles times frame rate. A
+  callback may close any pipeline, including its own.
+*/
+gint omvp_gst_update_frames(void) {
+  OMVPGstImpl *gst_impl;
+  GstSample *sample;
+  guint num_pending;
+  guint i;
+
+  g_mutex_lock(&_omvp_gst_pending_lock);
+  num_pending = _omvp_gst_pending.length;
+  g_mutex_unlock(&_omvp_gst_pending_lock);
+
+  for (i = 0; i < num_pending; i++) {
+    g_mutex_lock(&_omvp_gst_pending_lock);
+    gst_impl = g_queue_pop_head(&_omvp_gst_pending);
+    if (gst_impl) {
+      g_atomic_int_set(&gst_impl->is_frame_pending, 0);
+    }
+    g_mutex_unlock(&_omvp_gst_pending_lock);
+    if (!gst_impl) {
+      break;
+    }
+    sample = g_atomic_pointer_exchange(&gst_impl->frame_mailbox, NULL);
+    if (!sample) {
+      continue;
+    }
+    _omvp_gst_show_frame(gst_impl, sample);
+    gst_sample_unref(sample);
+    g_atomic_int_inc(&gst_impl->num_frames);
+    if (g_atomic_pointer_get(&gst_impl->hls_demux)) {
+      _omvp_gst_release_hls_demux(gst_impl, TRUE);
+    }
+    if (gst_impl->callback) {
+      gst_impl->callback(OMVP_GST_CALLBACK_ID_NEW_FRAME,
+        gst_impl->callback_data);
+    }
+  }
+
+  return 0;
+}
+
+gint omvp_gst_set_render_throttle(gboolean throttle) {
+  g_atomic_int_set(&_omvp_gst_throttle_enabled, throttle);
+
+  return 0;
+}
+
+gint omvp_gst_advance_render_throttle(void) {
+  g_atomic_int_inc(&_omvp_gst_throttle_epoch);
+
+  return 0;
+}
+
 gint omvp_gst_set_mute(OMVPGst gst, gboolean mute) {
   OMVPGstImpl *gst_impl;
 
@@ -378,13 +987,11 @@ gdouble omvp_gst_get_volume(OMVPGst gst) {
 
 gint omvp_gst_get_num_audio(OMVPGst gst) {
   OMVPGstImpl *gst_impl;
-  gint num_audio;
 
   g_assert(gst);
   gst_impl = (OMVPGstImpl *)gst;
-  g_object_get(gst_impl->play, "n-audio", &num_audio, NULL);
 
-  return num_audio;
+  return g_atomic_int_get(&gst_impl->num_audio);
 }
 
 gint omvp_gst_set_current_audio(OMVPGst gst, gint current_audio) {
@@ -393,39 +1000,66 @@ gint omvp_gst_set_current_audio(OMVPGst gst, gint current_audio) {
   g_assert(gst);
   gst_impl = (OMVPGstImpl *)gst;
   g_object_set(gst_impl->play, "current-audio", current_audio, NULL);
+  g_atomic_int_set(&gst_impl->current_audio, current_audio);
 
   return 0;
 }
 
 gint omvp_gst_get_current_audio(OMVPGst gst) {
   OMVPGstImpl *gst_impl;
-  gint current_audio;
 
   g_assert(gst);
   gst_impl = (OMVPGstImpl *)gst;
-  g_object_get(gst_impl->play, "current-audio", &current_audio, NULL);
 
-  return current_audio;
+  return g_atomic_int_get(&gst_impl->current_audio);
+}
+
+gint omvp_gst_get_num_frames(OMVPGst gst) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+  gst_impl = (OMVPGstImpl *)gst;
+
+  return g_atomic_int_get(&gst_impl->num_frames);
+}
+
+gint omvp_gst_get_num_buffers(OMVPGst gst) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+  gst_impl = (OMVPGstImpl *)gst;
+
+  return g_atomic_int_get(&gst_impl->num_buffers);
+}
+
+gint omvp_gst_get_num_dropped_frames(OMVPGst gst) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+  gst_impl = (OMVPGstImpl *)gst;
+
+  return g_atomic_int_get(&gst_impl->num_dropped_frames);
+}
+
+guint omvp_gst_get_num_bytes(OMVPGst gst) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+  gst_impl = (OMVPGstImpl *)gst;
+
+  return (guint)g_atomic_int_get(&gst_impl->num_bytes);
 }
 
 gchar *omvp_gst_get_audio_caps_str(OMVPGst gst) {
   OMVPGstImpl *gst_impl;
+  gchar *str;
 
   g_assert(gst);
   gst_impl = (OMVPGstImpl *)gst;
-  if (!gst_impl->audio_caps_str) {
-    GstElement *sink;
-    GstPad *pad;
-    GstCaps *caps;
-    g_object_get(gst_impl->play, "audio-sink", &sink, NULL);
-    pad = gst_element_get_static_pad(sink, "sink");
-    caps = gst_pad_get_current_caps(pad);
-    if (caps) {
-      gst_impl->audio_caps_str = gst_caps_to_string(caps);
-      gst_caps_unref(caps);
-    }
-    gst_object_unref(GST_OBJECT(pad));
-    g_object_unref(sink);
+  str = _omvp_gst_exchange_str(&gst_impl->audio_caps_pending, NULL);
+  if (str) {
+    g_free(gst_impl->audio_caps_str);
+    gst_impl->audio_caps_str = str;
   }
 
   return gst_impl->audio_caps_str;
@@ -433,22 +1067,14 @@ gchar *omvp_gst_get_audio_caps_str(OMVPGst gst) {
 
 gchar *omvp_gst_get_video_caps_str(OMVPGst gst) {
   OMVPGstImpl *gst_impl;
+  gchar *str;
 
   g_assert(gst);
   gst_impl = (OMVPGstImpl *)gst;
-  if (!gst_impl->video_caps_str) {
-    GstElement *sink;
-    GstPad *pad;
-    GstCaps *caps;
-    g_object_get(gst_impl->play, "video-sink", &sink, NULL);
-    pad = gst_element_get_static_pad(sink, "sink");
-    caps = gst_pad_get_current_caps(pad);
-    if (caps) {
-      gst_impl->video_caps_str = gst_caps_to_string(caps);
-      gst_caps_unref(caps);
-    }
-    gst_object_unref(GST_OBJECT(pad));
-    g_object_unref(sink);
+  str = _omvp_gst_exchange_str(&gst_impl->video_caps_pending, NULL);
+  if (str) {
+    g_free(gst_impl->video_caps_str);
+    gst_impl->video_caps_str = str;
   }
 
   return gst_impl->video_caps_str;
@@ -471,3 +1097,17 @@ gchar *omvp_gst_get_video_tags_str(OMVPGst gst) {
 
   return gst_impl->video_tags_str;
 }
+
+/*
+  The last stats the source element of a focus video posted, or NULL. The
+  stats belong to the pipeline and stay valid until the next main loop
+  iteration.
+*/
+const GstStructure *omvp_gst_get_source_stats(OMVPGst gst) {
+  OMVPGstImpl *gst_impl;
+
+  g_assert(gst);
+  gst_impl = (OMVPGstImpl *)gst;
+
+  return gst_impl->source_stats;
+}
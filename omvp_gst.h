@@ -36,7 +36,11 @@ extern OMVPGst omvp_gst_open(const gchar *proxy_uri, const gchar *uri,
   ClutterActor *texture, gboolean scan, gint scan_width, gint scan_height,
   OMVPGstCallback callback, gpointer user_data);
 extern gint omvp_gst_cancel_new_frame_callback(OMVPGst gst);
+extern gint omvp_gst_set_callback_data(OMVPGst gst, gpointer user_data);
 extern gint omvp_gst_close(OMVPGst gst);
+extern gint omvp_gst_update_frames(void);
+extern gint omvp_gst_set_render_throttle(gboolean throttle);
+extern gint omvp_gst_advance_render_throttle(void);
 extern gint omvp_gst_set_mute(OMVPGst gst, gboolean mute);
 extern gboolean omvp_gst_get_mute(OMVPGst gst);
 extern gint omvp_gst_set_volume(OMVPGst gst, gdouble volume);
@@ -44,9 +48,14 @@ extern gdouble omvp_gst_get_volume(OMVPGst gst);
 extern gint omvp_gst_get_num_audio(OMVPGst gst);
 extern gint omvp_gst_set_current_audio(OMVPGst gst, gint n_audio);
 extern gint omvp_gst_get_current_audio(OMVPGst gst);
+extern gint omvp_gst_get_num_frames(OMVPGst gst);
+extern gint omvp_gst_get_num_buffers(OMVPGst gst);
+extern gint omvp_gst_get_num_dropped_frames(OMVPGst gst);
+extern guint omvp_gst_get_num_bytes(OMVPGst gst);
 extern gchar *omvp_gst_get_audio_caps_str(OMVPGst gst);
 extern gchar *omvp_gst_get_video_caps_str(OMVPGst gst);
 extern gchar *omvp_gst_get_audio_tags_str(OMVPGst gst);
 extern gchar *omvp_gst_get_video_tags_str(OMVPGst gst);
+extern const GstStructure *omvp_gst_get_source_stats(OMVPGst gst);
 
 #endif /* _OMVP_GST_H_ */
@@ -18,7 +18,9 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdio.h>
 #include <string.h>
+#include <gst/app/gstappsrc.h>
 #include "config.h"
 #include "omvp_gst_plugin_rtpsrc.h"
 
@@ -28,16 +30,126 @@ GST_DEBUG_CATEGORY_STATIC(omvp_rtpsrc_debug);
 enum {
   PROP_0,
   PROP_URI,
+  PROP_CAPS,
+  PROP_PAYLOAD,
+  PROP_ENCODING_NAME,
+  PROP_CLOCK_RATE,
+  PROP_PROGRAM,
+  PROP_RTCP_PORT,
+  PROP_BUFFER_SIZE,
+  PROP_BATCH_SIZE,
+  PROP_POOL_SIZE,
+  PROP_LATENCY,
+  PROP_ADAPTIVE_LATENCY,
+  PROP_MIN_LATENCY,
+  PROP_MAX_LATENCY,
+  PROP_LATE_THRESHOLD,
+  PROP_STATS,
+  PROP_STATS_INTERVAL,
   PROP_LAST
 };
 
 #define DEFAULT_PROP_URI (NULL)
+#define DEFAULT_PROP_CAPS (NULL)
+#define DEFAULT_PROP_PAYLOAD (-1)
+#define DEFAULT_PROP_ENCODING_NAME (NULL)
+#define DEFAULT_PROP_CLOCK_RATE (0)
+#define DEFAULT_PROP_PROGRAM (0)
+#define DEFAULT_PROP_RTCP_PORT (0)
+#define DEFAULT_PROP_BUFFER_SIZE (2 * 1024 * 1024)
+#define DEFAULT_PROP_BATCH_SIZE (32)
+#define DEFAULT_PROP_POOL_SIZE (1024)
+#define DEFAULT_PROP_LATENCY (200)
+#define DEFAULT_PROP_ADAPTIVE_LATENCY (TRUE)
+#define DEFAULT_PROP_MIN_LATENCY (20)
+#define DEFAULT_PROP_MAX_LATENCY (2000)
+#define DEFAULT_PROP_LATE_THRESHOLD (0.001)
+#define DEFAULT_PROP_STATS_INTERVAL (0)
+
+/* packets inspected at most before giving up on payload detection */
+#define SNIFF_MAX_PACKETS (32)
+/* packets matching only one of H.264 or H.265 needed to pick it */
+#define SNIFF_VOTES (3)
+
+/* interval of the jitterbuffer latency adaptation */
+#define LATENCY_INTERVAL (GST_SECOND)
+/* smallest latency increase in ms after late packets */
+#define LATENCY_STEP (10)
+/* smallest latency change in ms worth a new pipeline latency */
+#define LATENCY_MIN_CHANGE (5)
+/* intervals without late packets before the latency is lowered */
+#define LATENCY_CLEAN_WINDOWS (5)
+
+/* seconds between the NTP epoch (1900) and the unix epoch (1970) */
+#define NTP_UNIX_OFFSET (G_GINT64_CONSTANT(2208988800))
+/* sender report span in microseconds before the clock drift is trusted */
+#define DRIFT_MIN_SPAN (10 * G_USEC_PER_SEC)
+/* SSRCs tracked at most, more only come from a broken network */
+#define SSRC_MAX (16)
+/* intervals another SSRC must be busier before it is selected */
+#define SSRC_SWITCH_WINDOWS (2)
+/* intervals without packets before an SSRC without a stream is forgotten */
+#define SSRC_IDLE_WINDOWS (30)
+/* RTCP comes a few packets per second, a small pool is enough */
+#define RTCP_BATCH_SIZE (8)
+#define RTCP_POOL_SIZE (64)
+
+typedef struct {
+  const gchar *encoding_name;
+  const gchar *media;
+  gint clock_rate;
+  const gchar *depay;
+} GstOMVPRtpSrcEncoding;
+
+typedef struct {
+  gint payload;
+  const gchar *encoding_name;
+} GstOMVPRtpSrcStaticPayload;
+
+typedef struct {
+  guint32 ssrc;
+  GstPad *pad;
+  GstPad *selector_pad;
+  GstElement *jitterbuffer;
+  guint window_packets;
+  guint rate;
+  guint better_windows;
+  guint idle_windows;
+} GstOMVPRtpSrcSsrc;
+
+static const GstOMVPRtpSrcEncoding encodings[] = {
+  { "MP2T", "video", 90000, "rtpmp2tdepay" },
+  { "H264", "video", 90000, "rtph264depay" },
+  { "H265", "video", 90000, "rtph265depay" },
+  { "MPV", "video", 90000, "rtpmpvdepay" },
+  { "JPEG", "video", 90000, "rtpjpegdepay" },
+  { "MPA", "audio", 90000, "rtpmpadepay" },
+  { "PCMU", "audio", 8000, "rtppcmudepay" },
+  { "PCMA", "audio", 8000, "rtppcmadepay" },
+  { NULL, NULL, 0, NULL }
+};
+
+/* RFC 3551 static payload types */
+static const GstOMVPRtpSrcStaticPayload static_payloads[] = {
+  { 0, "PCMU" },
+  { 8, "PCMA" },
+  { 14, "MPA" },
+  { 26, "JPEG" },
+  { 32, "MPV" },
+  { 33, "MP2T" },
+  { -1, NULL }
+};
 
 static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE("src",
-  GST_PAD_SRC, GST_PAD_SOMETIMES, GST_STATIC_CAPS("application/x-rtp"));
+  GST_PAD_SRC, GST_PAD_SOMETIMES, GST_STATIC_CAPS_ANY);
 
 static gboolean gst_omvp_rtpsrc_parse_uri(const gchar *uristr, gchar **host,
   guint16 *port);
+static void gst_omvp_rtpsrc_parse_uri_params(GstOMVPRtpSrc *rtpsrc,
+  const gchar *uristr);
+static const GstOMVPRtpSrcEncoding *gst_omvp_rtpsrc_find_encoding(
+  const gchar *encoding_name);
+static const gchar *gst_omvp_rtpsrc_find_static_payload(gint payload);
 static GstURIType gst_omvp_rtpsrc_uri_get_type(GType type);
 static const gchar *const *gst_omvp_rtpsrc_uri_get_protocols(GType type);
 static gchar *gst_omvp_rtpsrc_uri_get_uri(GstURIHandler *handler);
@@ -50,9 +162,47 @@ static void gst_omvp_rtpsrc_set_property(GObject *object, guint prop_id,
 static void gst_omvp_rtpsrc_get_property(GObject *object, guint prop_id,
   GValue *value, GParamSpec *pspec);
 static void gst_omvp_rtpsrc_finalize(GObject *gobject);
+static GstStructure *gst_omvp_rtpsrc_get_stats(GstOMVPRtpSrc *rtpsrc);
+static void gst_omvp_rtpsrc_recv_cb(GstBuffer *buffer, gpointer data);
+static void gst_omvp_rtpsrc_measure(GstOMVPRtpSrc *rtpsrc, GstBuffer *buffer);
+static void gst_omvp_rtpsrc_rtcp_recv_cb(GstBuffer *buffer, gpointer data);
+static void gst_omvp_rtpsrc_parse_rtcp(GstOMVPRtpSrc *rtpsrc,
+  const guint8 *data, gsize size);
+static gboolean gst_omvp_rtpsrc_update_latency(GstOMVPRtpSrc *rtpsrc,
+  guint64 num_pushed, guint64 num_late);
+static gboolean gst_omvp_rtpsrc_latency_cb(GstClock *clock,
+  GstClockTime time, GstClockID id, gpointer data);
+static gboolean gst_omvp_rtpsrc_stats_cb(GstClock *clock,
+  GstClockTime time, GstClockID id, gpointer data);
+static GstOMVPRtpSrcSsrc *gst_omvp_rtpsrc_add_ssrc(GstOMVPRtpSrc *rtpsrc,
+  guint32 ssrc);
+static void gst_omvp_rtpsrc_free_ssrc(gpointer data);
+static GstPad *gst_omvp_rtpsrc_update_ssrcs(GstOMVPRtpSrc *rtpsrc);
+static void gst_omvp_rtpsrc_sniff(GstOMVPRtpSrc *rtpsrc, const guint8 *data,
+  gsize size);
+static gboolean gst_omvp_rtpsrc_is_rtp(const guint8 *data, gsize size);
+static gboolean gst_omvp_rtpsrc_is_ts(const guint8 *data, gsize size);
+static GstPadProbeReturn gst_omvp_rtpsrc_sniff_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer data);
+static GstCaps *gst_omvp_rtpsrc_rtpbin_request_pt_map_cb(GstElement *element,
+  guint session, guint pt, gpointer data);
+static GstElement *gst_omvp_rtpsrc_make_depay(GstOMVPRtpSrc *rtpsrc);
+static void gst_omvp_rtpsrc_expose_pad(GstOMVPRtpSrc *rtpsrc,
+  GstPad *target);
+static gboolean gst_omvp_rtpsrc_start_selector(GstOMVPRtpSrc *rtpsrc);
 static void gst_omvp_rtpsrc_rtpbin_pad_added_cb(GstElement *element,
   GstPad *pad, gpointer data);
+static void gst_omvp_rtpsrc_rtpbin_pad_removed_cb(GstElement *element,
+  GstPad *pad, gpointer data);
+static void gst_omvp_rtpsrc_rtpbin_new_jitterbuffer_cb(GstElement *element,
+  GstElement *jitterbuffer, guint session, guint ssrc, gpointer data);
+static GstElement *gst_omvp_rtpsrc_make_capsfilter(GstOMVPRtpSrc *rtpsrc,
+  GstCaps *caps);
+static gboolean gst_omvp_rtpsrc_start_rtcp(GstOMVPRtpSrc *rtpsrc);
+static gboolean gst_omvp_rtpsrc_start_rtp(GstOMVPRtpSrc *rtpsrc);
+static gboolean gst_omvp_rtpsrc_start_ts(GstOMVPRtpSrc *rtpsrc);
 static gboolean gst_omvp_rtpsrc_start(GstOMVPRtpSrc *rtpsrc);
+static void gst_omvp_rtpsrc_stop(GstOMVPRtpSrc *rtpsrc);
 static GstStateChangeReturn gst_omvp_rtpsrc_change_state(GstElement *element,
   GstStateChange transition);
 
@@ -61,6 +211,7 @@ static gboolean gst_omvp_rtpsrc_parse_uri(const gchar *uristr, gchar **host,
   gchar *protocol, *location_start;
   gchar *location, *location_end;
   gchar *colptr;
+  gchar *query;
 
   protocol = gst_uri_get_protocol(uristr);
   if (!protocol) {
@@ -76,6 +227,11 @@ static gboolean gst_omvp_rtpsrc_parse_uri(const gchar *uristr, gchar **host,
     return FALSE;
   }
 
+  query = strchr(location_start, '?');
+  if (query) {
+    *query = '\0';
+  }
+
   GST_DEBUG("got location '%s'", location_start);
 
   location = g_strstr_len(location_start, -1, "@");
@@ -136,6 +292,96 @@ wrong_address:
   }
 }
 
+static void gst_omvp_rtpsrc_parse_uri_params(GstOMVPRtpSrc *rtpsrc,
+  const gchar *uristr) {
+  const gchar *query;
+  gchar **params;
+  gint i;
+
+  query = uristr ? strchr(uristr, '?') : NULL;
+  if (!query) {
+    return;
+  }
+
+  params = g_strsplit(query + 1, "&", -1);
+  for (i = 0; params[i]; i++) {
+    gchar *eq;
+    gchar *value;
+    const gchar *key;
+
+    eq = strchr(params[i], '=');
+    if (!eq) {
+      continue;
+    }
+    *eq = '\0';
+    key = params[i];
+    value = g_uri_unescape_string(eq + 1, NULL);
+    if (!value) {
+      continue;
+    }
+    GST_DEBUG_OBJECT(rtpsrc, "uri parameter %s=%s", key, value);
+
+    if (strcmp(key, "payload") == 0 || strcmp(key, "pt") == 0) {
+      rtpsrc->payload = CLAMP(g_ascii_strtoll(value, NULL, 10), 0, 127);
+    } else if (strcmp(key, "encoding-name") == 0 ||
+      strcmp(key, "encoding") == 0) {
+      g_free(rtpsrc->encoding_name);
+      rtpsrc->encoding_name = g_ascii_strup(value, -1);
+    } else if (strcmp(key, "clock-rate") == 0 || strcmp(key, "rate") == 0) {
+      rtpsrc->clock_rate = MAX(g_ascii_strtoll(value, NULL, 10), 0);
+    } else if (strcmp(key, "program") == 0) {
+      rtpsrc->program = CLAMP(g_ascii_strtoll(value, NULL, 10), 0, 65535);
+    } else if (strcmp(key, "rtcp-port") == 0) {
+      rtpsrc->rtcp_port = CLAMP(g_ascii_strtoll(value, NULL, 10), -1, 65535);
+    } else if (strcmp(key, "rtpmap") == 0) {
+      /* SDP a=rtpmap syntax: "<payload> <encoding>/<clock rate>" */
+      gchar **rtpmap;
+      rtpmap = g_strsplit_set(value, " /", 3);
+      if (rtpmap[0] && rtpmap[1]) {
+        rtpsrc->payload = CLAMP(g_ascii_strtoll(rtpmap[0], NULL, 10), 0, 127);
+        g_free(rtpsrc->encoding_name);
+        rtpsrc->encoding_name = g_ascii_strup(rtpmap[1], -1);
+        if (rtpmap[2]) {
+          rtpsrc->clock_rate = MAX(g_ascii_strtoll(rtpmap[2], NULL, 10), 0);
+        }
+      }
+      g_strfreev(rtpmap);
+    } else {
+      GST_WARNING_OBJECT(rtpsrc, "unknown uri parameter %s", key);
+    }
+    g_free(value);
+  }
+  g_strfreev(params);
+}
+
+static const GstOMVPRtpSrcEncoding *gst_omvp_rtpsrc_find_encoding(
+  const gchar *encoding_name) {
+  gint i;
+
+  if (!encoding_name) {
+    return NULL;
+  }
+  for (i = 0; encodings[i].encoding_name; i++) {
+    if (g_ascii_strcasecmp(encodings[i].encoding_name, encoding_name) == 0) {
+      return &encodings[i];
+    }
+  }
+
+  return NULL;
+}
+
+static const gchar *gst_omvp_rtpsrc_find_static_payload(gint payload) {
+  gint i;
+
+  for (i = 0; static_payloads[i].encoding_name; i++) {
+    if (static_payloads[i].payload == payload) {
+      return static_payloads[i].encoding_name;
+    }
+  }
+
+  return NULL;
+}
+
 #define gst_omvp_rtpsrc_parent_class parent_class
 G_DEFINE_TYPE_WITH_CODE(GstOMVPRtpSrc, gst_omvp_rtpsrc, GST_TYPE_BIN,
   G_IMPLEMENT_INTERFACE(GST_TYPE_URI_HANDLER,
@@ -153,6 +399,92 @@ static void gst_omvp_rtpsrc_class_init(GstOMVPRtpSrcClass *klass) {
     g_param_spec_string("uri", "URI", "URI of the media to play",
       DEFAULT_PROP_URI, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property(oclass, PROP_CAPS,
+    g_param_spec_boxed("caps", "Caps",
+      "The caps of the incoming RTP stream (NULL = detect)", GST_TYPE_CAPS,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_PAYLOAD,
+    g_param_spec_int("payload", "Payload",
+      "The payload type of the incoming RTP stream (-1 = detect)", -1, 127,
+      DEFAULT_PROP_PAYLOAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_ENCODING_NAME,
+    g_param_spec_string("encoding-name", "Encoding name",
+      "The encoding name of the payload (NULL = detect)",
+      DEFAULT_PROP_ENCODING_NAME, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_CLOCK_RATE,
+    g_param_spec_int("clock-rate", "Clock rate",
+      "The clock rate of the payload (0 = default of the encoding)", 0,
+      G_MAXINT, DEFAULT_PROP_CLOCK_RATE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_PROGRAM,
+    g_param_spec_int("program", "Program",
+      "MPEG-TS program number to keep (0 = all programs)", 0, 65535,
+      DEFAULT_PROP_PROGRAM, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_RTCP_PORT,
+    g_param_spec_int("rtcp-port", "RTCP port",
+      "Port of the RTCP sender reports (0 = RTP port + 1, -1 = none)", -1,
+      65535, DEFAULT_PROP_RTCP_PORT,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_BUFFER_SIZE,
+    g_param_spec_int("buffer-size", "Buffer size",
+      "Size of the kernel receive buffer in bytes (0 = system default)", 0,
+      G_MAXINT, DEFAULT_PROP_BUFFER_SIZE,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_BATCH_SIZE,
+    g_param_spec_uint("batch-size", "Batch size",
+      "Maximum number of datagrams read per wakeup", 1, 1024,
+      DEFAULT_PROP_BATCH_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_POOL_SIZE,
+    g_param_spec_uint("pool-size", "Pool size",
+      "Number of pre-allocated packet buffers", 16, 65536,
+      DEFAULT_PROP_POOL_SIZE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_LATENCY,
+    g_param_spec_uint("latency", "Latency",
+      "Jitterbuffer latency in ms, the current one when adaptive", 0,
+      G_MAXUINT, DEFAULT_PROP_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_ADAPTIVE_LATENCY,
+    g_param_spec_boolean("adaptive-latency", "Adaptive latency",
+      "Adapt the latency to the measured jitter and late packets",
+      DEFAULT_PROP_ADAPTIVE_LATENCY,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_MIN_LATENCY,
+    g_param_spec_uint("min-latency", "Minimum latency",
+      "Lowest adaptive latency in ms", 0, G_MAXUINT,
+      DEFAULT_PROP_MIN_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_MAX_LATENCY,
+    g_param_spec_uint("max-latency", "Maximum latency",
+      "Highest adaptive latency in ms", 0, G_MAXUINT,
+      DEFAULT_PROP_MAX_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_LATE_THRESHOLD,
+    g_param_spec_double("late-threshold", "Late threshold",
+      "Fraction of late packets that raises the adaptive latency", 0.0, 1.0,
+      DEFAULT_PROP_LATE_THRESHOLD,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_STATS,
+    g_param_spec_boxed("stats", "Statistics", "Receive statistics",
+      GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property(oclass, PROP_STATS_INTERVAL,
+    g_param_spec_uint("stats-interval", "Statistics interval",
+      "Interval in ms of the element messages carrying the stats "
+      "(0 = disabled)", 0, G_MAXUINT, DEFAULT_PROP_STATS_INTERVAL,
+      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_pad_template(gstelement_class,
     gst_static_pad_template_get(&src_template));
 
@@ -167,9 +499,39 @@ static void gst_omvp_rtpsrc_class_init(GstOMVPRtpSrcClass *klass) {
 
 static void gst_omvp_rtpsrc_init(GstOMVPRtpSrc *rtpsrc) {
   rtpsrc->uri = NULL;
-  rtpsrc->udpsrc = NULL;
+  rtpsrc->caps = DEFAULT_PROP_CAPS;
+  rtpsrc->payload = DEFAULT_PROP_PAYLOAD;
+  rtpsrc->encoding_name = DEFAULT_PROP_ENCODING_NAME;
+  rtpsrc->clock_rate = DEFAULT_PROP_CLOCK_RATE;
+  rtpsrc->program = DEFAULT_PROP_PROGRAM;
+  rtpsrc->rtcp_port = DEFAULT_PROP_RTCP_PORT;
+  rtpsrc->buffer_size = DEFAULT_PROP_BUFFER_SIZE;
+  rtpsrc->batch_size = DEFAULT_PROP_BATCH_SIZE;
+  rtpsrc->pool_size = DEFAULT_PROP_POOL_SIZE;
+  rtpsrc->receiver = NULL;
+  rtpsrc->rtcp_receiver = NULL;
+  rtpsrc->latency_clock_id = NULL;
+  rtpsrc->stats_interval = DEFAULT_PROP_STATS_INTERVAL;
+  rtpsrc->stats_clock_id = NULL;
+  rtpsrc->appsrc = NULL;
+  rtpsrc->rtcp_appsrc = NULL;
   rtpsrc->rtpbin = NULL;
+  rtpsrc->capsfilter = NULL;
+  rtpsrc->depay = NULL;
   rtpsrc->n_pads = 0;
+  rtpsrc->sniff_pt = -1;
+  rtpsrc->sniff_encoding = NULL;
+  rtpsrc->pt_encoding = NULL;
+  g_mutex_init(&rtpsrc->latency_lock);
+  rtpsrc->latency = DEFAULT_PROP_LATENCY;
+  rtpsrc->adaptive_latency = DEFAULT_PROP_ADAPTIVE_LATENCY;
+  rtpsrc->min_latency = DEFAULT_PROP_MIN_LATENCY;
+  rtpsrc->max_latency = DEFAULT_PROP_MAX_LATENCY;
+  rtpsrc->late_threshold = DEFAULT_PROP_LATE_THRESHOLD;
+  rtpsrc->jitterbuffer = NULL;
+  rtpsrc->selector = NULL;
+  rtpsrc->ssrcs = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+    gst_omvp_rtpsrc_free_ssrc);
 
   GST_DEBUG_OBJECT(rtpsrc, "omvprtpsrc initialized");
 }
@@ -222,20 +584,89 @@ static void gst_omvp_rtpsrc_set_property(GObject *object, guint prop_id,
 
   switch (prop_id) {
     case PROP_URI:
+      GST_OBJECT_LOCK(rtpsrc);
       g_free(rtpsrc->uri);
       rtpsrc->uri = g_strdup(g_value_get_string(value));
-      if (rtpsrc->udpsrc) {
-        gchar *host;
-        guint16 port;
-        if (gst_omvp_rtpsrc_parse_uri(rtpsrc->uri, &host, &port)) {
-          gchar *udpsrc_uri;
-          udpsrc_uri = g_strdup_printf("udp://%s:%u", host, port);
-          g_object_set(G_OBJECT(rtpsrc->udpsrc), "uri", udpsrc_uri, NULL);
-          g_free(host);
-          g_free(udpsrc_uri);
+      gst_omvp_rtpsrc_parse_uri_params(rtpsrc, rtpsrc->uri);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_CAPS:
+      {
+        const GstCaps *new_caps;
+        GstCaps *old_caps;
+        new_caps = gst_value_get_caps(value);
+        GST_OBJECT_LOCK(rtpsrc);
+        old_caps = rtpsrc->caps;
+        rtpsrc->caps = new_caps ? gst_caps_copy(new_caps) : NULL;
+        GST_OBJECT_UNLOCK(rtpsrc);
+        if (old_caps) {
+          gst_caps_unref(old_caps);
         }
       }
       break;
+    case PROP_PAYLOAD:
+      GST_OBJECT_LOCK(rtpsrc);
+      rtpsrc->payload = g_value_get_int(value);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_ENCODING_NAME:
+      GST_OBJECT_LOCK(rtpsrc);
+      g_free(rtpsrc->encoding_name);
+      rtpsrc->encoding_name = g_value_dup_string(value);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_CLOCK_RATE:
+      GST_OBJECT_LOCK(rtpsrc);
+      rtpsrc->clock_rate = g_value_get_int(value);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_PROGRAM:
+      GST_OBJECT_LOCK(rtpsrc);
+      rtpsrc->program = g_value_get_int(value);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_RTCP_PORT:
+      GST_OBJECT_LOCK(rtpsrc);
+      rtpsrc->rtcp_port = g_value_get_int(value);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_BUFFER_SIZE:
+      rtpsrc->buffer_size = g_value_get_int(value);
+      break;
+    case PROP_BATCH_SIZE:
+      rtpsrc->batch_size = g_value_get_uint(value);
+      break;
+    case PROP_POOL_SIZE:
+      rtpsrc->pool_size = g_value_get_uint(value);
+      break;
+    case PROP_LATENCY:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      rtpsrc->latency = g_value_get_uint(value);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_ADAPTIVE_LATENCY:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      rtpsrc->adaptive_latency = g_value_get_boolean(value);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_MIN_LATENCY:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      rtpsrc->min_latency = g_value_get_uint(value);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_MAX_LATENCY:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      rtpsrc->max_latency = g_value_get_uint(value);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_LATE_THRESHOLD:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      rtpsrc->late_threshold = g_value_get_double(value);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_STATS_INTERVAL:
+      rtpsrc->stats_interval = g_value_get_uint(value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -250,6 +681,60 @@ static void gst_omvp_rtpsrc_get_property(GObject *object, guint prop_id,
     case PROP_URI:
       g_value_set_string(value, rtpsrc->uri);
       break;
+    case PROP_CAPS:
+      GST_OBJECT_LOCK(rtpsrc);
+      gst_value_set_caps(value, rtpsrc->caps);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_PAYLOAD:
+      g_value_set_int(value, rtpsrc->payload);
+      break;
+    case PROP_ENCODING_NAME:
+      GST_OBJECT_LOCK(rtpsrc);
+      g_value_set_string(value, rtpsrc->encoding_name);
+      GST_OBJECT_UNLOCK(rtpsrc);
+      break;
+    case PROP_CLOCK_RATE:
+      g_value_set_int(value, rtpsrc->clock_rate);
+      break;
+    case PROP_PROGRAM:
+      g_value_set_int(value, rtpsrc->program);
+      break;
+    case PROP_RTCP_PORT:
+      g_value_set_int(value, rtpsrc->rtcp_port);
+      break;
+    case PROP_BUFFER_SIZE:
+      g_value_set_int(value, rtpsrc->buffer_size);
+      break;
+    case PROP_BATCH_SIZE:
+      g_value_set_uint(value, rtpsrc->batch_size);
+      break;
+    case PROP_POOL_SIZE:
+      g_value_set_uint(value, rtpsrc->pool_size);
+      break;
+    case PROP_LATENCY:
+      g_mutex_lock(&rtpsrc->latency_lock);
+      g_value_set_uint(value, rtpsrc->latency);
+      g_mutex_unlock(&rtpsrc->latency_lock);
+      break;
+    case PROP_ADAPTIVE_LATENCY:
+      g_value_set_boolean(value, rtpsrc->adaptive_latency);
+      break;
+    case PROP_MIN_LATENCY:
+      g_value_set_uint(value, rtpsrc->min_latency);
+      break;
+    case PROP_MAX_LATENCY:
+      g_value_set_uint(value, rtpsrc->max_latency);
+      break;
+    case PROP_LATE_THRESHOLD:
+      g_value_set_double(value, rtpsrc->late_threshold);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed(value, gst_omvp_rtpsrc_get_stats(rtpsrc));
+      break;
+    case PROP_STATS_INTERVAL:
+      g_value_set_uint(value, rtpsrc->stats_interval);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
       break;
@@ -261,24 +746,718 @@ static void gst_omvp_rtpsrc_finalize(GObject *gobject) {
 
   g_free(rtpsrc->uri);
   rtpsrc->uri = NULL;
-  rtpsrc->udpsrc = NULL;
+  if (rtpsrc->caps) {
+    gst_caps_unref(rtpsrc->caps);
+    rtpsrc->caps = NULL;
+  }
+  g_free(rtpsrc->encoding_name);
+  rtpsrc->encoding_name = NULL;
+  gst_omvp_rtpsrc_stop(rtpsrc);
+  rtpsrc->appsrc = NULL;
+  rtpsrc->rtcp_appsrc = NULL;
   rtpsrc->rtpbin = NULL;
+  rtpsrc->selector = NULL;
+  rtpsrc->capsfilter = NULL;
+  rtpsrc->depay = NULL;
   rtpsrc->n_pads = 0;
+  g_hash_table_destroy(rtpsrc->ssrcs);
+  g_mutex_clear(&rtpsrc->latency_lock);
 
   G_OBJECT_CLASS(parent_class)->finalize(gobject);
 }
 
+static GstStructure *gst_omvp_rtpsrc_get_stats(GstOMVPRtpSrc *rtpsrc) {
+  OMVPRecvStats stats;
+  guint latency;
+  guint jitter;
+  gint e2e_latency;
+  gdouble drift;
+  guint ssrc;
+  guint num_ssrcs;
+  guint64 ssrc_switches;
+
+  memset(&stats, 0, sizeof(stats));
+  GST_OBJECT_LOCK(rtpsrc);
+  if (rtpsrc->receiver) {
+    omvp_recv_get_stats(rtpsrc->receiver, &stats);
+  }
+  GST_OBJECT_UNLOCK(rtpsrc);
+
+  /* raw MPEG-TS has no jitterbuffer */
+  g_mutex_lock(&rtpsrc->latency_lock);
+  latency = rtpsrc->latency_clock_id ? rtpsrc->latency : 0;
+  jitter = (guint)rtpsrc->jitter;
+  /* capture to jitterbuffer output, assuming NTP synced clocks */
+  e2e_latency = rtpsrc->has_transit ?
+    (gint)(rtpsrc->transit / 1000) + (gint)rtpsrc->latency : -1;
+  drift = rtpsrc->drift;
+  ssrc = rtpsrc->has_active_ssrc ? rtpsrc->active_ssrc : 0;
+  num_ssrcs = g_hash_table_size(rtpsrc->ssrcs);
+  ssrc_switches = rtpsrc->ssrc_switches;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+
+  return gst_structure_new("omvprtpsrc-stats",
+    "packets-received", G_TYPE_UINT64, stats.num_packets,
+    "bytes-received", G_TYPE_UINT64, stats.num_bytes,
+    "batches", G_TYPE_UINT64, stats.num_batches,
+    "truncated", G_TYPE_UINT64, stats.num_truncated,
+    "pool-drops", G_TYPE_UINT64, stats.num_pool_drops,
+    "kernel-drops", G_TYPE_UINT64, stats.num_kernel_drops,
+    "buffer-size", G_TYPE_INT, stats.buffer_size,
+    "latency", G_TYPE_UINT, latency,
+    "jitter", G_TYPE_UINT, jitter,
+    "end-to-end-latency", G_TYPE_INT, e2e_latency,
+    "clock-drift", G_TYPE_DOUBLE, drift,
+    "ssrc", G_TYPE_UINT, ssrc,
+    "ssrc-count", G_TYPE_UINT, num_ssrcs,
+    "ssrc-switches", G_TYPE_UINT64, ssrc_switches,
+    NULL);
+}
+
+static void gst_omvp_rtpsrc_recv_cb(GstBuffer *buffer, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+
+  /* a replayed GOP arrives at once and says nothing about the network */
+  if (!GST_BUFFER_FLAG_IS_SET(buffer, OMVP_RECV_BUFFER_FLAG_CACHED)) {
+    gst_omvp_rtpsrc_measure(rtpsrc, buffer);
+  }
+  gst_app_src_push_buffer(GST_APP_SRC(rtpsrc->appsrc), buffer);
+}
+
+static void gst_omvp_rtpsrc_measure(GstOMVPRtpSrc *rtpsrc, GstBuffer *buffer) {
+  guint8 header[12];
+  guint16 seq;
+  guint32 rtp_ts;
+  guint32 ssrc;
+  GstOMVPRtpSrcSsrc *entry;
+  gint64 now;
+  gint64 delta;
+  gint64 sender_time;
+
+  if (gst_buffer_extract(buffer, 0, header, sizeof(header)) !=
+    sizeof(header) || (header[0] >> 6) != 2) {
+    return;
+  }
+  seq = GST_READ_UINT16_BE(header + 2);
+  rtp_ts = GST_READ_UINT32_BE(header + 4);
+  ssrc = GST_READ_UINT32_BE(header + 8);
+  now = g_get_monotonic_time();
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  entry = g_hash_table_lookup(rtpsrc->ssrcs, GUINT_TO_POINTER(ssrc));
+  if (!entry && g_hash_table_size(rtpsrc->ssrcs) < SSRC_MAX) {
+    entry = gst_omvp_rtpsrc_add_ssrc(rtpsrc, ssrc);
+  }
+  if (entry) {
+    entry->window_packets++;
+  }
+  /* only the selected source is measured */
+  if (!rtpsrc->has_active_ssrc || rtpsrc->active_ssrc != ssrc) {
+    g_mutex_unlock(&rtpsrc->latency_lock);
+    return;
+  }
+
+  if (!rtpsrc->has_last) {
+    rtpsrc->has_last = TRUE;
+    rtpsrc->max_seq = seq;
+    rtpsrc->max_seq_arrival = now;
+  } else if ((gint16)(seq - rtpsrc->max_seq) > 0) {
+    /* RFC 3550 interarrival jitter, in microseconds */
+    delta = (now - rtpsrc->last_arrival) -
+      (gint64)(gint32)(rtp_ts - rtpsrc->last_rtp_ts) * G_USEC_PER_SEC /
+      (rtpsrc->rtp_clock_rate > 0 ? rtpsrc->rtp_clock_rate : 90000);
+    rtpsrc->jitter += (ABS(delta) - rtpsrc->jitter) / 16.0;
+    rtpsrc->max_seq = seq;
+    rtpsrc->max_seq_arrival = now;
+  } else {
+    /* a reordered packet needs the jitterbuffer to wait this long */
+    rtpsrc->window_reorder = MAX(rtpsrc->window_reorder,
+      now - rtpsrc->max_seq_arrival);
+    g_mutex_unlock(&rtpsrc->latency_lock);
+    return;
+  }
+  rtpsrc->last_rtp_ts = rtp_ts;
+  rtpsrc->last_arrival = now;
+
+  if (rtpsrc->has_sr && rtpsrc->sr_ssrc == ssrc) {
+    /* the sender time of the packet from the last sender report */
+    sender_time = rtpsrc->sr_ntp_time +
+      (gint64)(gint32)(rtp_ts - rtpsrc->sr_rtp_ts) * G_USEC_PER_SEC /
+      (rtpsrc->rtp_clock_rate > 0 ? rtpsrc->rtp_clock_rate : 90000);
+    delta = g_get_real_time() - sender_time;
+    if (!rtpsrc->has_transit) {
+      rtpsrc->has_transit = TRUE;
+      rtpsrc->transit = delta;
+    }
+    rtpsrc->transit += (delta - rtpsrc->transit) / 16.0;
+  }
+  g_mutex_unlock(&rtpsrc->latency_lock);
+}
+
+static void gst_omvp_rtpsrc_rtcp_recv_cb(GstBuffer *buffer, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GstMapInfo map;
+
+  if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    gst_omvp_rtpsrc_parse_rtcp(rtpsrc, map.data, map.size);
+    gst_buffer_unmap(buffer, &map);
+  }
+  gst_app_src_push_buffer(GST_APP_SRC(rtpsrc->rtcp_appsrc), buffer);
+}
+
+static void gst_omvp_rtpsrc_parse_rtcp(GstOMVPRtpSrc *rtpsrc,
+  const guint8 *data, gsize size) {
+  gsize len;
+  guint32 ssrc;
+  gint64 ntp_time;
+  gint64 now;
+
+  /* a compound packet holds one sender report per sender at most */
+  for (; size >= 4 && (data[0] >> 6) == 2; data += len, size -= len) {
+    len = (GST_READ_UINT16_BE(data + 2) + 1) * 4;
+    if (len > size) {
+      return;
+    }
+    if (data[1] != 200 || len < 28) {
+      continue;
+    }
+    ssrc = GST_READ_UINT32_BE(data + 4);
+    ntp_time = ((gint64)GST_READ_UINT32_BE(data + 8) - NTP_UNIX_OFFSET) *
+      G_USEC_PER_SEC +
+      (((gint64)GST_READ_UINT32_BE(data + 12) * G_USEC_PER_SEC) >> 32);
+    now = g_get_real_time();
+
+    g_mutex_lock(&rtpsrc->latency_lock);
+    if (!rtpsrc->has_sr || rtpsrc->sr_ssrc != ssrc) {
+      GST_DEBUG_OBJECT(rtpsrc, "first sender report of SSRC %08x", ssrc);
+      rtpsrc->has_sr = TRUE;
+      rtpsrc->sr_ssrc = ssrc;
+      rtpsrc->first_sr_ntp_time = ntp_time;
+      rtpsrc->first_sr_arrival = now;
+      rtpsrc->has_transit = FALSE;
+      rtpsrc->drift = 0;
+    } else if (ntp_time - rtpsrc->first_sr_ntp_time >= DRIFT_MIN_SPAN) {
+      /* our clock against the sender clock, over all reports so far */
+      rtpsrc->drift = ((gdouble)(now - rtpsrc->first_sr_arrival) /
+        (ntp_time - rtpsrc->first_sr_ntp_time) - 1.0) * 1000000.0;
+    }
+    rtpsrc->sr_ntp_time = ntp_time;
+    rtpsrc->sr_rtp_ts = GST_READ_UINT32_BE(data + 16);
+    g_mutex_unlock(&rtpsrc->latency_lock);
+  }
+}
+
+/* called with latency_lock, returns TRUE if the latency changed */
+static gboolean gst_omvp_rtpsrc_update_latency(GstOMVPRtpSrc *rtpsrc,
+  guint64 num_pushed, guint64 num_late) {
+  guint64 pushed, late;
+  guint latency, target, lowest;
+  gboolean is_late;
+
+  /* a new jitterbuffer starts its counters again */
+  if (num_pushed < rtpsrc->last_pushed || num_late < rtpsrc->last_late) {
+    rtpsrc->last_pushed = 0;
+    rtpsrc->last_late = 0;
+  }
+  pushed = num_pushed - rtpsrc->last_pushed;
+  late = num_late - rtpsrc->last_late;
+  rtpsrc->last_pushed = num_pushed;
+  rtpsrc->last_late = num_late;
+
+  rtpsrc->reorder = MAX(rtpsrc->window_reorder,
+    rtpsrc->reorder - rtpsrc->reorder / 8);
+  rtpsrc->window_reorder = 0;
+  if (rtpsrc->latency_floor > 0) {
+    rtpsrc->latency_floor--;
+  }
+  if (!rtpsrc->adaptive_latency || pushed + late == 0) {
+    return FALSE;
+  }
+
+  target = (guint)((3 * rtpsrc->jitter + 1.25 * rtpsrc->reorder) / 1000);
+  latency = rtpsrc->latency;
+  is_late = late > rtpsrc->late_threshold * (pushed + late);
+  if (is_late) {
+    /* the latency that was too low, not the raised one */
+    rtpsrc->latency_floor = latency;
+    latency += MAX(latency / 2, LATENCY_STEP);
+    rtpsrc->clean_windows = 0;
+  } else if (target > latency) {
+    latency = target;
+    rtpsrc->clean_windows = 0;
+  } else if (++rtpsrc->clean_windows >= LATENCY_CLEAN_WINDOWS) {
+    /* approach the lowest latency that was still clean */
+    lowest = MAX(target, rtpsrc->latency_floor);
+    if (latency > lowest) {
+      latency -= (latency - lowest + 1) / 2;
+    }
+    rtpsrc->clean_windows = 0;
+  }
+  latency = CLAMP(latency, rtpsrc->min_latency,
+    MAX(rtpsrc->min_latency, rtpsrc->max_latency));
+
+  /* every change makes the pipeline recompute its latency */
+  if (latency == rtpsrc->latency || (!is_late &&
+    latency + LATENCY_MIN_CHANGE > rtpsrc->latency &&
+    latency < rtpsrc->latency + LATENCY_MIN_CHANGE)) {
+    return FALSE;
+  }
+  GST_DEBUG_OBJECT(rtpsrc, "latency %u -> %u ms (late %" G_GUINT64_FORMAT
+    "/%" G_GUINT64_FORMAT ", jitter %u us, reorder %" G_GINT64_FORMAT " us)",
+    rtpsrc->latency, latency, late, pushed + late, (guint)rtpsrc->jitter,
+    rtpsrc->reorder);
+  rtpsrc->latency = latency;
+
+  return TRUE;
+}
+
+static gboolean gst_omvp_rtpsrc_latency_cb(GstClock *clock,
+  GstClockTime time, GstClockID id, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GstElement *jitterbuffer;
+  GstStructure *stats;
+  GstPad *selector_pad;
+  guint64 num_pushed, num_late;
+  gboolean changed;
+  guint latency;
+
+  (void)clock;
+  (void)time;
+  (void)id;
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  selector_pad = gst_omvp_rtpsrc_update_ssrcs(rtpsrc);
+  jitterbuffer = rtpsrc->jitterbuffer ?
+    gst_object_ref(rtpsrc->jitterbuffer) : NULL;
+  latency = rtpsrc->latency;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  if (selector_pad) {
+    g_object_set(G_OBJECT(rtpsrc->selector), "active-pad", selector_pad,
+      NULL);
+    gst_object_unref(selector_pad);
+    /* the latency may have changed since the stream was created */
+    if (jitterbuffer) {
+      g_object_set(G_OBJECT(jitterbuffer), "latency", latency, NULL);
+    }
+  }
+  if (!jitterbuffer) {
+    return TRUE;
+  }
+
+  num_pushed = 0;
+  num_late = 0;
+  g_object_get(G_OBJECT(jitterbuffer), "stats", &stats, NULL);
+  if (stats) {
+    gst_structure_get_uint64(stats, "num-pushed", &num_pushed);
+    gst_structure_get_uint64(stats, "num-late", &num_late);
+    gst_structure_free(stats);
+  }
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  changed = gst_omvp_rtpsrc_update_latency(rtpsrc, num_pushed, num_late);
+  latency = rtpsrc->latency;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  if (changed) {
+    g_object_set(G_OBJECT(jitterbuffer), "latency", latency, NULL);
+  }
+  gst_object_unref(jitterbuffer);
+
+  return TRUE;
+}
+
+/*
+  The stats are pushed to the application as element messages, so it keeps
+  the last ones instead of querying the element.
+*/
+static gboolean gst_omvp_rtpsrc_stats_cb(GstClock *clock,
+  GstClockTime time, GstClockID id, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+
+  (void)clock;
+  (void)time;
+  (void)id;
+
+  gst_element_post_message(GST_ELEMENT(rtpsrc),
+    gst_message_new_element(GST_OBJECT(rtpsrc),
+    gst_omvp_rtpsrc_get_stats(rtpsrc)));
+
+  return TRUE;
+}
+
+/* called with latency_lock */
+static GstOMVPRtpSrcSsrc *gst_omvp_rtpsrc_add_ssrc(GstOMVPRtpSrc *rtpsrc,
+  guint32 ssrc) {
+  GstOMVPRtpSrcSsrc *entry;
+
+  entry = g_malloc0(sizeof(GstOMVPRtpSrcSsrc));
+  entry->ssrc = ssrc;
+  g_hash_table_insert(rtpsrc->ssrcs, GUINT_TO_POINTER(ssrc), entry);
+
+  return entry;
+}
+
+static void gst_omvp_rtpsrc_free_ssrc(gpointer data) {
+  GstOMVPRtpSrcSsrc *entry = (GstOMVPRtpSrcSsrc *)data;
+
+  if (entry->pad) {
+    gst_object_unref(entry->pad);
+  }
+  if (entry->selector_pad) {
+    gst_object_unref(entry->selector_pad);
+  }
+  if (entry->jitterbuffer) {
+    gst_object_unref(entry->jitterbuffer);
+  }
+  g_free(entry);
+}
+
+/*
+  called with latency_lock once per interval. Another source is selected
+  once it got more than twice the packets of the active one for a few
+  intervals, so a restarted encoder wins but two live senders don't flip.
+  Returns the selector pad to activate.
+*/
+static GstPad *gst_omvp_rtpsrc_update_ssrcs(GstOMVPRtpSrc *rtpsrc) {
+  GHashTableIter iter;
+  GstOMVPRtpSrcSsrc *entry;
+  GstOMVPRtpSrcSsrc *active;
+  GstOMVPRtpSrcSsrc *best;
+  guint active_rate;
+  guint switch_windows;
+
+  active = rtpsrc->has_active_ssrc ? g_hash_table_lookup(rtpsrc->ssrcs,
+    GUINT_TO_POINTER(rtpsrc->active_ssrc)) : NULL;
+  active_rate = active ? active->window_packets : 0;
+  switch_windows = active ? SSRC_SWITCH_WINDOWS : 1;
+
+  best = NULL;
+  g_hash_table_iter_init(&iter, rtpsrc->ssrcs);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&entry)) {
+    entry->rate = entry->window_packets;
+    entry->window_packets = 0;
+    entry->idle_windows = entry->rate ? 0 : entry->idle_windows + 1;
+    /* rtpbin times out and removes the streams it created itself */
+    if (!entry->selector_pad && entry->idle_windows >= SSRC_IDLE_WINDOWS) {
+      g_hash_table_iter_remove(&iter);
+      continue;
+    }
+    if (entry != active && entry->selector_pad &&
+      entry->rate > 2 * active_rate) {
+      entry->better_windows++;
+    } else {
+      entry->better_windows = 0;
+    }
+    if (entry->better_windows >= switch_windows &&
+      (!best || entry->rate > best->rate)) {
+      best = entry;
+    }
+  }
+  if (!best) {
+    return NULL;
+  }
+
+  GST_INFO_OBJECT(rtpsrc, "switching to SSRC %08x (%u packets/s, was %u)",
+    best->ssrc, best->rate, active_rate);
+  best->better_windows = 0;
+  rtpsrc->has_active_ssrc = TRUE;
+  rtpsrc->active_ssrc = best->ssrc;
+  rtpsrc->ssrc_switches++;
+  rtpsrc->has_last = FALSE;
+  rtpsrc->has_transit = FALSE;
+  rtpsrc->last_pushed = 0;
+  rtpsrc->last_late = 0;
+  if (rtpsrc->jitterbuffer) {
+    gst_object_unref(rtpsrc->jitterbuffer);
+  }
+  rtpsrc->jitterbuffer = best->jitterbuffer ?
+    gst_object_ref(best->jitterbuffer) : NULL;
+
+  return gst_object_ref(best->selector_pad);
+}
+
+static void gst_omvp_rtpsrc_sniff(GstOMVPRtpSrc *rtpsrc, const guint8 *data,
+  gsize size) {
+  gsize offset;
+  gint pt;
+  const guint8 *payload;
+  gsize payload_size;
+  guint type;
+  gboolean h264, h265;
+
+  if (size < 12 || (data[0] >> 6) != 2) {
+    return;
+  }
+  offset = 12 + (data[0] & 0x0f) * 4;
+  if (data[0] & 0x10) {
+    if (offset + 4 > size) {
+      return;
+    }
+    offset += 4 + ((data[offset + 2] << 8) | data[offset + 3]) * 4;
+  }
+  if (data[0] & 0x20) {
+    size = data[size - 1] < size ? size - data[size - 1] : 0;
+  }
+  if (offset + 2 > size) {
+    return;
+  }
+  pt = data[1] & 0x7f;
+  payload = data + offset;
+  payload_size = size - offset;
+
+  if (pt != rtpsrc->sniff_pt) {
+    rtpsrc->sniff_pt = pt;
+    rtpsrc->sniff_h264 = 0;
+    rtpsrc->sniff_h265 = 0;
+  }
+
+  rtpsrc->sniff_encoding = gst_omvp_rtpsrc_find_static_payload(pt);
+  if (rtpsrc->sniff_encoding) {
+    rtpsrc->sniff_done = TRUE;
+    return;
+  }
+  if (payload[0] == 0x47 && payload_size % 188 == 0) {
+    rtpsrc->sniff_encoding = "MP2T";
+    rtpsrc->sniff_done = TRUE;
+    return;
+  }
+
+  /* NAL unit types seen in RFC 6184 and RFC 7798 streams */
+  type = payload[0] & 0x1f;
+  h264 = !(payload[0] & 0x80) &&
+    ((type >= 1 && type <= 9) || type == 24 || type == 28);
+  type = (payload[0] >> 1) & 0x3f;
+  h265 = !(payload[0] & 0x81) && (payload[1] >> 3) == 0 &&
+    (payload[1] & 0x07) != 0 && (type <= 9 || (type >= 16 && type <= 21) ||
+    (type >= 32 && type <= 40) || type == 48 || type == 49);
+  if (h264 && !h265) {
+    rtpsrc->sniff_h264++;
+  } else if (h265 && !h264) {
+    rtpsrc->sniff_h265++;
+  }
+  if (rtpsrc->sniff_h264 >= SNIFF_VOTES) {
+    rtpsrc->sniff_encoding = "H264";
+    rtpsrc->sniff_done = TRUE;
+  } else if (rtpsrc->sniff_h265 >= SNIFF_VOTES) {
+    rtpsrc->sniff_encoding = "H265";
+    rtpsrc->sniff_done = TRUE;
+  }
+}
+
+static gboolean gst_omvp_rtpsrc_is_rtp(const guint8 *data, gsize size) {
+  return size >= 12 && (data[0] >> 6) == 2;
+}
+
+static gboolean gst_omvp_rtpsrc_is_ts(const guint8 *data, gsize size) {
+  return size >= 188 && size % 188 == 0 && data[0] == 0x47 &&
+    (size < 376 || data[188] == 0x47);
+}
+
+static GstPadProbeReturn gst_omvp_rtpsrc_sniff_probe(GstPad *pad,
+  GstPadProbeInfo *info, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GstBuffer *buffer;
+  GstMapInfo map;
+
+  (void)pad;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+  if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    return GST_PAD_PROBE_DROP;
+  }
+
+  if (!rtpsrc->capsfilter) {
+    /* the appsrc pad is linked here, before the buffer is pushed */
+    if (gst_omvp_rtpsrc_is_ts(map.data, map.size)) {
+      gst_buffer_unmap(buffer, &map);
+      GST_DEBUG_OBJECT(rtpsrc, "detected raw MPEG-TS after %u packets",
+        rtpsrc->sniff_packets);
+      if (!gst_omvp_rtpsrc_start_ts(rtpsrc)) {
+        GST_ELEMENT_ERROR(rtpsrc, CORE, MISSING_PLUGIN, (NULL),
+          ("Could not create the MPEG-TS elements"));
+        return GST_PAD_PROBE_DROP;
+      }
+      return GST_PAD_PROBE_REMOVE;
+    }
+    if (!gst_omvp_rtpsrc_is_rtp(map.data, map.size) &&
+      ++rtpsrc->sniff_packets < SNIFF_MAX_PACKETS) {
+      gst_buffer_unmap(buffer, &map);
+      return GST_PAD_PROBE_DROP;
+    }
+    if (!gst_omvp_rtpsrc_start_rtp(rtpsrc)) {
+      gst_buffer_unmap(buffer, &map);
+      GST_ELEMENT_ERROR(rtpsrc, CORE, MISSING_PLUGIN, (NULL),
+        ("Could not create the RTP elements"));
+      return GST_PAD_PROBE_DROP;
+    }
+    rtpsrc->sniff_packets = 0;
+  }
+
+  if (!rtpsrc->sniff_done) {
+    gst_omvp_rtpsrc_sniff(rtpsrc, map.data, map.size);
+    rtpsrc->sniff_packets++;
+    if (!rtpsrc->sniff_done && rtpsrc->sniff_packets >= SNIFF_MAX_PACKETS) {
+      if (rtpsrc->sniff_h264 || rtpsrc->sniff_h265) {
+        rtpsrc->sniff_encoding =
+          rtpsrc->sniff_h264 >= rtpsrc->sniff_h265 ? "H264" : "H265";
+      }
+      rtpsrc->sniff_done = TRUE;
+    }
+    if (rtpsrc->sniff_done) {
+      GST_DEBUG_OBJECT(rtpsrc, "detected payload %d (%s) after %u packets",
+        rtpsrc->sniff_pt, GST_STR_NULL(rtpsrc->sniff_encoding),
+        rtpsrc->sniff_packets);
+    }
+  }
+  gst_buffer_unmap(buffer, &map);
+
+  if (!rtpsrc->sniff_done) {
+    /* rtpbin asks for the payload caps with the first packet it gets */
+    return GST_PAD_PROBE_DROP;
+  }
+
+  return GST_PAD_PROBE_REMOVE;
+}
+
+static GstCaps *gst_omvp_rtpsrc_rtpbin_request_pt_map_cb(GstElement *element,
+  guint session, guint pt, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  const GstOMVPRtpSrcEncoding *encoding;
+  const gchar *encoding_name = NULL;
+  gint clock_rate;
+  GstCaps *caps;
+
+  (void)element;
+  (void)session;
+
+  GST_OBJECT_LOCK(rtpsrc);
+  if (rtpsrc->caps) {
+    caps = gst_caps_copy(rtpsrc->caps);
+    gst_caps_set_simple(caps, "payload", G_TYPE_INT, pt, NULL);
+    rtpsrc->pt_encoding = g_intern_string(gst_structure_get_string(
+      gst_caps_get_structure(caps, 0), "encoding-name"));
+    GST_OBJECT_UNLOCK(rtpsrc);
+    return caps;
+  }
+  if (rtpsrc->encoding_name &&
+    (rtpsrc->payload < 0 || rtpsrc->payload == (gint)pt)) {
+    encoding_name = g_intern_string(rtpsrc->encoding_name);
+  }
+  if (!encoding_name) {
+    encoding_name = gst_omvp_rtpsrc_find_static_payload(pt);
+  }
+  if (!encoding_name && rtpsrc->sniff_pt == (gint)pt) {
+    encoding_name = rtpsrc->sniff_encoding;
+  }
+  clock_rate = rtpsrc->clock_rate;
+  rtpsrc->pt_encoding = encoding_name;
+  GST_OBJECT_UNLOCK(rtpsrc);
+
+  encoding = gst_omvp_rtpsrc_find_encoding(encoding_name);
+  if (clock_rate <= 0) {
+    clock_rate = encoding ? encoding->clock_rate : 90000;
+  }
+  g_mutex_lock(&rtpsrc->latency_lock);
+  rtpsrc->rtp_clock_rate = clock_rate;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  caps = gst_caps_new_simple("application/x-rtp",
+    "media", G_TYPE_STRING, encoding ? encoding->media : "video",
+    "clock-rate", G_TYPE_INT, clock_rate,
+    "payload", G_TYPE_INT, pt,
+    NULL);
+  if (encoding_name) {
+    gst_caps_set_simple(caps, "encoding-name", G_TYPE_STRING, encoding_name,
+      NULL);
+  }
+  GST_DEBUG_OBJECT(rtpsrc, "caps for payload %u: %" GST_PTR_FORMAT, pt, caps);
+
+  return caps;
+}
+
+static GstElement *gst_omvp_rtpsrc_make_depay(GstOMVPRtpSrc *rtpsrc) {
+  const GstOMVPRtpSrcEncoding *encoding;
+  GstElement *depay;
+
+  GST_OBJECT_LOCK(rtpsrc);
+  encoding = gst_omvp_rtpsrc_find_encoding(rtpsrc->pt_encoding);
+  GST_OBJECT_UNLOCK(rtpsrc);
+  if (!encoding) {
+    return NULL;
+  }
+
+  depay = gst_element_factory_make(encoding->depay, NULL);
+  if (!depay) {
+    GST_WARNING_OBJECT(rtpsrc, "No %s, leaving %s to decodebin",
+      encoding->depay, encoding->encoding_name);
+    return NULL;
+  }
+
+  gst_bin_add(GST_BIN(rtpsrc), depay);
+  if (!gst_element_sync_state_with_parent(depay)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set %s to playing", encoding->depay);
+  }
+
+  return depay;
+}
+
+static void gst_omvp_rtpsrc_expose_pad(GstOMVPRtpSrc *rtpsrc,
+  GstPad *target) {
+  rtpsrc->ghostpad = gst_ghost_pad_new("src", target);
+  gst_pad_set_active(rtpsrc->ghostpad, TRUE);
+  gst_element_add_pad(GST_ELEMENT(rtpsrc), rtpsrc->ghostpad);
+
+  rtpsrc->n_pads++;
+
+  gst_element_no_more_pads(GST_ELEMENT(rtpsrc));
+}
+
+static gboolean gst_omvp_rtpsrc_start_selector(GstOMVPRtpSrc *rtpsrc) {
+  GstPad *target;
+  GstPad *sinkpad;
+
+  rtpsrc->selector = gst_element_factory_make("input-selector", NULL);
+  if (!rtpsrc->selector) {
+    return FALSE;
+  }
+  /* packets of the other sources are dropped instead of waiting */
+  g_object_set(G_OBJECT(rtpsrc->selector), "sync-streams", FALSE, NULL);
+  gst_bin_add(GST_BIN(rtpsrc), rtpsrc->selector);
+  if (!gst_element_sync_state_with_parent(rtpsrc->selector)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set input-selector to playing");
+  }
+
+  target = gst_element_get_static_pad(rtpsrc->selector, "src");
+  rtpsrc->depay = gst_omvp_rtpsrc_make_depay(rtpsrc);
+  if (rtpsrc->depay) {
+    sinkpad = gst_element_get_static_pad(rtpsrc->depay, "sink");
+    gst_pad_link(target, sinkpad);
+    gst_object_unref(sinkpad);
+    gst_object_unref(target);
+    target = gst_element_get_static_pad(rtpsrc->depay, "src");
+  }
+
+  gst_omvp_rtpsrc_expose_pad(rtpsrc, target);
+  gst_object_unref(target);
+
+  return TRUE;
+}
+
 static void gst_omvp_rtpsrc_rtpbin_pad_added_cb(GstElement *element,
   GstPad *pad, gpointer data) {
   gchar *name;
   GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GstOMVPRtpSrcSsrc *entry;
+  GstPad *sinkpad;
+  GstPad *old_sinkpad;
+  guint session, ssrc, pt;
+  gboolean first;
+  gboolean activate;
 
   (void)element;
 
   name = gst_pad_get_name(pad);
   GST_DEBUG_OBJECT(rtpsrc, "adding a pad %s", name);
 
-  if (strncmp(name, "recv_rtp_src_", strlen("recv_rtp_src_")) != 0) {
+  if (sscanf(name, "recv_rtp_src_%u_%u_%u", &session, &ssrc, &pt) != 3) {
     g_free(name);
     GST_DEBUG_OBJECT(rtpsrc, "Pad name does not start with recv_rtp_src_");
     return;
@@ -290,79 +1469,442 @@ static void gst_omvp_rtpsrc_rtpbin_pad_added_cb(GstElement *element,
     return;
   }
 
-  gst_object_ref(pad);
+  if (!rtpsrc->selector && !gst_omvp_rtpsrc_start_selector(rtpsrc)) {
+    GST_ELEMENT_ERROR(rtpsrc, CORE, MISSING_PLUGIN, (NULL),
+      ("Could not create input-selector"));
+    return;
+  }
 
-  if (rtpsrc->n_pads) {
-    GST_DEBUG_OBJECT(rtpsrc, "Ignore SSRC");
-    gst_ghost_pad_set_target(GST_GHOST_PAD(rtpsrc->ghostpad), pad);
-    gst_object_unref(pad);
+  sinkpad = gst_element_get_request_pad(rtpsrc->selector, "sink_%u");
+  if (gst_pad_link(pad, sinkpad) != GST_PAD_LINK_OK) {
+    GST_WARNING_OBJECT(rtpsrc, "Could not link SSRC %08x", ssrc);
+    gst_element_release_request_pad(rtpsrc->selector, sinkpad);
+    gst_object_unref(sinkpad);
     return;
   }
 
-  rtpsrc->ghostpad = gst_ghost_pad_new("src", pad);
-  gst_pad_set_active(rtpsrc->ghostpad, TRUE);
-  gst_element_add_pad(GST_ELEMENT(rtpsrc), rtpsrc->ghostpad);
-  gst_object_unref(pad);
+  g_mutex_lock(&rtpsrc->latency_lock);
+  entry = g_hash_table_lookup(rtpsrc->ssrcs, GUINT_TO_POINTER(ssrc));
+  if (!entry) {
+    entry = gst_omvp_rtpsrc_add_ssrc(rtpsrc, ssrc);
+  }
+  /* a new payload type of the same SSRC replaces its old stream */
+  old_sinkpad = entry->selector_pad;
+  if (entry->pad) {
+    gst_object_unref(entry->pad);
+  }
+  entry->pad = gst_object_ref(pad);
+  entry->selector_pad = sinkpad;
+  first = !rtpsrc->has_active_ssrc;
+  if (first) {
+    rtpsrc->has_active_ssrc = TRUE;
+    rtpsrc->active_ssrc = ssrc;
+    if (rtpsrc->jitterbuffer) {
+      gst_object_unref(rtpsrc->jitterbuffer);
+    }
+    rtpsrc->jitterbuffer = entry->jitterbuffer ?
+      gst_object_ref(entry->jitterbuffer) : NULL;
+  }
+  activate = rtpsrc->active_ssrc == ssrc;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  GST_DEBUG_OBJECT(rtpsrc, "linked SSRC %08x%s", ssrc,
+    first ? " as the active source" : "");
 
-  rtpsrc->n_pads++;
+  if (activate) {
+    g_object_set(G_OBJECT(rtpsrc->selector), "active-pad", sinkpad, NULL);
+  }
+  if (old_sinkpad) {
+    gst_element_release_request_pad(rtpsrc->selector, old_sinkpad);
+    gst_object_unref(old_sinkpad);
+  }
+}
 
-  gst_element_no_more_pads(GST_ELEMENT(rtpsrc));
+static void gst_omvp_rtpsrc_rtpbin_pad_removed_cb(GstElement *element,
+  GstPad *pad, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GHashTableIter iter;
+  GstOMVPRtpSrcSsrc *entry;
+  GstPad *sinkpad;
+
+  (void)element;
+
+  /* rtpbin removes the stream of a timed out SSRC */
+  sinkpad = NULL;
+  g_mutex_lock(&rtpsrc->latency_lock);
+  g_hash_table_iter_init(&iter, rtpsrc->ssrcs);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&entry)) {
+    if (entry->pad != pad) {
+      continue;
+    }
+    GST_DEBUG_OBJECT(rtpsrc, "removing SSRC %08x", entry->ssrc);
+    sinkpad = entry->selector_pad;
+    entry->selector_pad = NULL;
+    if (rtpsrc->has_active_ssrc && rtpsrc->active_ssrc == entry->ssrc) {
+      rtpsrc->has_active_ssrc = FALSE;
+      if (rtpsrc->jitterbuffer) {
+        gst_object_unref(rtpsrc->jitterbuffer);
+        rtpsrc->jitterbuffer = NULL;
+      }
+    }
+    g_hash_table_iter_remove(&iter);
+    break;
+  }
+  g_mutex_unlock(&rtpsrc->latency_lock);
+
+  if (sinkpad) {
+    gst_element_release_request_pad(rtpsrc->selector, sinkpad);
+    gst_object_unref(sinkpad);
+  }
+}
+
+static void gst_omvp_rtpsrc_rtpbin_new_jitterbuffer_cb(GstElement *element,
+  GstElement *jitterbuffer, guint session, guint ssrc, gpointer data) {
+  GstOMVPRtpSrc *rtpsrc = (GstOMVPRtpSrc *)data;
+  GstOMVPRtpSrcSsrc *entry;
+  GstElement *old_jitterbuffer;
+  guint latency;
+
+  (void)element;
+  (void)session;
+
+  GST_DEBUG_OBJECT(rtpsrc, "new jitterbuffer for SSRC %08x", ssrc);
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  entry = g_hash_table_lookup(rtpsrc->ssrcs, GUINT_TO_POINTER(ssrc));
+  if (!entry) {
+    entry = gst_omvp_rtpsrc_add_ssrc(rtpsrc, ssrc);
+  }
+  old_jitterbuffer = entry->jitterbuffer;
+  entry->jitterbuffer = gst_object_ref(jitterbuffer);
+  if (rtpsrc->has_active_ssrc && rtpsrc->active_ssrc == ssrc) {
+    if (rtpsrc->jitterbuffer) {
+      gst_object_unref(rtpsrc->jitterbuffer);
+    }
+    rtpsrc->jitterbuffer = gst_object_ref(jitterbuffer);
+    rtpsrc->last_pushed = 0;
+    rtpsrc->last_late = 0;
+  }
+  latency = rtpsrc->latency;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  if (old_jitterbuffer) {
+    gst_object_unref(old_jitterbuffer);
+  }
 
-  return;
+  g_object_set(G_OBJECT(jitterbuffer), "latency", latency, NULL);
 }
 
-static gboolean gst_omvp_rtpsrc_start(GstOMVPRtpSrc *rtpsrc) {
+static GstElement *gst_omvp_rtpsrc_make_capsfilter(GstOMVPRtpSrc *rtpsrc,
+  GstCaps *caps) {
+  GstElement *capsfilter;
+
+  capsfilter = gst_element_factory_make("capsfilter", NULL);
+  if (!capsfilter) {
+    gst_caps_unref(caps);
+    return NULL;
+  }
+  /* appsrc has no caps until the first datagram is seen */
+  g_object_set(G_OBJECT(capsfilter), "caps", caps, NULL);
+  gst_caps_unref(caps);
+
+  gst_bin_add(GST_BIN(rtpsrc), capsfilter);
+  gst_element_link(rtpsrc->appsrc, capsfilter);
+
+  return capsfilter;
+}
+
+static gboolean gst_omvp_rtpsrc_start_rtcp(GstOMVPRtpSrc *rtpsrc) {
   gchar *host;
   guint16 port;
+  gint rtcp_port;
   GstCaps *caps;
+  OMVPRecv receiver;
 
-  GST_DEBUG_OBJECT(rtpsrc, "Creating elements");
+  GST_OBJECT_LOCK(rtpsrc);
+  rtcp_port = rtpsrc->rtcp_port;
+  GST_OBJECT_UNLOCK(rtpsrc);
+  if (rtcp_port < 0) {
+    return TRUE;
+  }
+  if (!gst_omvp_rtpsrc_parse_uri(rtpsrc->uri, &host, &port)) {
+    return FALSE;
+  }
+  if (rtcp_port == 0) {
+    rtcp_port = port + 1;
+  }
 
-  rtpsrc->udpsrc = gst_element_factory_make("udpsrc", NULL);
-  if (!rtpsrc->udpsrc) {
+  rtpsrc->rtcp_appsrc = gst_element_factory_make("appsrc", NULL);
+  if (!rtpsrc->rtcp_appsrc) {
+    g_free(host);
     return FALSE;
   }
+  caps = gst_caps_new_empty_simple("application/x-rtcp");
+  g_object_set(G_OBJECT(rtpsrc->rtcp_appsrc),
+    "caps", caps,
+    "is-live", TRUE,
+    "format", GST_FORMAT_TIME,
+    "do-timestamp", TRUE,
+    NULL);
+  gst_caps_unref(caps);
+  gst_bin_add(GST_BIN(rtpsrc), rtpsrc->rtcp_appsrc);
+  gst_element_link_pads(rtpsrc->rtcp_appsrc, "src", rtpsrc->rtpbin,
+    "recv_rtcp_sink_0");
+  if (!gst_element_sync_state_with_parent(rtpsrc->rtcp_appsrc)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set RTCP appsrc to playing");
+  }
+
+  /* a sender without RTCP only leaves the end-to-end latency unknown */
+  receiver = omvp_recv_open(host, rtcp_port, 0, 0, RTCP_BATCH_SIZE,
+    RTCP_POOL_SIZE, gst_omvp_rtpsrc_rtcp_recv_cb, rtpsrc);
+  g_free(host);
+  if (!receiver) {
+    GST_WARNING_OBJECT(rtpsrc, "Could not receive RTCP on port %d",
+      rtcp_port);
+    return TRUE;
+  }
+  GST_OBJECT_LOCK(rtpsrc);
+  rtpsrc->rtcp_receiver = receiver;
+  GST_OBJECT_UNLOCK(rtpsrc);
+
+  return TRUE;
+}
+
+static gboolean gst_omvp_rtpsrc_start_rtp(GstOMVPRtpSrc *rtpsrc) {
+  GstCaps *caps;
+  GstClock *clock;
+  GstClockID clock_id;
+  guint latency;
+
+  GST_DEBUG_OBJECT(rtpsrc, "Creating RTP elements");
 
   rtpsrc->rtpbin = gst_element_factory_make("rtpbin", NULL);
   if (!rtpsrc->rtpbin) {
-    gst_object_unref(rtpsrc->udpsrc);
-    rtpsrc->udpsrc = NULL;
     return FALSE;
   }
-
-  caps = gst_caps_new_simple("application/x-rtp",
-    "media", G_TYPE_STRING, "video",
-    "clock-rate", G_TYPE_INT, 90000,
-    "payload", G_TYPE_INT, 33,
+  g_mutex_lock(&rtpsrc->latency_lock);
+  latency = rtpsrc->latency;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  /* timed out SSRCs are freed, not kept for the whole session */
+  g_object_set(G_OBJECT(rtpsrc->rtpbin),
+    "latency", latency,
+    "autoremove", TRUE,
     NULL);
-  g_object_set(G_OBJECT(rtpsrc->udpsrc), "caps", caps, NULL);
-  gst_caps_unref(caps);
 
-  if (gst_omvp_rtpsrc_parse_uri(rtpsrc->uri, &host, &port)) {
-    gchar *udpsrc_uri;
-    udpsrc_uri = g_strdup_printf("udp://%s:%u", host, port);
-    g_object_set(G_OBJECT(rtpsrc->udpsrc), "uri", udpsrc_uri, NULL);
-    g_free(host);
-    g_free(udpsrc_uri);
+  /* the payload caps are resolved by request-pt-map */
+  GST_OBJECT_LOCK(rtpsrc);
+  caps = rtpsrc->caps ? gst_caps_copy(rtpsrc->caps) :
+    gst_caps_new_empty_simple("application/x-rtp");
+  GST_OBJECT_UNLOCK(rtpsrc);
+  rtpsrc->capsfilter = gst_omvp_rtpsrc_make_capsfilter(rtpsrc, caps);
+  if (!rtpsrc->capsfilter) {
+    gst_object_unref(rtpsrc->rtpbin);
+    rtpsrc->rtpbin = NULL;
+    return FALSE;
   }
 
-  gst_bin_add_many(GST_BIN(rtpsrc), rtpsrc->udpsrc, rtpsrc->rtpbin, NULL);
-  gst_element_link_pads(rtpsrc->udpsrc, "src", rtpsrc->rtpbin,
+  gst_bin_add(GST_BIN(rtpsrc), rtpsrc->rtpbin);
+  gst_element_link_pads(rtpsrc->capsfilter, "src", rtpsrc->rtpbin,
     "recv_rtp_sink_0");
 
+  g_signal_connect(rtpsrc->rtpbin, "request-pt-map",
+    G_CALLBACK(gst_omvp_rtpsrc_rtpbin_request_pt_map_cb), rtpsrc);
   g_signal_connect(rtpsrc->rtpbin, "pad-added",
     G_CALLBACK(gst_omvp_rtpsrc_rtpbin_pad_added_cb), rtpsrc);
+  g_signal_connect(rtpsrc->rtpbin, "pad-removed",
+    G_CALLBACK(gst_omvp_rtpsrc_rtpbin_pad_removed_cb), rtpsrc);
+  g_signal_connect(rtpsrc->rtpbin, "new-jitterbuffer",
+    G_CALLBACK(gst_omvp_rtpsrc_rtpbin_new_jitterbuffer_cb), rtpsrc);
+
+  /* the adaptation runs on the clock thread, away from the receive lock */
+  clock = gst_system_clock_obtain();
+  clock_id = gst_clock_new_periodic_id(clock,
+    gst_clock_get_time(clock) + LATENCY_INTERVAL, LATENCY_INTERVAL);
+  gst_object_unref(clock);
+  gst_clock_id_wait_async(clock_id, gst_omvp_rtpsrc_latency_cb,
+    gst_object_ref(rtpsrc), (GDestroyNotify)gst_object_unref);
+  g_mutex_lock(&rtpsrc->latency_lock);
+  rtpsrc->latency_clock_id = clock_id;
+  g_mutex_unlock(&rtpsrc->latency_lock);
 
-  if (!gst_element_sync_state_with_parent(rtpsrc->udpsrc)) {
-    GST_ERROR_OBJECT(rtpsrc, "Could not set udpsrc to playing");
-  }
   if (!gst_element_sync_state_with_parent(rtpsrc->rtpbin)) {
     GST_ERROR_OBJECT(rtpsrc, "Could not set rtpbin to playing");
   }
+  if (!gst_element_sync_state_with_parent(rtpsrc->capsfilter)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set capsfilter to playing");
+  }
+
+  return gst_omvp_rtpsrc_start_rtcp(rtpsrc);
+}
+
+static gboolean gst_omvp_rtpsrc_start_ts(GstOMVPRtpSrc *rtpsrc) {
+  GstCaps *caps;
+  GstPad *pad;
+
+  GST_DEBUG_OBJECT(rtpsrc, "Creating MPEG-TS elements");
+
+  /* fixed caps let decodebin plug tsdemux without typefinding */
+  caps = gst_caps_new_simple("video/mpegts",
+    "systemstream", G_TYPE_BOOLEAN, TRUE,
+    "packetsize", G_TYPE_INT, 188,
+    NULL);
+  rtpsrc->capsfilter = gst_omvp_rtpsrc_make_capsfilter(rtpsrc, caps);
+  if (!rtpsrc->capsfilter) {
+    return FALSE;
+  }
+  if (!gst_element_sync_state_with_parent(rtpsrc->capsfilter)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set capsfilter to playing");
+  }
+
+  pad = gst_element_get_static_pad(rtpsrc->capsfilter, "src");
+  gst_omvp_rtpsrc_expose_pad(rtpsrc, pad);
+  gst_object_unref(pad);
 
   return TRUE;
 }
 
+static gboolean gst_omvp_rtpsrc_start(GstOMVPRtpSrc *rtpsrc) {
+  gchar *host;
+  guint16 port;
+  gboolean rtp;
+  gboolean sniff;
+  OMVPRecv receiver;
+
+  GST_DEBUG_OBJECT(rtpsrc, "Creating elements");
+
+  rtpsrc->appsrc = gst_element_factory_make("appsrc", NULL);
+  if (!rtpsrc->appsrc) {
+    return FALSE;
+  }
+  /* the pool of the receiver bounds the queued memory */
+  g_object_set(G_OBJECT(rtpsrc->appsrc),
+    "is-live", TRUE,
+    "format", GST_FORMAT_TIME,
+    "do-timestamp", TRUE,
+    "max-bytes", (guint64)0,
+    NULL);
+
+  rtpsrc->capsfilter = NULL;
+  rtpsrc->rtcp_appsrc = NULL;
+  rtpsrc->sniff_pt = -1;
+  rtpsrc->sniff_encoding = NULL;
+  rtpsrc->sniff_packets = 0;
+  rtpsrc->sniff_h264 = 0;
+  rtpsrc->sniff_h265 = 0;
+  rtpsrc->pt_encoding = NULL;
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  rtpsrc->has_last = FALSE;
+  rtpsrc->jitter = 0;
+  rtpsrc->window_reorder = 0;
+  rtpsrc->reorder = 0;
+  rtpsrc->last_pushed = 0;
+  rtpsrc->last_late = 0;
+  rtpsrc->clean_windows = 0;
+  rtpsrc->latency_floor = 0;
+  rtpsrc->has_sr = FALSE;
+  rtpsrc->has_transit = FALSE;
+  rtpsrc->drift = 0;
+  rtpsrc->has_active_ssrc = FALSE;
+  rtpsrc->ssrc_switches = 0;
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  rtpsrc->selector = NULL;
+
+  GST_OBJECT_LOCK(rtpsrc);
+  rtp = rtpsrc->caps || rtpsrc->encoding_name || rtpsrc->payload >= 0;
+  sniff = !rtpsrc->caps && !rtpsrc->encoding_name &&
+    !gst_omvp_rtpsrc_find_static_payload(rtpsrc->payload);
+  GST_OBJECT_UNLOCK(rtpsrc);
+  rtpsrc->sniff_done = !sniff;
+
+  gst_bin_add(GST_BIN(rtpsrc), rtpsrc->appsrc);
+
+  /* without an explicit payload, the first datagrams choose between RTP
+   * and raw MPEG-TS, which skips rtpbin and its jitterbuffer */
+  if (rtp && !gst_omvp_rtpsrc_start_rtp(rtpsrc)) {
+    return FALSE;
+  }
+  if (!rtp || sniff) {
+    GstPad *pad;
+    pad = gst_element_get_static_pad(rtpsrc->appsrc, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+      gst_omvp_rtpsrc_sniff_probe, rtpsrc, NULL);
+    gst_object_unref(pad);
+  }
+
+  if (!gst_element_sync_state_with_parent(rtpsrc->appsrc)) {
+    GST_ERROR_OBJECT(rtpsrc, "Could not set appsrc to playing");
+  }
+
+  if (!gst_omvp_rtpsrc_parse_uri(rtpsrc->uri, &host, &port)) {
+    return FALSE;
+  }
+  receiver = omvp_recv_open(host, port, rtpsrc->program, rtpsrc->buffer_size,
+    rtpsrc->batch_size, rtpsrc->pool_size, gst_omvp_rtpsrc_recv_cb, rtpsrc);
+  g_free(host);
+  if (!receiver) {
+    GST_ELEMENT_ERROR(rtpsrc, RESOURCE, OPEN_READ, (NULL),
+      ("Could not receive from %s", rtpsrc->uri));
+    return FALSE;
+  }
+  GST_OBJECT_LOCK(rtpsrc);
+  rtpsrc->receiver = receiver;
+  GST_OBJECT_UNLOCK(rtpsrc);
+
+  if (rtpsrc->stats_interval) {
+    GstClock *clock;
+    GstClockTime interval;
+    interval = rtpsrc->stats_interval * GST_MSECOND;
+    clock = gst_system_clock_obtain();
+    rtpsrc->stats_clock_id = gst_clock_new_periodic_id(clock,
+      gst_clock_get_time(clock) + interval, interval);
+    gst_object_unref(clock);
+    gst_clock_id_wait_async(rtpsrc->stats_clock_id, gst_omvp_rtpsrc_stats_cb,
+      gst_object_ref(rtpsrc), (GDestroyNotify)gst_object_unref);
+  }
+
+  return TRUE;
+}
+
+static void gst_omvp_rtpsrc_stop(GstOMVPRtpSrc *rtpsrc) {
+  OMVPRecv receiver;
+  OMVPRecv rtcp_receiver;
+  GstClockID clock_id;
+  GstElement *jitterbuffer;
+
+  GST_OBJECT_LOCK(rtpsrc);
+  receiver = rtpsrc->receiver;
+  rtpsrc->receiver = NULL;
+  rtcp_receiver = rtpsrc->rtcp_receiver;
+  rtpsrc->rtcp_receiver = NULL;
+  GST_OBJECT_UNLOCK(rtpsrc);
+  if (rtpsrc->stats_clock_id) {
+    gst_clock_id_unschedule(rtpsrc->stats_clock_id);
+    gst_clock_id_unref(rtpsrc->stats_clock_id);
+    rtpsrc->stats_clock_id = NULL;
+  }
+  if (receiver) {
+    omvp_recv_close(receiver);
+  }
+  if (rtcp_receiver) {
+    omvp_recv_close(rtcp_receiver);
+  }
+
+  g_mutex_lock(&rtpsrc->latency_lock);
+  clock_id = rtpsrc->latency_clock_id;
+  rtpsrc->latency_clock_id = NULL;
+  jitterbuffer = rtpsrc->jitterbuffer;
+  rtpsrc->jitterbuffer = NULL;
+  rtpsrc->has_active_ssrc = FALSE;
+  g_hash_table_remove_all(rtpsrc->ssrcs);
+  g_mutex_unlock(&rtpsrc->latency_lock);
+  if (clock_id) {
+    gst_clock_id_unschedule(clock_id);
+    gst_clock_id_unref(clock_id);
+  }
+  if (jitterbuffer) {
+    gst_object_unref(jitterbuffer);
+  }
+}
+
 static GstStateChangeReturn gst_omvp_rtpsrc_change_state(GstElement *element,
   GstStateChange transition) {
   GstOMVPRtpSrc *rtpsrc = GST_OMVP_RTPSRC(element);
@@ -380,6 +1922,7 @@ static GstStateChangeReturn gst_omvp_rtpsrc_change_state(GstElement *element,
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
+      gst_omvp_rtpsrc_stop(rtpsrc);
       break;
     default:
       break;
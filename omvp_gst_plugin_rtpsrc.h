@@ -22,6 +22,7 @@
 #define _OMVP_GST_PLUGIN_RTPSRC_H_
 
 #include <gst/gst.h>
+#include "omvp_recv.h"
 
 #define GST_TYPE_OMVP_RTPSRC (gst_omvp_rtpsrc_get_type())
 #define GST_OMVP_RTPSRC(obj) \
@@ -46,10 +47,77 @@ struct _GstOMVPRtpSrc {
   GstBin parent_instance;
 
   gchar *uri;
-  GstElement *udpsrc;
+  GstCaps *caps;
+  gint payload;
+  gchar *encoding_name;
+  gint clock_rate;
+  gint program;
+  gint rtcp_port;
+  gint buffer_size;
+  guint batch_size;
+  guint pool_size;
+  OMVPRecv receiver;
+  OMVPRecv rtcp_receiver;
+  GstClockID latency_clock_id;
+  guint stats_interval;
+  GstClockID stats_clock_id;
+  GstElement *appsrc;
+  GstElement *rtcp_appsrc;
   GstElement *rtpbin;
+  GstElement *selector;
+  GstElement *capsfilter;
+  GstElement *depay;
   GstPad *ghostpad;
   gint n_pads;
+
+  /* payload detected from the first packets */
+  gint sniff_pt;
+  const gchar *sniff_encoding;
+  guint sniff_packets;
+  guint sniff_h264;
+  guint sniff_h265;
+  gboolean sniff_done;
+  const gchar *pt_encoding;
+
+  /* jitterbuffer latency adapted to the measured jitter and reordering,
+   * guarded by latency_lock as packets are measured under the receive lock */
+  GMutex latency_lock;
+  guint latency;
+  gboolean adaptive_latency;
+  guint min_latency;
+  guint max_latency;
+  gdouble late_threshold;
+  GstElement *jitterbuffer;
+  gint rtp_clock_rate;
+  gboolean has_last;
+  guint32 last_rtp_ts;
+  gint64 last_arrival;
+  gdouble jitter;
+  guint16 max_seq;
+  gint64 max_seq_arrival;
+  gint64 window_reorder;
+  gint64 reorder;
+  guint64 last_pushed;
+  guint64 last_late;
+  guint clean_windows;
+  guint latency_floor;
+
+  /* sender clock from the RTCP sender reports, in unix microseconds */
+  gboolean has_sr;
+  guint32 sr_ssrc;
+  gint64 sr_ntp_time;
+  guint32 sr_rtp_ts;
+  gint64 first_sr_ntp_time;
+  gint64 first_sr_arrival;
+  gboolean has_transit;
+  gdouble transit;
+  gdouble drift;
+
+  /* every SSRC seen, the active one is selected for the src pad */
+  GHashTable *ssrcs;
+  gboolean has_active_ssrc;
+  guint32 active_ssrc;
+  guint64 ssrc_switches;
 };
 
 extern GType gst_omvp_rtpsrc_get_type(void);
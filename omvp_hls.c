@@ -0,0 +1,865 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <libsoup/soup.h>
+#include "config.h"
+#include "omvp_hls.h"
+#include "omvp_ts.h"
+
+/* a failed or non-master playlist is fetched again after this long. */
+#define _OMVP_HLS_RETRY_INTERVAL (60 * G_USEC_PER_SEC)
+/* the window of a segment read by one range request. */
+#define _OMVP_HLS_RANGE_SIZE (OMVP_TS_PACKET_SIZE * 1024)
+
+typedef struct _OMVPHlsMaster {
+  gchar *uri;
+  GPtrArray *variants;
+  gboolean is_fetching;
+  gint64 fetch_time;
+} OMVPHlsMaster;
+
+/*
+  A thumbnail request reads the playlist, then the byte range of its Media
+  Initialization Section if there is one, then the byte range of the newest
+  keyframe, or of the newest segment when ts is set. A segment is parsed as
+  it arrives and only its first keyframe is kept. A length of -1 is the
+  whole resource.
+*/
+typedef struct _OMVPHlsRequestImpl {
+  SoupMessage *msg;
+  gboolean is_cancelled;
+  gboolean is_complete;
+  gboolean has_playlist;
+  gchar *playlist_uri;
+  gchar *map_uri;
+  gint64 map_offset;
+  gint64 map_length;
+  gchar *frame_uri;
+  gint64 frame_offset;
+  gint64 frame_length;
+  gint64 range_offset;
+  gint64 range_length;
+  gint64 range_received;
+  OMVPTs ts;
+  guint8 packet[OMVP_TS_PACKET_SIZE];
+  gsize packet_len;
+  GByteArray *psi;
+  guint video_pid;
+  gboolean has_keyframe;
+  gsize num_bytes;
+  GByteArray *data;
+  OMVPHlsCallback callback;
+  gpointer callback_data;
+} OMVPHlsRequestImpl;
+
+typedef struct _OMVPHlsShared {
+  SoupSession *session;
+  GHashTable *masters;
+  GHashTable *unsupported;
+  OMVPHlsStats stats;
+} OMVPHlsShared;
+
+static OMVPHlsShared _omvp_hls_shared;
+
+static void _omvp_hls_variant_free(gpointer data);
+static gchar *_omvp_hls_get_attr(const gchar *attrs, const gchar *name);
+static gchar *_omvp_hls_resolve(const gchar *base_uri, const gchar *uri);
+static gboolean _omvp_hls_has_video_codec(const gchar *codecs);
+static OMVPHlsVariant *_omvp_hls_parse_stream_inf(const gchar *attrs,
+  gboolean is_iframe);
+static gboolean _omvp_hls_parse_byterange(const gchar *value,
+  gint64 *length, gint64 *offset);
+static gint _omvp_hls_parse_media(OMVPHlsRequestImpl *request_impl,
+  const gchar *data, gsize len, const gchar *base_uri);
+static gint _omvp_hls_extract_packet(OMVPHlsRequestImpl *request_impl,
+  const guint8 *packet);
+static gint _omvp_hls_extract(OMVPHlsRequestImpl *request_impl,
+  const guint8 *data, gsize len);
+static gint _omvp_hls_request_send(OMVPHlsRequestImpl *request_impl,
+  const gchar *uri, gint64 offset, gint64 length, gboolean stream);
+static gint _omvp_hls_request_send_frame(OMVPHlsRequestImpl *request_impl);
+static void _omvp_hls_request_finish(OMVPHlsRequestImpl *request_impl,
+  gboolean ok);
+static OMVPHlsRequestImpl *_omvp_hls_request_new(const gchar *playlist_uri,
+  gboolean ts, OMVPHlsCallback callback, gpointer user_data);
+static void _omvp_hls_on_chunk(SoupMessage *msg, SoupBuffer *chunk,
+  gpointer user_data);
+static void _omvp_hls_on_request(SoupSession *session, SoupMessage *msg,
+  gpointer user_data);
+static void _omvp_hls_on_master(SoupSession *session, SoupMessage *msg,
+  gpointer user_data);
+static OMVPHlsShared *_omvp_hls_get_shared(void);
+
+static void _omvp_hls_variant_free(gpointer data) {
+  OMVPHlsVariant *variant;
+
+  variant = (OMVPHlsVariant *)data;
+  g_free(variant->uri);
+  g_free(variant);
+}
+
+/* the value of name in an attribute list, where values may be quoted. */
+static gchar *_omvp_hls_get_attr(const gchar *attrs, const gchar *name) {
+  const gchar *p;
+  const gchar *end;
+  gsize name_len;
+
+  name_len = strlen(name);
+  p = attrs;
+  while (*p) {
+    if (strncmp(p, name, name_len) == 0 && p[name_len] == '=') {
+      p += name_len + 1;
+      if (*p == '"') {
+        p++;
+        end = strchr(p, '"');
+        if (!end) {
+          end = p + strlen(p);
+        }
+      } else {
+        end = p + strcspn(p, ",");
+      }
+      return g_strndup(p, end - p);
+    }
+    while (*p && *p != ',') {
+      if (*p == '"') {
+        p = strchr(p + 1, '"');
+        if (!p) {
+          return NULL;
+        }
+      }
+      p++;
+    }
+    if (*p == ',') {
+      p++;
+    }
+  }
+
+  return NULL;
+}
+
+static gchar *_omvp_hls_resolve(const gchar *base_uri, const gchar *uri) {
+  SoupURI *base;
+  SoupURI *resolved;
+  gchar *str;
+
+  base = soup_uri_new(base_uri);
+  if (!base) {
+    return g_strdup(uri);
+  }
+  resolved = soup_uri_new_with_base(base, uri);
+  soup_uri_free(base);
+  if (!resolved) {
+    return g_strdup(uri);
+  }
+  str = soup_uri_to_string(resolved, FALSE);
+  soup_uri_free(resolved);
+
+  return str;
+}
+
+static gboolean _omvp_hls_has_video_codec(const gchar *codecs) {
+  static const gchar *prefixes[] = {
+    "avc", "hvc", "hev", "mp4v", "vp0", "vp9", "av01", NULL
+  };
+  gchar **list;
+  gboolean has_video;
+  gint i, j;
+
+  has_video = FALSE;
+  list = g_strsplit(codecs, ",", -1);
+  for (i = 0; list[i] && !has_video; i++) {
+    for (j = 0; prefixes[j]; j++) {
+      if (g_str_has_prefix(g_strstrip(list[i]), prefixes[j])) {
+        has_video = TRUE;
+        break;
+      }
+    }
+  }
+  g_strfreev(list);
+
+  return has_video;
+}
+
+static OMVPHlsVariant *_omvp_hls_parse_stream_inf(const gchar *attrs,
+  gboolean is_iframe) {
+  OMVPHlsVariant *variant;
+  gchar *value;
+
+  variant = g_malloc0(sizeof(OMVPHlsVariant));
+  variant->is_iframe = is_iframe;
+  value = _omvp_hls_get_attr(attrs, "BANDWIDTH");
+  if (value) {
+    variant->bandwidth = (gint)g_ascii_strtoll(value, NULL, 10);
+    g_free(value);
+  }
+  value = _omvp_hls_get_attr(attrs, "RESOLUTION");
+  if (value) {
+    sscanf(value, "%dx%d", &variant->width, &variant->height);
+    g_free(value);
+  }
+  value = _omvp_hls_get_attr(attrs, "CODECS");
+  variant->has_video = variant->width > 0 || !value ||
+    _omvp_hls_has_video_codec(value);
+  g_free(value);
+
+  return variant;
+}
+
+/* "length[@offset]", returns whether the offset is given. */
+static gboolean _omvp_hls_parse_byterange(const gchar *value,
+  gint64 *length, gint64 *offset) {
+  gchar *end;
+
+  *length = g_ascii_strtoll(value, &end, 10);
+  if (*end != '@') {
+    return FALSE;
+  }
+  *offset = g_ascii_strtoll(end + 1, NULL, 10);
+
+  return TRUE;
+}
+
+/*
+  Keeps the last entry, which is the newest keyframe of an I-frame playlist
+  or the newest segment of a live media playlist.
+*/
+static gint _omvp_hls_parse_media(OMVPHlsRequestImpl *request_impl,
+  const gchar *data, gsize len, const gchar *base_uri) {
+  gchar *text;
+  gchar **lines;
+  gchar *value;
+  gchar *uri;
+  gint64 length, offset, next_offset;
+  gboolean has_range, has_offset;
+  gint i;
+
+  text = g_strndup(data, len);
+  lines = g_strsplit(text, "\n", -1);
+  g_free(text);
+  if (!lines[0] || !g_str_has_prefix(g_strstrip(lines[0]), "#EXTM3U")) {
+    g_strfreev(lines);
+    return -1;
+  }
+
+  has_range = FALSE;
+  has_offset = FALSE;
+  length = -1;
+  offset = 0;
+  next_offset = 0;
+  for (i = 1; lines[i]; i++) {
+    g_strstrip(lines[i]);
+    if (g_str_has_prefix(lines[i], "#EXT-X-MAP:")) {
+      g_free(request_impl->map_uri);
+      request_impl->map_uri = NULL;
+      value = _omvp_hls_get_attr(lines[i] + strlen("#EXT-X-MAP:"), "URI");
+      if (value) {
+        request_impl->map_uri = _omvp_hls_resolve(base_uri, value);
+        g_free(value);
+      }
+      request_impl->map_offset = 0;
+      request_impl->map_length = -1;
+      value = _omvp_hls_get_attr(lines[i] + strlen("#EXT-X-MAP:"),
+        "BYTERANGE");
+      if (value) {
+        _omvp_hls_parse_byterange(value, &request_impl->map_length,
+          &request_impl->map_offset);
+        g_free(value);
+      }
+    } else if (g_str_has_prefix(lines[i], "#EXT-X-BYTERANGE:")) {
+      has_range = TRUE;
+      has_offset = _omvp_hls_parse_byterange(
+        lines[i] + strlen("#EXT-X-BYTERANGE:"), &length, &offset);
+    } else if (lines[i][0] && lines[i][0] != '#') {
+      uri = _omvp_hls_resolve(base_uri, lines[i]);
+      if (!has_range) {
+        offset = 0;
+        length = -1;
+      } else if (!has_offset) {
+        /* a range without offset follows the previous one. */
+        offset = request_impl->frame_uri &&
+          strcmp(request_impl->frame_uri, uri) == 0 ? next_offset : 0;
+      }
+      next_offset = offset + length;
+      g_free(request_impl->frame_uri);
+      request_impl->frame_uri = uri;
+      request_impl->frame_offset = offset;
+      request_impl->frame_length = length;
+      has_range = FALSE;
+    }
+  }
+  g_strfreev(lines);
+
+  return request_impl->frame_uri ? 0 : -1;
+}
+
+/*
+  Returns 1 once the packet starts the access unit after the keyframe,
+  0 for more and -1 when the segment is not MPEG-TS. The PAT and PMT seen
+  last before the keyframe go in front of it.
+*/
+static gint _omvp_hls_extract_packet(OMVPHlsRequestImpl *request_impl,
+  const guint8 *packet) {
+  guint pid;
+
+  if (packet[0] != 0x47) {
+    return -1;
+  }
+  omvp_ts_parse(request_impl->ts, packet, OMVP_TS_PACKET_SIZE);
+  pid = ((packet[1] & 0x1f) << 8) | packet[2];
+  if (pid == 0 || omvp_ts_is_pmt_pid(request_impl->ts, pid)) {
+    if (!request_impl->has_keyframe) {
+      if (pid == 0) {
+        g_byte_array_set_size(request_impl->psi, 0);
+      }
+      g_byte_array_append(request_impl->psi, packet, OMVP_TS_PACKET_SIZE);
+    }
+    return 0;
+  }
+
+  if (!request_impl->has_keyframe) {
+    if (request_impl->psi->len == 0 ||
+      !omvp_ts_has_keyframe(packet, OMVP_TS_PACKET_SIZE)) {
+      return 0;
+    }
+    request_impl->has_keyframe = TRUE;
+    request_impl->video_pid = pid;
+    g_byte_array_append(request_impl->data, request_impl->psi->data,
+      request_impl->psi->len);
+  } else if (pid != request_impl->video_pid) {
+    return 0;
+  } else if (packet[1] & 0x40) {
+    return 1;
+  }
+  g_byte_array_append(request_impl->data, packet, OMVP_TS_PACKET_SIZE);
+
+  return 0;
+}
+
+/* chunks are not aligned to packets. */
+static gint _omvp_hls_extract(OMVPHlsRequestImpl *request_impl,
+  const guint8 *data, gsize len) {
+  gsize n;
+  gint ret;
+
+  while (len > 0) {
+    n = MIN(OMVP_TS_PACKET_SIZE - request_impl->packet_len, len);
+    memcpy(request_impl->packet + request_impl->packet_len, data, n);
+    request_impl->packet_len += n;
+    data += n;
+    len -= n;
+    if (request_impl->packet_len < OMVP_TS_PACKET_SIZE) {
+      break;
+    }
+    request_impl->packet_len = 0;
+    ret = _omvp_hls_extract_packet(request_impl, request_impl->packet);
+    if (ret < 0 && !g_hash_table_contains(_omvp_hls_shared.unsupported,
+      request_impl->playlist_uri)) {
+      /* later scans of the channel play the variant instead. */
+      g_hash_table_add(_omvp_hls_shared.unsupported,
+        g_strdup(request_impl->playlist_uri));
+    }
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
+static gint _omvp_hls_request_send(OMVPHlsRequestImpl *request_impl,
+  const gchar *uri, gint64 offset, gint64 length, gboolean stream) {
+  SoupMessage *msg;
+
+  msg = soup_message_new("GET", uri);
+  if (!msg) {
+    return -1;
+  }
+  if (length > 0) {
+    soup_message_headers_set_range(msg->request_headers, offset,
+      offset + length - 1);
+  }
+  if (stream) {
+    soup_message_body_set_accumulate(msg->response_body, FALSE);
+    g_signal_connect(msg, "got-chunk", G_CALLBACK(_omvp_hls_on_chunk),
+      request_impl);
+  }
+  request_impl->msg = msg;
+  soup_session_queue_message(_omvp_hls_shared.session, msg,
+    _omvp_hls_on_request, request_impl);
+
+  return 0;
+}
+
+/*
+  A segment is read in windows of _OMVP_HLS_RANGE_SIZE so that little more
+  than the keyframe is in flight when the transfer is aborted.
+*/
+static gint _omvp_hls_request_send_frame(OMVPHlsRequestImpl *request_impl) {
+  gint64 length;
+
+  if (!request_impl->ts) {
+    return _omvp_hls_request_send(request_impl, request_impl->frame_uri,
+      request_impl->frame_offset, request_impl->frame_length, FALSE);
+  }
+
+  length = _OMVP_HLS_RANGE_SIZE;
+  if (request_impl->frame_length > 0) {
+    length = MIN(length, request_impl->frame_offset +
+      request_impl->frame_length - request_impl->range_offset);
+  }
+  if (length <= 0) {
+    return -1;
+  }
+  request_impl->range_length = length;
+  request_impl->range_received = 0;
+
+  return _omvp_hls_request_send(request_impl, request_impl->frame_uri,
+    request_impl->range_offset, length, TRUE);
+}
+
+static void _omvp_hls_request_finish(OMVPHlsRequestImpl *request_impl,
+  gboolean ok) {
+  GBytes *data;
+
+  if (ok) {
+    _omvp_hls_shared.stats.num_thumbnails++;
+    _omvp_hls_shared.stats.last_num_bytes = request_impl->num_bytes;
+  }
+  _omvp_hls_shared.stats.num_bytes += request_impl->num_bytes;
+  g_debug("omvp_hls uri(%s) ok(%d) bytes(%" G_GSIZE_FORMAT ")",
+    request_impl->playlist_uri, ok, request_impl->num_bytes);
+
+  data = g_byte_array_free_to_bytes(request_impl->data);
+  if (request_impl->callback) {
+    request_impl->callback(ok ? data : NULL, request_impl->callback_data);
+  }
+  g_bytes_unref(data);
+  if (request_impl->ts) {
+    omvp_ts_close(request_impl->ts);
+    g_byte_array_unref(request_impl->psi);
+  }
+  g_free(request_impl->playlist_uri);
+  g_free(request_impl->map_uri);
+  g_free(request_impl->frame_uri);
+  g_free(request_impl);
+}
+
+static void _omvp_hls_on_chunk(SoupMessage *msg, SoupBuffer *chunk,
+  gpointer user_data) {
+  OMVPHlsRequestImpl *request_impl;
+  const guint8 *data;
+  gsize len;
+  gint64 start;
+  gint64 skip;
+  gint ret;
+
+  request_impl = (OMVPHlsRequestImpl *)user_data;
+  data = (const guint8 *)chunk->data;
+  len = chunk->length;
+  request_impl->num_bytes += len;
+  if (request_impl->is_complete) {
+    return;
+  }
+
+  /* a server without range requests sends the whole resource. */
+  start = request_impl->range_received;
+  if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT) {
+    start += request_impl->range_offset;
+  }
+  request_impl->range_received += len;
+  if (start < request_impl->range_offset) {
+    skip = MIN(request_impl->range_offset - start, (gint64)len);
+    data += skip;
+    len -= (gsize)skip;
+    start += skip;
+  }
+  if (request_impl->frame_length > 0 && start + (gint64)len >
+    request_impl->frame_offset + request_impl->frame_length) {
+    len = (gsize)MAX(request_impl->frame_offset +
+      request_impl->frame_length - start, 0);
+  }
+
+  ret = _omvp_hls_extract(request_impl, data, len);
+  if (ret != 0) {
+    request_impl->is_complete = ret > 0;
+    soup_session_cancel_message(_omvp_hls_shared.session, msg,
+      SOUP_STATUS_CANCELLED);
+  }
+}
+
+static void _omvp_hls_on_request(SoupSession *session, SoupMessage *msg,
+  gpointer user_data) {
+  OMVPHlsRequestImpl *request_impl;
+  const guint8 *data;
+  gsize len;
+  gint64 offset, length;
+  gchar *base_uri;
+  gint ret;
+
+  (void)session;
+
+  request_impl = (OMVPHlsRequestImpl *)user_data;
+  request_impl->msg = NULL;
+  if (request_impl->is_complete) {
+    _omvp_hls_request_finish(request_impl, TRUE);
+    return;
+  }
+  if (request_impl->is_cancelled ||
+    !SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
+    _omvp_hls_request_finish(request_impl, FALSE);
+    return;
+  }
+
+  if (request_impl->ts && !request_impl->map_uri &&
+    request_impl->has_playlist) {
+    /* the window ended before the access unit after the keyframe. */
+    if (msg->status_code == SOUP_STATUS_PARTIAL_CONTENT &&
+      request_impl->range_received == request_impl->range_length) {
+      request_impl->range_offset += request_impl->range_length;
+      if (_omvp_hls_request_send_frame(request_impl) == 0) {
+        return;
+      }
+    }
+    _omvp_hls_request_finish(request_impl, request_impl->has_keyframe);
+    return;
+  }
+
+  data = (const guint8 *)msg->response_body->data;
+  len = msg->response_body->length;
+  request_impl->num_bytes += len;
+
+  if (!request_impl->has_playlist) {
+    request_impl->has_playlist = TRUE;
+    base_uri = soup_uri_to_string(soup_message_get_uri(msg), FALSE);
+    ret = _omvp_hls_parse_media(request_impl, (const gchar *)data, len,
+      base_uri);
+    g_free(base_uri);
+    request_impl->range_offset = request_impl->frame_offset;
+    if (ret == 0) {
+      ret = request_impl->map_uri ?
+        _omvp_hls_request_send(request_impl, request_impl->map_uri,
+        request_impl->map_offset, request_impl->map_length, FALSE) :
+        _omvp_hls_request_send_frame(request_impl);
+    }
+    if (ret != 0) {
+      _omvp_hls_request_finish(request_impl, FALSE);
+    }
+    return;
+  }
+
+  offset = request_impl->map_uri ? request_impl->map_offset :
+    request_impl->frame_offset;
+  length = request_impl->map_uri ? request_impl->map_length :
+    request_impl->frame_length;
+  /* a server without range requests sends the whole resource. */
+  if (msg->status_code == SOUP_STATUS_OK && length > 0) {
+    if (offset + length > (gint64)len) {
+      _omvp_hls_request_finish(request_impl, FALSE);
+      return;
+    }
+    data += offset;
+    len = (gsize)length;
+  }
+
+  if (request_impl->map_uri) {
+    if (request_impl->ts) {
+      ret = _omvp_hls_extract(request_impl, data, len);
+    } else {
+      g_byte_array_append(request_impl->data, data, len);
+      ret = 0;
+    }
+    g_free(request_impl->map_uri);
+    request_impl->map_uri = NULL;
+    if (ret != 0 || _omvp_hls_request_send_frame(request_impl) != 0) {
+      _omvp_hls_request_finish(request_impl, FALSE);
+    }
+    return;
+  }
+  g_byte_array_append(request_impl->data, data, len);
+  _omvp_hls_request_finish(request_impl, TRUE);
+}
+
+static void _omvp_hls_on_master(SoupSession *session, SoupMessage *msg,
+  gpointer user_data) {
+  OMVPHlsMaster *master;
+  gchar *base_uri;
+
+  (void)session;
+
+  master = (OMVPHlsMaster *)user_data;
+  master->is_fetching = FALSE;
+  if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code) ||
+    msg->response_body->length <= 0) {
+    g_debug("omvp_hls uri(%s) status(%u)", master->uri, msg->status_code);
+    return;
+  }
+
+  /* relative variant uris follow redirects. */
+  base_uri = soup_uri_to_string(soup_message_get_uri(msg), FALSE);
+  master->variants = omvp_hls_parse_master(msg->response_body->data,
+    msg->response_body->length, base_uri);
+  g_free(base_uri);
+
+  g_debug("omvp_hls uri(%s) variants(%u)", master->uri,
+    master->variants ? master->variants->len : 0);
+}
+
+/* the masters stay known as long as the process. */
+static OMVPHlsShared *_omvp_hls_get_shared(void) {
+
+  if (!_omvp_hls_shared.session) {
+    _omvp_hls_shared.session = soup_session_new_with_options(
+      SOUP_SESSION_USER_AGENT, PACKAGE_STRING, NULL);
+    _omvp_hls_shared.masters = g_hash_table_new(g_str_hash, g_str_equal);
+    _omvp_hls_shared.unsupported = g_hash_table_new(g_str_hash,
+      g_str_equal);
+  }
+
+  return &_omvp_hls_shared;
+}
+
+gboolean omvp_hls_is_playlist_uri(const gchar *uri) {
+  gsize path_len;
+
+  if (g_ascii_strncasecmp(uri, "http://", 7) != 0 &&
+    g_ascii_strncasecmp(uri, "https://", 8) != 0) {
+    return FALSE;
+  }
+  path_len = strcspn(uri, "?#");
+
+  return path_len >= 5 &&
+    g_ascii_strncasecmp(uri + path_len - 5, ".m3u8", 5) == 0;
+}
+
+/*
+  The variants and I-frame playlists of a master playlist, or NULL for any
+  other playlist.
+*/
+GPtrArray *omvp_hls_parse_master(const gchar *data, gsize len,
+  const gchar *base_uri) {
+  GPtrArray *variants;
+  OMVPHlsVariant *variant;
+  OMVPHlsVariant *iframe;
+  gchar *text;
+  gchar **lines;
+  gchar *value;
+  gint i;
+
+  text = g_strndup(data, len);
+  lines = g_strsplit(text, "\n", -1);
+  g_free(text);
+  if (!lines[0] || !g_str_has_prefix(g_strstrip(lines[0]), "#EXTM3U")) {
+    g_strfreev(lines);
+    return NULL;
+  }
+
+  variants = g_ptr_array_new_with_free_func(_omvp_hls_variant_free);
+  variant = NULL;
+  for (i = 1; lines[i]; i++) {
+    g_strstrip(lines[i]);
+    if (g_str_has_prefix(lines[i], "#EXT-X-STREAM-INF:")) {
+      if (variant) {
+        _omvp_hls_variant_free(variant);
+      }
+      variant = _omvp_hls_parse_stream_inf(
+        lines[i] + strlen("#EXT-X-STREAM-INF:"), FALSE);
+    } else if (g_str_has_prefix(lines[i], "#EXT-X-I-FRAME-STREAM-INF:")) {
+      /* an I-frame playlist is given by its URI attribute. */
+      value = _omvp_hls_get_attr(
+        lines[i] + strlen("#EXT-X-I-FRAME-STREAM-INF:"), "URI");
+      if (value) {
+        iframe = _omvp_hls_parse_stream_inf(
+          lines[i] + strlen("#EXT-X-I-FRAME-STREAM-INF:"), TRUE);
+        iframe->uri = _omvp_hls_resolve(base_uri, value);
+        g_ptr_array_add(variants, iframe);
+        g_free(value);
+      }
+    } else if (variant && lines[i][0] && lines[i][0] != '#') {
+      variant->uri = _omvp_hls_resolve(base_uri, lines[i]);
+      g_ptr_array_add(variants, variant);
+      variant = NULL;
+    }
+  }
+  if (variant) {
+    _omvp_hls_variant_free(variant);
+  }
+  g_strfreev(lines);
+
+  if (variants->len == 0) {
+    g_ptr_array_free(variants, TRUE);
+    return NULL;
+  }
+
+  return variants;
+}
+
+/*
+  The lowest bandwidth video variant, or I-frame playlist, whose resolution
+  covers min_width x min_height. Without one, the lowest bandwidth variant
+  of the largest resolution is as close as it gets.
+*/
+const OMVPHlsVariant *omvp_hls_select_variant(GPtrArray *variants,
+  gint min_width, gint min_height, gboolean iframe) {
+  const OMVPHlsVariant *variant;
+  const OMVPHlsVariant *best;
+  const OMVPHlsVariant *largest;
+  guint i;
+
+  best = NULL;
+  largest = NULL;
+  for (i = 0; i < variants->len; i++) {
+    variant = g_ptr_array_index(variants, i);
+    if (!variant->has_video || variant->is_iframe != iframe) {
+      continue;
+    }
+    if (variant->width >= min_width && variant->height >= min_height &&
+      (variant->width > 0 || min_width == 0) &&
+      (!best || variant->bandwidth < best->bandwidth)) {
+      best = variant;
+    }
+    if (!largest ||
+      variant->width * variant->height > largest->width * largest->height ||
+      (variant->width * variant->height ==
+      largest->width * largest->height &&
+      variant->bandwidth < largest->bandwidth)) {
+      largest = variant;
+    }
+  }
+
+  return best ? best : largest;
+}
+
+/*
+  Looks up the variant or the I-frame playlist for an HLS uri from its
+  master playlist. The master is fetched in the background the first time,
+  and NULL is returned until it is known. The variant stays valid until the
+  master is fetched again.
+*/
+const OMVPHlsVariant *omvp_hls_lookup_variant(const gchar *uri,
+  gint min_width, gint min_height, gboolean iframe) {
+  OMVPHlsShared *shared;
+  OMVPHlsMaster *master;
+  SoupMessage *msg;
+  gint64 now;
+
+  shared = _omvp_hls_get_shared();
+  master = g_hash_table_lookup(shared->masters, uri);
+  if (!master) {
+    master = g_malloc0(sizeof(OMVPHlsMaster));
+    master->uri = g_strdup(uri);
+    g_hash_table_insert(shared->masters, master->uri, master);
+  }
+  if (master->variants) {
+    return omvp_hls_select_variant(master->variants, min_width, min_height,
+      iframe);
+  }
+
+  now = g_get_monotonic_time();
+  if (!master->is_fetching && (master->fetch_time == 0 ||
+    now - master->fetch_time > _OMVP_HLS_RETRY_INTERVAL)) {
+    msg = soup_message_new("GET", uri);
+    if (msg) {
+      master->is_fetching = TRUE;
+      master->fetch_time = now;
+      soup_session_queue_message(shared->session, msg, _omvp_hls_on_master,
+        master);
+    }
+  }
+
+  return NULL;
+}
+
+static OMVPHlsRequestImpl *_omvp_hls_request_new(const gchar *playlist_uri,
+  gboolean ts, OMVPHlsCallback callback, gpointer user_data) {
+  OMVPHlsRequestImpl *request_impl;
+
+  _omvp_hls_get_shared();
+  request_impl = g_malloc0(sizeof(OMVPHlsRequestImpl));
+  request_impl->playlist_uri = g_strdup(playlist_uri);
+  request_impl->data = g_byte_array_new();
+  if (ts) {
+    request_impl->ts = omvp_ts_open();
+    request_impl->psi = g_byte_array_new();
+  }
+  request_impl->callback = callback;
+  request_impl->callback_data = user_data;
+  if (_omvp_hls_request_send(request_impl, playlist_uri, 0, -1, FALSE) != 0) {
+    /* finishing without a callback only frees the request. */
+    request_impl->callback = NULL;
+    _omvp_hls_request_finish(request_impl, FALSE);
+    return NULL;
+  }
+
+  return request_impl;
+}
+
+/*
+  Fetches the newest keyframe of an I-frame playlist, with its Media
+  Initialization Section in front, using range requests only.
+*/
+OMVPHlsRequest omvp_hls_fetch_iframe(const gchar *playlist_uri,
+  OMVPHlsCallback callback, gpointer user_data) {
+
+  return _omvp_hls_request_new(playlist_uri, FALSE, callback, user_data);
+}
+
+/*
+  Fetches the first keyframe of the newest MPEG-TS segment of a media
+  playlist, with the PAT and PMT in front, and aborts the transfer as soon
+  as the access unit after it starts. NULL is returned for a playlist whose
+  segments were found not to be MPEG-TS.
+*/
+OMVPHlsRequest omvp_hls_fetch_keyframe(const gchar *playlist_uri,
+  OMVPHlsCallback callback, gpointer user_data) {
+
+  if (g_hash_table_contains(_omvp_hls_get_shared()->unsupported,
+    playlist_uri)) {
+    return NULL;
+  }
+
+  return _omvp_hls_request_new(playlist_uri, TRUE, callback, user_data);
+}
+
+/* the callback is not called once the request is cancelled. */
+gint omvp_hls_cancel(OMVPHlsRequest request) {
+  OMVPHlsRequestImpl *request_impl;
+
+  request_impl = (OMVPHlsRequestImpl *)request;
+  if (request_impl) {
+    request_impl->is_cancelled = TRUE;
+    request_impl->callback = NULL;
+    if (request_impl->msg) {
+      soup_session_cancel_message(_omvp_hls_shared.session,
+        request_impl->msg, SOUP_STATUS_CANCELLED);
+    }
+  }
+
+  return 0;
+}
+
+/* the bytes fetched for thumbnails, including failed ones. */
+gint omvp_hls_get_stats(OMVPHlsStats *stats) {
+
+  *stats = _omvp_hls_get_shared()->stats;
+
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_HLS_H_
+#define _OMVP_HLS_H_
+
+#include <glib.h>
+
+typedef void *OMVPHlsRequest;
+
+typedef struct _OMVPHlsVariant {
+  gchar *uri;
+  gint bandwidth;
+  gint width;
+  gint height;
+  gboolean has_video;
+  gboolean is_iframe;
+} OMVPHlsVariant;
+
+typedef struct _OMVPHlsStats {
+  guint64 num_thumbnails;
+  guint64 num_bytes;
+  gsize last_num_bytes;
+} OMVPHlsStats;
+
+/* called from the main loop with the fetched data, or NULL on failure. */
+typedef void (*OMVPHlsCallback)(GBytes *data, gpointer user_data);
+
+extern gboolean omvp_hls_is_playlist_uri(const gchar *uri);
+extern GPtrArray *omvp_hls_parse_master(const gchar *data, gsize len,
+  const gchar *base_uri);
+extern const OMVPHlsVariant *omvp_hls_select_variant(GPtrArray *variants,
+  gint min_width, gint min_height, gboolean iframe);
+extern const OMVPHlsVariant *omvp_hls_lookup_variant(const gchar *uri,
+  gint min_width, gint min_height, gboolean iframe);
+extern OMVPHlsRequest omvp_hls_fetch_iframe(const gchar *playlist_uri,
+  OMVPHlsCallback callback, gpointer user_data);
+extern OMVPHlsRequest omvp_hls_fetch_keyframe(const gchar *playlist_uri,
+  OMVPHlsCallback callback, gpointer user_data);
+extern gint omvp_hls_cancel(OMVPHlsRequest request);
+extern gint omvp_hls_get_stats(OMVPHlsStats *stats);
+
+#endif /* _OMVP_HLS_H_ */
@@ -0,0 +1,465 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <libsoup/soup.h>
+#include "omvp_hls.h"
+#include "omvp_ts.h"
+#include "omvp_test_util.h"
+
+#define _OMVP_HLS_TEST_PMT_PID 0x100
+#define _OMVP_HLS_TEST_VIDEO_PID 0x101
+/* about 4MB, far more than one range window of a keyframe fetch. */
+#define _OMVP_HLS_TEST_NUM_PACKETS 20480
+/* the access units of the segment, as first packet and number of packets. */
+#define _OMVP_HLS_TEST_KEYFRAME 5
+#define _OMVP_HLS_TEST_KEYFRAME_PACKETS 5
+#define _OMVP_HLS_TEST_NEXT_FRAME 10
+#define _OMVP_HLS_TEST_SCAN_WIDTH 480
+#define _OMVP_HLS_TEST_SCAN_HEIGHT 270
+
+/*
+  The sample tree has an audio-only variant, four video variants out of
+  bandwidth order and two I-frame playlists. Only 360p has media
+  playlists, whose newest segment is seg1.ts.
+*/
+static const gchar _omvp_hls_test_master[] =
+  "#EXTM3U\n"
+  "#EXT-X-STREAM-INF:BANDWIDTH=64000,CODECS=\"mp4a.40.2\"\n"
+  "audio/index.m3u8\n"
+  "#EXT-X-STREAM-INF:BANDWIDTH=400000,RESOLUTION=416x234,"
+  "CODECS=\"avc1.42e00d,mp4a.40.2\"\n"
+  "234p/index.m3u8\n"
+  "#EXT-X-STREAM-INF:BANDWIDTH=5000000,RESOLUTION=1920x1080,"
+  "CODECS=\"avc1.640028,mp4a.40.2\"\n"
+  "1080p/index.m3u8\n"
+  "#EXT-X-STREAM-INF:BANDWIDTH=800000,RESOLUTION=640x360,"
+  "CODECS=\"avc1.4d401e,mp4a.40.2\"\n"
+  "360p/index.m3u8\n"
+  "#EXT-X-STREAM-INF:BANDWIDTH=2000000,RESOLUTION=1280x720,"
+  "CODECS=\"avc1.4d401f,mp4a.40.2\"\n"
+  "720p/index.m3u8\n"
+  "#EXT-X-I-FRAME-STREAM-INF:BANDWIDTH=300000,RESOLUTION=1280x720,"
+  "CODECS=\"avc1.4d401f\",URI=\"720p/iframe.m3u8\"\n"
+  "#EXT-X-I-FRAME-STREAM-INF:BANDWIDTH=90000,RESOLUTION=640x360,"
+  "CODECS=\"avc1.4d401e\",URI=\"360p/iframe.m3u8\"\n";
+
+static const gchar _omvp_hls_test_media[] =
+  "#EXTM3U\n"
+  "#EXT-X-VERSION:3\n"
+  "#EXT-X-TARGETDURATION:2\n"
+  "#EXT-X-MEDIA-SEQUENCE:0\n"
+  "#EXTINF:2.0,\n"
+  "seg0.ts\n"
+  "#EXTINF:2.0,\n"
+  "seg1.ts\n";
+
+/* the PAT and PMT as the map, and the keyframe as the only I-frame. */
+static const gchar _omvp_hls_test_iframe[] =
+  "#EXTM3U\n"
+  "#EXT-X-VERSION:4\n"
+  "#EXT-X-TARGETDURATION:2\n"
+  "#EXT-X-I-FRAMES-ONLY\n"
+  "#EXT-X-MAP:URI=\"seg1.ts\",BYTERANGE=\"376@0\"\n"
+  "#EXTINF:2.0,\n"
+  "#EXT-X-BYTERANGE:940@940\n"
+  "seg1.ts\n";
+
+/* the server runs in its own thread, so the state is shared under a lock. */
+typedef struct _OMVPHlsTestServer {
+  GMutex lock;
+  OMVPTestUtilServer server;
+  GHashTable *files;
+  GHashTable *num_requests;
+} OMVPHlsTestServer;
+
+typedef struct _OMVPHlsTestLookup {
+  const gchar *uri;
+  gint min_width;
+  gint min_height;
+  gboolean iframe;
+  const OMVPHlsVariant *variant;
+} OMVPHlsTestLookup;
+
+typedef struct _OMVPHlsTestResult {
+  gboolean is_done;
+  GBytes *data;
+} OMVPHlsTestResult;
+
+static OMVPHlsTestServer _omvp_hls_test_server;
+static guint8 _omvp_hls_test_segment[
+  _OMVP_HLS_TEST_NUM_PACKETS * OMVP_TS_PACKET_SIZE];
+
+static gint _omvp_hls_test_make_segment(void);
+static void _omvp_hls_test_on_request(SoupServer *server, SoupMessage *msg,
+  const char *path, GHashTable *query, SoupClientContext *client,
+  gpointer user_data);
+static gint _omvp_hls_test_server_add(const gchar *path, gconstpointer data,
+  gsize size);
+static gint _omvp_hls_test_server_start(void);
+static gint _omvp_hls_test_server_stop(void);
+static gint _omvp_hls_test_get_num_requests(const gchar *path);
+static gchar *_omvp_hls_test_uri(const gchar *path);
+static gboolean _omvp_hls_test_has_variant(gpointer user_data);
+static const OMVPHlsVariant *_omvp_hls_test_wait_variant(const gchar *uri,
+  gint min_width, gint min_height, gboolean iframe);
+static void _omvp_hls_test_on_thumbnail(GBytes *data, gpointer user_data);
+static gboolean _omvp_hls_test_is_done(gpointer user_data);
+static gboolean _omvp_hls_test_wait_result(OMVPHlsTestResult *result);
+static GBytes *_omvp_hls_test_expected_frame(void);
+static void _omvp_hls_test_assert_variant(const OMVPHlsVariant *variant,
+  const gchar *path);
+static void _omvp_hls_test_lookup(void);
+static void _omvp_hls_test_keyframe(void);
+static void _omvp_hls_test_iframe(void);
+
+/*
+  A PAT and a PMT, then a frame, the keyframe and the frames after it,
+  which fill the rest of the segment.
+*/
+static gint _omvp_hls_test_make_segment(void) {
+  static const guint8 pat[] = {
+    0x00, 0x01, 0xe0 | (_OMVP_HLS_TEST_PMT_PID >> 8),
+    _OMVP_HLS_TEST_PMT_PID & 0xff
+  };
+  static const guint8 pmt[] = {
+    0xe0 | (_OMVP_HLS_TEST_VIDEO_PID >> 8), _OMVP_HLS_TEST_VIDEO_PID & 0xff,
+    0xf0, 0x00,
+    0x1b, 0xe0 | (_OMVP_HLS_TEST_VIDEO_PID >> 8),
+    _OMVP_HLS_TEST_VIDEO_PID & 0xff, 0xf0, 0x00
+  };
+  guint8 *packet;
+  gint i;
+
+  packet = _omvp_hls_test_segment;
+  packet = omvp_test_util_ts_section(packet, 0x0000, 0, 0x00, 1, 0, pat,
+    sizeof(pat));
+  packet = omvp_test_util_ts_section(packet, _OMVP_HLS_TEST_PMT_PID, 0,
+    0x02, 1, 0, pmt, sizeof(pmt));
+  for (i = 2; i < _OMVP_HLS_TEST_NUM_PACKETS; i++) {
+    if (i == 2 || i == _OMVP_HLS_TEST_NEXT_FRAME) {
+      packet = omvp_test_util_ts_pes(packet, _OMVP_HLS_TEST_VIDEO_PID,
+        FALSE);
+    } else if (i == _OMVP_HLS_TEST_KEYFRAME) {
+      packet = omvp_test_util_ts_pes(packet, _OMVP_HLS_TEST_VIDEO_PID,
+        TRUE);
+    } else {
+      packet = omvp_test_util_ts_header(packet, _OMVP_HLS_TEST_VIDEO_PID,
+        FALSE, (guint8)i);
+    }
+  }
+
+  return 0;
+}
+
+/* a Range request is answered with the part, like a real HLS origin. */
+static void _omvp_hls_test_on_request(SoupServer *server, SoupMessage *msg,
+  const char *path, GHashTable *query, SoupClientContext *client,
+  gpointer user_data) {
+  OMVPHlsTestServer *test_server;
+  SoupRange *ranges;
+  GBytes *file;
+  const guint8 *data;
+  gsize size;
+  gint num_ranges;
+
+  (void)server;
+  (void)query;
+  (void)client;
+
+  test_server = (OMVPHlsTestServer *)user_data;
+
+  g_mutex_lock(&test_server->lock);
+  g_hash_table_insert(test_server->num_requests, g_strdup(path),
+    GINT_TO_POINTER(GPOINTER_TO_INT(g_hash_table_lookup(
+    test_server->num_requests, path)) + 1));
+  file = g_hash_table_lookup(test_server->files, path);
+  g_mutex_unlock(&test_server->lock);
+
+  if (!file) {
+    soup_message_set_status(msg, SOUP_STATUS_NOT_FOUND);
+    return;
+  }
+  data = g_bytes_get_data(file, &size);
+  if (soup_message_headers_get_ranges(msg->request_headers, size, &ranges,
+    &num_ranges)) {
+    soup_message_headers_set_content_range(msg->response_headers,
+      ranges[0].start, ranges[0].end, size);
+    soup_message_set_status(msg, SOUP_STATUS_PARTIAL_CONTENT);
+    soup_message_set_response(msg, "video/mp2t", SOUP_MEMORY_COPY,
+      (const char *)data + ranges[0].start,
+      ranges[0].end - ranges[0].start + 1);
+    soup_message_headers_free_ranges(msg->request_headers, ranges);
+  } else {
+    soup_message_set_status(msg, SOUP_STATUS_OK);
+    soup_message_set_response(msg, g_str_has_suffix(path, ".ts") ?
+      "video/mp2t" : "application/vnd.apple.mpegurl", SOUP_MEMORY_COPY,
+      (const char *)data, size);
+  }
+}
+
+static gint _omvp_hls_test_server_add(const gchar *path, gconstpointer data,
+  gsize size) {
+  OMVPHlsTestServer *test_server;
+
+  test_server = &_omvp_hls_test_server;
+  g_hash_table_insert(test_server->files, g_strdup(path),
+    g_bytes_new_static(data, size));
+
+  return 0;
+}
+
+static gint _omvp_hls_test_server_start(void) {
+  OMVPHlsTestServer *test_server;
+
+  test_server = &_omvp_hls_test_server;
+  g_mutex_init(&test_server->lock);
+  test_server->files = g_hash_table_new_full(g_str_hash, g_str_equal,
+    g_free, (GDestroyNotify)g_bytes_unref);
+  test_server->num_requests = g_hash_table_new_full(g_str_hash,
+    g_str_equal, g_free, NULL);
+
+  _omvp_hls_test_make_segment();
+  _omvp_hls_test_server_add("/live/master.m3u8", _omvp_hls_test_master,
+    strlen(_omvp_hls_test_master));
+  _omvp_hls_test_server_add("/live/360p/index.m3u8", _omvp_hls_test_media,
+    strlen(_omvp_hls_test_media));
+  _omvp_hls_test_server_add("/live/360p/iframe.m3u8", _omvp_hls_test_iframe,
+    strlen(_omvp_hls_test_iframe));
+  _omvp_hls_test_server_add("/live/360p/seg0.ts", _omvp_hls_test_segment,
+    sizeof(_omvp_hls_test_segment));
+  _omvp_hls_test_server_add("/live/360p/seg1.ts", _omvp_hls_test_segment,
+    sizeof(_omvp_hls_test_segment));
+
+  test_server->server = omvp_test_util_server_open(
+    _omvp_hls_test_on_request, test_server);
+
+  return 0;
+}
+
+static gint _omvp_hls_test_server_stop(void) {
+  OMVPHlsTestServer *test_server;
+
+  test_server = &_omvp_hls_test_server;
+  omvp_test_util_server_close(test_server->server);
+  g_hash_table_destroy(test_server->files);
+  g_hash_table_destroy(test_server->num_requests);
+  g_mutex_clear(&test_server->lock);
+
+  return 0;
+}
+
+static gint _omvp_hls_test_get_num_requests(const gchar *path) {
+  OMVPHlsTestServer *test_server;
+  gint num_requests;
+
+  test_server = &_omvp_hls_test_server;
+  g_mutex_lock(&test_server->lock);
+  num_requests = GPOINTER_TO_INT(g_hash_table_lookup(
+    test_server->num_requests, path));
+  g_mutex_unlock(&test_server->lock);
+
+  return num_requests;
+}
+
+static gchar *_omvp_hls_test_uri(const gchar *path) {
+  return omvp_test_util_server_get_uri(_omvp_hls_test_server.server, path);
+}
+
+static gboolean _omvp_hls_test_has_variant(gpointer user_data) {
+  OMVPHlsTestLookup *lookup;
+
+  lookup = (OMVPHlsTestLookup *)user_data;
+  lookup->variant = omvp_hls_lookup_variant(lookup->uri, lookup->min_width,
+    lookup->min_height, lookup->iframe);
+
+  return lookup->variant != NULL;
+}
+
+static const OMVPHlsVariant *_omvp_hls_test_wait_variant(const gchar *uri,
+  gint min_width, gint min_height, gboolean iframe) {
+  OMVPHlsTestLookup lookup;
+
+  lookup.uri = uri;
+  lookup.min_width = min_width;
+  lookup.min_height = min_height;
+  lookup.iframe = iframe;
+  lookup.variant = NULL;
+  omvp_test_util_wait(_omvp_hls_test_has_variant, &lookup);
+
+  return lookup.variant;
+}
+
+static void _omvp_hls_test_on_thumbnail(GBytes *data, gpointer user_data) {
+  OMVPHlsTestResult *result;
+
+  result = (OMVPHlsTestResult *)user_data;
+  result->is_done = TRUE;
+  result->data = data ? g_bytes_ref(data) : NULL;
+}
+
+static gboolean _omvp_hls_test_is_done(gpointer user_data) {
+  return ((OMVPHlsTestResult *)user_data)->is_done;
+}
+
+static gboolean _omvp_hls_test_wait_result(OMVPHlsTestResult *result) {
+  return omvp_test_util_wait(_omvp_hls_test_is_done, result);
+}
+
+/* the PAT and the PMT in front of the packets of the keyframe. */
+static GBytes *_omvp_hls_test_expected_frame(void) {
+  GByteArray *frame;
+
+  frame = g_byte_array_new();
+  g_byte_array_append(frame, _omvp_hls_test_segment,
+    2 * OMVP_TS_PACKET_SIZE);
+  g_byte_array_append(frame, _omvp_hls_test_segment +
+    _OMVP_HLS_TEST_KEYFRAME * OMVP_TS_PACKET_SIZE,
+    _OMVP_HLS_TEST_KEYFRAME_PACKETS * OMVP_TS_PACKET_SIZE);
+
+  return g_byte_array_free_to_bytes(frame);
+}
+
+static void _omvp_hls_test_assert_variant(const OMVPHlsVariant *variant,
+  const gchar *path) {
+  gchar *uri;
+
+  g_assert(variant);
+  uri = _omvp_hls_test_uri(path);
+  g_assert_cmpstr(variant->uri, ==, uri);
+  g_free(uri);
+}
+
+/*
+  A scan takes the lowest bandwidth variant that still covers the scan size,
+  and a focus starts on the lowest video variant. The master is fetched
+  once for all of them.
+*/
+static void _omvp_hls_test_lookup(void) {
+  const OMVPHlsVariant *variant;
+  gchar *uri;
+
+  uri = _omvp_hls_test_uri("/live/master.m3u8");
+  variant = omvp_hls_lookup_variant(uri, _OMVP_HLS_TEST_SCAN_WIDTH,
+    _OMVP_HLS_TEST_SCAN_HEIGHT, FALSE);
+  g_assert(variant == NULL);
+
+  variant = _omvp_hls_test_wait_variant(uri, _OMVP_HLS_TEST_SCAN_WIDTH,
+    _OMVP_HLS_TEST_SCAN_HEIGHT, FALSE);
+  _omvp_hls_test_assert_variant(variant, "/live/360p/index.m3u8");
+  g_assert_cmpint(variant->bandwidth, ==, 800000);
+  g_assert_cmpint(variant->width, ==, 640);
+  g_assert_cmpint(variant->height, ==, 360);
+
+  variant = omvp_hls_lookup_variant(uri, _OMVP_HLS_TEST_SCAN_WIDTH,
+    _OMVP_HLS_TEST_SCAN_HEIGHT, TRUE);
+  _omvp_hls_test_assert_variant(variant, "/live/360p/iframe.m3u8");
+  g_assert(variant->is_iframe);
+
+  variant = omvp_hls_lookup_variant(uri, 0, 0, FALSE);
+  _omvp_hls_test_assert_variant(variant, "/live/234p/index.m3u8");
+
+  variant = omvp_hls_lookup_variant(uri, 1280, 720, FALSE);
+  _omvp_hls_test_assert_variant(variant, "/live/720p/index.m3u8");
+
+  /* nothing covers it, so the largest is as close as it gets. */
+  variant = omvp_hls_lookup_variant(uri, 3840, 2160, FALSE);
+  _omvp_hls_test_assert_variant(variant, "/live/1080p/index.m3u8");
+
+  g_assert_cmpint(_omvp_hls_test_get_num_requests("/live/master.m3u8"), ==,
+    1);
+  g_free(uri);
+}
+
+/*
+  The keyframe of the newest segment comes with the PAT and PMT, and the
+  transfer stops at the next frame, so a scan reads a small part of the
+  segment.
+*/
+static void _omvp_hls_test_keyframe(void) {
+  OMVPHlsTestResult result = {FALSE, NULL};
+  OMVPHlsRequest request;
+  OMVPHlsStats stats;
+  GBytes *expected;
+  gchar *uri;
+  gboolean ok;
+
+  uri = _omvp_hls_test_uri("/live/360p/index.m3u8");
+  request = omvp_hls_fetch_keyframe(uri, _omvp_hls_test_on_thumbnail,
+    &result);
+  g_assert(request);
+  ok = _omvp_hls_test_wait_result(&result);
+  g_assert(ok);
+  g_assert(result.data);
+
+  expected = _omvp_hls_test_expected_frame();
+  g_assert(g_bytes_equal(result.data, expected));
+  g_bytes_unref(expected);
+  g_bytes_unref(result.data);
+
+  omvp_hls_get_stats(&stats);
+  g_test_message("keyframe of a %" G_GSIZE_FORMAT " byte segment in %"
+    G_GSIZE_FORMAT " bytes", sizeof(_omvp_hls_test_segment),
+    stats.last_num_bytes);
+  g_assert_cmpuint(stats.last_num_bytes * 10, <,
+    sizeof(_omvp_hls_test_segment));
+  g_assert_cmpint(_omvp_hls_test_get_num_requests("/live/360p/seg0.ts"), ==,
+    0);
+  g_assert_cmpint(_omvp_hls_test_get_num_requests("/live/360p/seg1.ts"), ==,
+    1);
+  g_free(uri);
+}
+
+/* the map and the I-frame are read with range requests only. */
+static void _omvp_hls_test_iframe(void) {
+  OMVPHlsTestResult result = {FALSE, NULL};
+  OMVPHlsRequest request;
+  GBytes *expected;
+  gchar *uri;
+  gboolean ok;
+
+  uri = _omvp_hls_test_uri("/live/360p/iframe.m3u8");
+  request = omvp_hls_fetch_iframe(uri, _omvp_hls_test_on_thumbnail, &result);
+  g_assert(request);
+  ok = _omvp_hls_test_wait_result(&result);
+  g_assert(ok);
+  g_assert(result.data);
+
+  expected = _omvp_hls_test_expected_frame();
+  g_assert(g_bytes_equal(result.data, expected));
+  g_bytes_unref(expected);
+  g_bytes_unref(result.data);
+  g_free(uri);
+}
+
+int main(int argc, char *argv[]) {
+  gint ret;
+
+  g_test_init(&argc, &argv, NULL);
+
+  _omvp_hls_test_server_start();
+  g_test_add_func("/hls/lookup", _omvp_hls_test_lookup);
+  g_test_add_func("/hls/keyframe", _omvp_hls_test_keyframe);
+  g_test_add_func("/hls/iframe", _omvp_hls_test_iframe);
+  ret = g_test_run();
+  _omvp_hls_test_server_stop();
+
+  return ret;
+}
@@ -0,0 +1,426 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <pango/pangocairo.h>
+#include "omvp_labels.h"
+
+#define _OMVP_LABELS_PAGE_SIZE 1024
+#define _OMVP_LABELS_PAD 1
+/* the on-screen scale may change this much before labels are re-rendered. */
+#define _OMVP_LABELS_SCALE_TOLERANCE 0.01f
+
+static void _omvp_labels_dispose(GObject *object);
+static void _omvp_labels_finalize(GObject *object);
+static void _omvp_labels_paint_node(ClutterActor *actor,
+  ClutterPaintNode *root);
+static gboolean _omvp_labels_get_paint_volume(ClutterActor *actor,
+  ClutterPaintVolume *volume);
+static gint _omvp_labels_reset(OMVPLabels *labels);
+static gint _omvp_labels_reset_cells(OMVPLabels *labels);
+static gboolean _omvp_labels_is_visible(OMVPLabels *labels, gint vid_idx);
+static gint _omvp_labels_alloc_cell(OMVPLabels *labels);
+static gint _omvp_labels_render(OMVPLabels *labels, gint vid_idx);
+
+G_DEFINE_TYPE(OMVPLabels, omvp_labels, CLUTTER_TYPE_ACTOR)
+
+static void omvp_labels_class_init(OMVPLabelsClass *klass) {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS(klass);
+
+  gobject_class->dispose = _omvp_labels_dispose;
+  gobject_class->finalize = _omvp_labels_finalize;
+  actor_class->paint_node = _omvp_labels_paint_node;
+  actor_class->get_paint_volume = _omvp_labels_get_paint_volume;
+}
+
+static void omvp_labels_init(OMVPLabels *labels) {
+  labels->pages = g_ptr_array_new_with_free_func(cogl_object_unref);
+  labels->cell_links = g_ptr_array_new();
+  g_queue_init(&labels->lru);
+  labels->min_x = 0;
+  labels->max_x = -1;
+  labels->min_y = 0;
+  labels->max_y = -1;
+}
+
+static void _omvp_labels_dispose(GObject *object) {
+  OMVPLabels *labels = OMVP_LABELS(object);
+
+  g_ptr_array_set_size(labels->pages, 0);
+  g_ptr_array_set_size(labels->cell_links, 0);
+  g_queue_clear(&labels->lru);
+
+  G_OBJECT_CLASS(omvp_labels_parent_class)->dispose(object);
+}
+
+static void _omvp_labels_finalize(GObject *object) {
+  OMVPLabels *labels = OMVP_LABELS(object);
+
+  g_ptr_array_free(labels->pages, TRUE);
+  g_ptr_array_free(labels->cell_links, TRUE);
+  g_free(labels->cells);
+  g_free(labels->cell_vids);
+  if (labels->surface) {
+    cairo_surface_destroy(labels->surface);
+  }
+  pango_font_description_free(labels->font_desc);
+
+  G_OBJECT_CLASS(omvp_labels_parent_class)->finalize(object);
+}
+
+/*
+  Every label of the window is a textured quad in the atlas page it was
+  rendered to, so drawing all of them takes one paint node per page.
+*/
+static void _omvp_labels_paint_node(ClutterActor *actor,
+  ClutterPaintNode *root) {
+  OMVPLabels *labels = OMVP_LABELS(actor);
+  ClutterColor color = {255, 255, 255, 255};
+  ClutterPaintNode **nodes;
+  ClutterActorBox box;
+  gfloat offset, quad_width, quad_height;
+  gfloat s, t;
+  gint vid_idx, cell, page, cell_x, cell_y;
+  gint x, y;
+
+  if (labels->vids == NULL || labels->pages->len == 0) {
+    return;
+  }
+
+  color.alpha = clutter_actor_get_paint_opacity(actor);
+  nodes = g_new0(ClutterPaintNode *, labels->pages->len);
+
+  offset = labels->tile_size * (1.0f - labels->tile_scale) / 2.0f -
+    (gfloat)_OMVP_LABELS_PAD * labels->tile_scale / labels->raster_scale;
+  quad_width = (gfloat)labels->cell_width * labels->tile_scale /
+    labels->raster_scale;
+  quad_height = (gfloat)labels->cell_height * labels->tile_scale /
+    labels->raster_scale;
+  s = (gfloat)labels->cell_width / (gfloat)_OMVP_LABELS_PAGE_SIZE;
+  t = (gfloat)labels->cell_height / (gfloat)_OMVP_LABELS_PAGE_SIZE;
+
+  for (y = labels->min_y; y <= labels->max_y; y++) {
+    for (x = labels->min_x; x <= labels->max_x; x++) {
+      vid_idx = y * labels->num_per_row + x;
+      if (vid_idx >= labels->vids->num_vids) {
+        break;
+      }
+      cell = labels->cells[vid_idx];
+      if (cell < 0) {
+        continue;
+      }
+      page = cell / labels->num_cells_per_page;
+      cell %= labels->num_cells_per_page;
+      cell_x = cell % labels->num_cells_per_row;
+      cell_y = cell / labels->num_cells_per_row;
+      if (nodes[page] == NULL) {
+        nodes[page] = clutter_texture_node_new(
+          g_ptr_array_index(labels->pages, page), &color,
+          CLUTTER_SCALING_FILTER_LINEAR, CLUTTER_SCALING_FILTER_LINEAR);
+        clutter_paint_node_set_name(nodes[page], "OMVP Labels");
+      }
+      box.x1 = (gfloat)x * labels->tile_size + offset;
+      box.y1 = (gfloat)y * labels->tile_size + offset;
+      box.x2 = box.x1 + quad_width;
+      box.y2 = box.y1 + quad_height;
+      clutter_paint_node_add_texture_rectangle(nodes[page], &box,
+        (gfloat)cell_x * s, (gfloat)cell_y * t,
+        (gfloat)(cell_x + 1) * s, (gfloat)(cell_y + 1) * t);
+    }
+  }
+
+  for (page = 0; page < (gint)labels->pages->len; page++) {
+    if (nodes[page]) {
+      clutter_paint_node_add_child(root, nodes[page]);
+      clutter_paint_node_unref(nodes[page]);
+    }
+  }
+  g_free(nodes);
+}
+
+static gboolean _omvp_labels_get_paint_volume(ClutterActor *actor,
+  ClutterPaintVolume *volume) {
+
+  return clutter_paint_volume_set_from_allocation(volume, actor);
+}
+
+static gint _omvp_labels_reset(OMVPLabels *labels) {
+  g_free(labels->cells);
+  labels->cells = NULL;
+  if (labels->vids) {
+    labels->cells = g_new(gint, labels->vids->num_vids);
+  }
+
+  return _omvp_labels_reset_cells(labels);
+}
+
+/*
+  Drops every rendered label together with the atlas pages, which are
+  allocated again on demand for the current cell size.
+*/
+static gint _omvp_labels_reset_cells(OMVPLabels *labels) {
+  gint i;
+
+  g_ptr_array_set_size(labels->pages, 0);
+  g_ptr_array_set_size(labels->cell_links, 0);
+  g_queue_clear(&labels->lru);
+  g_free(labels->cell_vids);
+  labels->cell_vids = NULL;
+  if (labels->vids == NULL) {
+    return 0;
+  }
+
+  for (i = 0; i < labels->vids->num_vids; i++) {
+    labels->cells[i] = -1;
+  }
+
+  return 0;
+}
+
+static gboolean _omvp_labels_is_visible(OMVPLabels *labels, gint vid_idx) {
+  gint x, y;
+
+  x = vid_idx % labels->num_per_row;
+  y = vid_idx / labels->num_per_row;
+
+  return x >= labels->min_x && x <= labels->max_x &&
+    y >= labels->min_y && y <= labels->max_y;
+}
+
+/*
+  Cells are kept in least recently used order. The oldest cell is taken
+  over unless its label is inside the window, in which case every cell is
+  in use and the atlas grows by one page. So the atlas only ever holds as
+  many pages as the largest window needs.
+*/
+static gint _omvp_labels_alloc_cell(OMVPLabels *labels) {
+  CoglTexture *page;
+  GList *link;
+  gint num_cells;
+  gint vid_idx;
+  gint cell;
+  gint i;
+
+  link = g_queue_peek_head_link(&labels->lru);
+  vid_idx = link ? labels->cell_vids[GPOINTER_TO_INT(link->data)] : -1;
+  if (link == NULL ||
+    (vid_idx >= 0 && _omvp_labels_is_visible(labels, vid_idx))) {
+    page = cogl_texture_new_with_size(_OMVP_LABELS_PAGE_SIZE,
+      _OMVP_LABELS_PAGE_SIZE, COGL_TEXTURE_NO_SLICING,
+      COGL_PIXEL_FORMAT_RGBA_8888_PRE);
+    if (page == NULL) {
+      g_warning("Failed to create a label atlas page");
+      return -1;
+    }
+    g_ptr_array_add(labels->pages, page);
+    num_cells = labels->pages->len * labels->num_cells_per_page;
+    labels->cell_vids = g_renew(gint, labels->cell_vids, num_cells);
+    for (i = labels->cell_links->len; i < num_cells; i++) {
+      labels->cell_vids[i] = -1;
+      g_queue_push_head(&labels->lru, GINT_TO_POINTER(i));
+      g_ptr_array_add(labels->cell_links,
+        g_queue_peek_head_link(&labels->lru));
+    }
+    link = g_queue_peek_head_link(&labels->lru);
+  }
+
+  cell = GPOINTER_TO_INT(link->data);
+  if (labels->cell_vids[cell] >= 0) {
+    labels->cells[labels->cell_vids[cell]] = -1;
+    labels->cell_vids[cell] = -1;
+  }
+  g_queue_unlink(&labels->lru, link);
+  g_queue_push_tail_link(&labels->lru, link);
+
+  return cell;
+}
+
+/* Rasterizes the label of vid_idx at the on-screen scale into a cell. */
+static gint _omvp_labels_render(OMVPLabels *labels, gint vid_idx) {
+  PangoLayout *layout;
+  PangoAttrList *attrs;
+  CoglTexture *page;
+  cairo_t *cr;
+  gchar *str;
+  gint cell, cell_x, cell_y;
+
+  cell = _omvp_labels_alloc_cell(labels);
+  if (cell < 0) {
+    return -1;
+  }
+  labels->cells[vid_idx] = cell;
+  labels->cell_vids[cell] = vid_idx;
+  page = g_ptr_array_index(labels->pages, cell / labels->num_cells_per_page);
+  cell %= labels->num_cells_per_page;
+  cell_x = cell % labels->num_cells_per_row;
+  cell_y = cell / labels->num_cells_per_row;
+
+  cr = cairo_create(labels->surface);
+  cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
+  cairo_paint(cr);
+  cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+  cairo_translate(cr, _OMVP_LABELS_PAD, _OMVP_LABELS_PAD);
+  cairo_scale(cr, labels->raster_scale, labels->raster_scale);
+  cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+
+  layout = pango_cairo_create_layout(cr);
+  pango_layout_set_font_description(layout, labels->font_desc);
+  pango_layout_set_width(layout, (gint)labels->tile_size * PANGO_SCALE);
+  pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+  attrs = pango_attr_list_new();
+  pango_attr_list_insert(attrs, pango_attr_background_new(0, 0, 0));
+  pango_layout_set_attributes(layout, attrs);
+  pango_attr_list_unref(attrs);
+  str = g_strdup_printf("%s\n%s",
+    labels->vids->ids[vid_idx], labels->vids->names[vid_idx]);
+  pango_layout_set_text(layout, str, -1);
+  g_free(str);
+  pango_cairo_show_layout(cr, layout);
+  g_object_unref(layout);
+  cairo_destroy(cr);
+  cairo_surface_flush(labels->surface);
+
+  cogl_texture_set_region(page, 0, 0,
+    cell_x * labels->cell_width, cell_y * labels->cell_height,
+    labels->cell_width, labels->cell_height,
+    labels->cell_width, labels->cell_height,
+    CLUTTER_CAIRO_FORMAT_ARGB32,
+    cairo_image_surface_get_stride(labels->surface),
+    cairo_image_surface_get_data(labels->surface));
+
+  return 0;
+}
+
+ClutterActor *omvp_labels_new(const gchar *font, gfloat tile_size,
+  gfloat tile_scale) {
+  OMVPLabels *labels;
+  PangoLayout *layout;
+  cairo_t *cr;
+
+  labels = g_object_new(OMVP_TYPE_LABELS, NULL);
+  labels->font_desc = pango_font_description_from_string(font);
+  labels->tile_size = tile_size;
+  labels->tile_scale = tile_scale;
+
+  labels->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+  cr = cairo_create(labels->surface);
+  layout = pango_cairo_create_layout(cr);
+  pango_layout_set_font_description(layout, labels->font_desc);
+  pango_layout_set_text(layout, "Ag\nAg", -1);
+  pango_layout_get_pixel_size(layout, NULL, &labels->text_height);
+  g_object_unref(layout);
+  cairo_destroy(cr);
+  cairo_surface_destroy(labels->surface);
+  labels->surface = NULL;
+
+  omvp_labels_set_scale(labels, 1.0f);
+
+  return CLUTTER_ACTOR(labels);
+}
+
+gint omvp_labels_set_vids(OMVPLabels *labels, OMVPVids *vids,
+  gint num_per_row) {
+
+  labels->vids = vids;
+  labels->num_per_row = num_per_row;
+  _omvp_labels_reset(labels);
+  clutter_actor_queue_redraw(CLUTTER_ACTOR(labels));
+
+  return 0;
+}
+
+gint omvp_labels_set_window(OMVPLabels *labels, gint min_x, gint max_x,
+  gint min_y, gint max_y) {
+  GList *link;
+  gint vid_idx;
+  gint x, y;
+
+  labels->min_x = min_x;
+  labels->max_x = max_x;
+  labels->min_y = min_y;
+  labels->max_y = max_y;
+  if (labels->vids == NULL) {
+    return 0;
+  }
+
+  for (y = min_y; y <= max_y; y++) {
+    for (x = min_x; x <= max_x; x++) {
+      vid_idx = y * labels->num_per_row + x;
+      if (vid_idx >= labels->vids->num_vids) {
+        break;
+      }
+      if (labels->cells[vid_idx] >= 0) {
+        link = g_ptr_array_index(labels->cell_links, labels->cells[vid_idx]);
+        g_queue_unlink(&labels->lru, link);
+        g_queue_push_tail_link(&labels->lru, link);
+      } else if (_omvp_labels_render(labels, vid_idx) != 0) {
+        break;
+      }
+    }
+  }
+  clutter_actor_queue_redraw(CLUTTER_ACTOR(labels));
+
+  return 0;
+}
+
+/*
+  Sets how many screen pixels one unit of the actor covers. Labels are
+  rasterized at that scale so they stay sharp, and are rendered again when
+  the zoom changes.
+*/
+gint omvp_labels_set_scale(OMVPLabels *labels, gfloat scale) {
+  gfloat raster_scale;
+
+  raster_scale = scale * labels->tile_scale;
+  raster_scale = MIN(raster_scale,
+    (gfloat)(_OMVP_LABELS_PAGE_SIZE - _OMVP_LABELS_PAD * 2) /
+    labels->tile_size);
+  raster_scale = MIN(raster_scale,
+    (gfloat)(_OMVP_LABELS_PAGE_SIZE - _OMVP_LABELS_PAD * 2) /
+    (gfloat)MAX(labels->text_height, 1));
+  if (raster_scale <= 0.0f) {
+    return -1;
+  }
+  if (labels->surface &&
+    ABS(raster_scale - labels->raster_scale) <=
+    labels->raster_scale * _OMVP_LABELS_SCALE_TOLERANCE) {
+    return 0;
+  }
+
+  labels->raster_scale = raster_scale;
+  labels->cell_width = (gint)(labels->tile_size * raster_scale + 0.5f) +
+    _OMVP_LABELS_PAD * 2;
+  labels->cell_height =
+    (gint)((gfloat)labels->text_height * raster_scale + 0.5f) +
+    _OMVP_LABELS_PAD * 2;
+  labels->num_cells_per_row = _OMVP_LABELS_PAGE_SIZE / labels->cell_width;
+  labels->num_cells_per_page = labels->num_cells_per_row *
+    (_OMVP_LABELS_PAGE_SIZE / labels->cell_height);
+  if (labels->surface) {
+    cairo_surface_destroy(labels->surface);
+  }
+  labels->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+    labels->cell_width, labels->cell_height);
+
+  _omvp_labels_reset_cells(labels);
+
+  return omvp_labels_set_window(labels, labels->min_x, labels->max_x,
+    labels->min_y, labels->max_y);
+}
@@ -0,0 +1,83 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_LABELS_H_
+#define _OMVP_LABELS_H_
+
+#include <clutter/clutter.h>
+#include "omvp_vids.h"
+
+#define OMVP_TYPE_LABELS (omvp_labels_get_type())
+#define OMVP_LABELS(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj), OMVP_TYPE_LABELS, OMVPLabels))
+#define OMVP_LABELS_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass), OMVP_TYPE_LABELS, OMVPLabelsClass))
+#define OMVP_IS_LABELS(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj), OMVP_TYPE_LABELS))
+#define OMVP_IS_LABELS_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass), OMVP_TYPE_LABELS))
+#define OMVP_LABELS_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS((obj), OMVP_TYPE_LABELS, OMVPLabelsClass))
+
+typedef struct _OMVPLabelsClass OMVPLabelsClass;
+typedef struct _OMVPLabels OMVPLabels;
+
+struct _OMVPLabelsClass {
+  ClutterActorClass parent_class;
+};
+
+struct _OMVPLabels {
+  ClutterActor parent_instance;
+
+  PangoFontDescription *font_desc;
+  gfloat tile_size;
+  gfloat tile_scale;
+  gint text_height;
+  gfloat raster_scale;
+  gint cell_width;
+  gint cell_height;
+  gint num_cells_per_row;
+  gint num_cells_per_page;
+
+  OMVPVids *vids;
+  gint num_per_row;
+  gint *cells;
+  GPtrArray *pages;
+  gint *cell_vids;
+  GPtrArray *cell_links;
+  GQueue lru;
+  cairo_surface_t *surface;
+
+  gint min_x;
+  gint max_x;
+  gint min_y;
+  gint max_y;
+};
+
+extern GType omvp_labels_get_type(void);
+extern ClutterActor *omvp_labels_new(const gchar *font, gfloat tile_size,
+  gfloat tile_scale);
+extern gint omvp_labels_set_vids(OMVPLabels *labels, OMVPVids *vids,
+  gint num_per_row);
+extern gint omvp_labels_set_window(OMVPLabels *labels, gint min_x,
+  gint max_x, gint min_y, gint max_y);
+extern gint omvp_labels_set_scale(OMVPLabels *labels, gfloat scale);
+
+#endif /* _OMVP_LABELS_H_ */
@@ -19,11 +19,18 @@
 */
 
 #include <string.h>
+#include <gio/gio.h>
 #include <clutter-gst/clutter-gst.h>
 #include "config.h"
 #include "omvp_vids.h"
+#include "omvp_fetch.h"
+#include "omvp_search.h"
 #include "omvp_gst.h"
 #include "omvp_gst_plugin.h"
+#include "omvp_labels.h"
+#include "omvp_badges.h"
+#include "omvp_monitor.h"
+#include "omvp_hls.h"
 
 #define _OMVP_WIDTH_RATIO 16
 #define _OMVP_HEIGHT_RATIO 9
@@ -33,19 +40,37 @@
 #define _OMVP_TEX_SIZE 500
 #define _OMVP_TEXT_FONT "Monospace Bold 10"
 #define _OMVP_SCAN_TEXT_FONT "Monospace Bold 50"
+#define _OMVP_SEARCH_TEXT_FONT "Monospace Bold 20"
+#define _OMVP_TILE_MARGIN 1
+#define _OMVP_DEBUG_TEXT_INTERVAL 250
+#define _OMVP_RELOAD_DELAY 500
+#define _OMVP_SEARCH_OPEN_DELAY 300
+#define _OMVP_SEARCH_RESET_DELAY 2000
+#define _OMVP_WATCHDOG_INTERVAL 1000
+#define _OMVP_STALL_TIMEOUT 10000
+#define _OMVP_RECONNECT_MIN_DELAY 500
+#define _OMVP_RECONNECT_MAX_DELAY 30000
+#define _OMVP_GOP_CACHE_NUM_RECENT 4
+/* the recent channels and the four neighbors of the focus. */
+#define _OMVP_GOP_CACHE_NUM_VIDS (_OMVP_GOP_CACHE_NUM_RECENT + 4)
 
 static gchar *_omvp_vids_filename = "omvp.m3u";
 static gchar *_omvp_proxy_uri;
 static gint _omvp_ani_duration = 300;
 static gint _omvp_num_vid_per_row;
+static gboolean _omvp_auto_num_vid_per_row;
 static gint _omvp_scan_num_jobs = 1;
 static gint _omvp_scan_timeout = 10 * 1000;
 static gint _omvp_text_info_timeout = 3 * 1000;
 static gint _omvp_scan_width = 480;
 static gint _omvp_scan_height = 270;
+static gint _omvp_max_idle_fps = 5;
+static gint _omvp_refresh_interval = 60;
+static gint _omvp_gop_cache_size = 4;
 static gdouble _omvp_default_volume = 0.5f;
 static gboolean _omvp_default_mute;
 static gboolean _omvp_no_text_info;
+static gboolean _omvp_no_monitor;
 static gboolean _omvp_show_debug;
 static gboolean _omvp_show_version;
 static gboolean _omvp_help_keys;
@@ -67,12 +92,21 @@ static GOptionEntry _omvp_entries[] = {
     "Scan video horizontal resolution", "width" },
   { "scan-height", 'h', 0, G_OPTION_ARG_INT, &_omvp_scan_height,
     "Scan video vertical resolution", "height" },
+  { "max-idle-fps", 'f', 0, G_OPTION_ARG_INT, &_omvp_max_idle_fps,
+    "Maximum scan video frame rate while idle, 0 for unlimited", "fps" },
+  { "refresh-interval", 'r', 0, G_OPTION_ARG_INT, &_omvp_refresh_interval,
+    "Remote playlist refresh interval in seconds, 0 to disable", "s" },
+  { "gop-cache", 0, 0, G_OPTION_ARG_INT, &_omvp_gop_cache_size,
+    "GOP cache per channel next to the focus in megabytes, 0 to disable",
+    "MB" },
   { "volume", 'v', 0, G_OPTION_ARG_DOUBLE, &_omvp_default_volume,
     "Volume from 0.0(0%) to 1.0(100%)", "volume" },
   { "mute", 'm', 0, G_OPTION_ARG_NONE, &_omvp_default_mute,
     "Mute", NULL },
   { "no-text", 'o', 0, G_OPTION_ARG_NONE, &_omvp_no_text_info,
     "Do not show text", NULL },
+  { "no-monitor", 0, 0, G_OPTION_ARG_NONE, &_omvp_no_monitor,
+    "Do not monitor the health of UDP channels", NULL },
   { "show-debug", 'd', 0, G_OPTION_ARG_NONE, &_omvp_show_debug,
     "Show debug text", NULL },
   { "version", 0, 0, G_OPTION_ARG_NONE, &_omvp_show_version,
@@ -89,6 +123,20 @@ typedef enum _OMVPTextInfo {
   OMVP_TEXT_INFO_MAX
 } OMVPTextInfo;
 
+typedef enum _OMVPFocusState {
+  OMVP_FOCUS_STATE_CONNECTING,
+  OMVP_FOCUS_STATE_PLAYING,
+  OMVP_FOCUS_STATE_RETRYING
+} OMVPFocusState;
+
+static const gchar *_omvp_focus_state_names[] = {
+  "connecting", "playing", "retrying"
+};
+
+static const gchar *_omvp_health_names[] = {
+  "unknown", "ok", "degraded", "dead"
+};
+
 typedef struct _OMVPTexture {
   struct _OMVPPlayer *player;
   gint idx;
@@ -96,8 +144,55 @@ typedef struct _OMVPTexture {
   ClutterContent *content;
 } OMVPTexture;
 
+typedef struct _OMVPDebugInfo {
+  gint vid_idx;
+  gdouble volume;
+  gboolean mute;
+  gint frame_callbacks_per_frame;
+  gint max_frame_callbacks_per_frame;
+  gboolean is_texture_showing;
+  const gchar *audio_caps_str;
+  const gchar *audio_tags_str;
+  const gchar *video_caps_str;
+  const gchar *video_tags_str;
+  gint num_audio;
+  gint current_audio;
+  gint fps_x10;
+  gint kbps;
+  gint num_dropped_frames;
+  gboolean has_source_stats;
+  guint64 num_kernel_drops;
+  guint64 num_pool_drops;
+  guint rtp_latency;
+  guint rtp_jitter;
+  gint e2e_latency;
+  gdouble clock_drift;
+  guint num_ssrcs;
+  guint64 num_ssrc_switches;
+  gboolean has_monitor_stats;
+  OMVPMonitorStats monitor_stats;
+  OMVPHlsStats hls_stats;
+  OMVPFocusState focus_state;
+  gint num_reconnect_attempts;
+  gint num_reconnects;
+  gint retry_in_ds;
+} OMVPDebugInfo;
+
 typedef struct _OMVPPlayer {
   OMVPVids *vids;
+  OMVPFetch fetch;
+  gchar *vids_filename;
+  GFileMonitor *vids_monitor;
+  guint vids_reload_timeout_id;
+  OMVPSearch search;
+  GString *search_query;
+  ClutterActor *search_text;
+  guint search_open_timeout_id;
+  guint search_reset_timeout_id;
+  OMVPMonitor monitor;
+  gint recent_vid_idxs[_OMVP_GOP_CACHE_NUM_RECENT];
+  gint cached_vid_idxs[_OMVP_GOP_CACHE_NUM_VIDS];
+  gint num_cached_vid_idxs;
 
   gfloat stage_org_width;
   gfloat stage_org_height;
@@ -127,17 +222,53 @@ typedef struct _OMVPPlayer {
   OMVPGst gst;
   gint vid_idx;
 
+  OMVPFocusState focus_state;
+  guint watchdog_timeout_id;
+  guint reconnect_timeout_id;
+  gint num_reconnect_attempts;
+  gint num_reconnects;
+  gint watchdog_num_buffers;
+  gint64 watchdog_time;
+  gint64 playing_time;
+  gint64 reconnect_time;
+
   OMVPTexture *o_scan_textures;
   ClutterActor **scan_textures;
-  ClutterActor **scan_texts;
   ClutterActor *root_scan_texts;
+  ClutterActor *root_badges;
   OMVPGst *scan_gsts;
   guint *scan_timeout_ids;
+  GPtrArray *all_scan_textures;
+  GPtrArray *free_scan_textures;
+  gint num_tiles;
+  gint tile_min_x;
+  gint tile_max_x;
+  gint tile_min_y;
+  gint tile_max_y;
+  gint win_min_x;
+  gint win_max_x;
+  gint win_min_y;
+  gint win_max_y;
   gint scan_vid_idx;
   gint num_scan_vids;
   gint max_num_scan_vids;
   guint scan_texts_timeout_id;
 
+  guint repaint_func_id;
+  gint num_frame_callbacks;
+  gint frame_callbacks_per_frame;
+  gint max_frame_callbacks_per_frame;
+  guint throttle_timeout_id;
+
+  guint debug_text_timeout_id;
+  OMVPGst debug_gst;
+  gint64 debug_time;
+  gint debug_num_frames;
+  guint debug_num_bytes;
+  gint debug_fps_x10;
+  gint debug_kbps;
+  gchar *debug_text;
+
   gdouble volume;
   gboolean mute;
   OMVPTextInfo text_info;
@@ -145,26 +276,52 @@ typedef struct _OMVPPlayer {
 
 static gint _omvp_remove_transition(ClutterActor *actor, const gchar *name);
 static gint _omvp_calc_best_num_vid_per_row(gint num_vids);
-static gint _omvp_calc_vid_idx(gint vid_idx_1, gint vid_idx_2,
-  gint num_vids);
+static gint _omvp_tile_create(OMVPPlayer *player, gint vid_idx);
+static gint _omvp_tile_destroy(OMVPPlayer *player, gint vid_idx);
+static gint _omvp_update_tiles(OMVPPlayer *player);
 static gint _omvp_scan_vid_cancel_timeout(OMVPPlayer *player,
   gint scan_vid_idx);
 static gboolean _omvp_scan_vid_timeout(gpointer user_data);
+static gint _omvp_scan_vid_clamp(OMVPPlayer *player, gint scan_vid_idx);
 static gint _omvp_scan_vid_start(OMVPPlayer *player, gint scan_vid_idx);
+static gint _omvp_scan_vid_start_next(OMVPPlayer *player);
 static gint _omvp_scan_vid_start_all(OMVPPlayer *player);
 static gint _omvp_scan_vid_finish(OMVPPlayer *player, gint scan_vid_idx);
 static gint _omvp_scan_vid_finish_all(OMVPPlayer *player);
 static gint _omvp_reshape(OMVPPlayer *player);
+static gboolean _omvp_is_animating(OMVPPlayer *player);
+static gint _omvp_refresh_throttle(OMVPPlayer *player);
+static gboolean _omvp_throttle_timeout(gpointer user_data);
+static void _omvp_on_transitions_completed(ClutterActor *actor,
+  gpointer user_data);
 static gint _omvp_move_focus(OMVPPlayer *player);
+static gint _omvp_open_focus(OMVPPlayer *player);
+static gint _omvp_add_cached_vid_idx(gint *vid_idxs, gint num_vid_idxs,
+  gint vid_idx);
+static gboolean _omvp_has_cached_vid_idx(const gint *vid_idxs,
+  gint num_vid_idxs, gint vid_idx);
+static gint _omvp_update_gop_cache(OMVPPlayer *player);
+static gint _omvp_schedule_reconnect(OMVPPlayer *player);
+static gboolean _omvp_reconnect_timeout(gpointer user_data);
+static gboolean _omvp_watchdog_timeout(gpointer user_data);
+static gint _omvp_set_focus_position(OMVPPlayer *player);
 static gint _omvp_get_view_bounds(OMVPPlayer *player, gint *pmin_view_pos_x,
   gint *pmax_view_pos_x, gint *pmin_view_pos_y, gint *pmax_view_pos_y);
 static gint _omvp_is_focus_visible(OMVPPlayer *player);
 static gint _omvp_auto_view(OMVPPlayer *player);
 static gint _omvp_refresh_text(OMVPPlayer *player);
+static gint _omvp_update_debug_text(OMVPPlayer *player);
+static gboolean _omvp_debug_text_timeout(gpointer user_data);
 static gint _omvp_refresh_texture(OMVPPlayer *player);
 static gint _omvp_scan_texts_timer_start(OMVPPlayer *player);
 static gint _omvp_scan_texts_timer_cancel_timeout(OMVPPlayer *player);
 static gboolean _omvp_scan_texts_timer_timeout(gpointer user_data);
+static gboolean _omvp_search_on_key_press(OMVPPlayer *player,
+  ClutterEvent *event);
+static gint _omvp_search_jump(OMVPPlayer *player);
+static gint _omvp_search_reset(OMVPPlayer *player);
+static gboolean _omvp_search_open_timeout(gpointer user_data);
+static gboolean _omvp_search_reset_timeout(gpointer user_data);
 static gboolean _omvp_on_key_press(ClutterActor *actor, ClutterEvent *event,
   gpointer user_data);
 static void _omvp_on_allocation_changed(ClutterActor *actor,
@@ -175,6 +332,18 @@ static void _omvp_texture_on_callback(OMVPGstCallbackID id,
   gpointer user_data);
 static void _omvp_scan_texture_on_callback(OMVPGstCallbackID id,
   gpointer user_data);
+static gint _omvp_scan_vid_on_new_frame(OMVPPlayer *player,
+  gint scan_vid_idx);
+static gint _omvp_texture_on_new_frame(OMVPPlayer *player);
+static gboolean _omvp_on_repaint(gpointer user_data);
+static gint _omvp_update_max_num_scan_vids(OMVPPlayer *player);
+static gint _omvp_reload_vids(OMVPPlayer *player, OMVPVids *vids);
+static OMVPMonitor _omvp_monitor_open(OMVPPlayer *player);
+static void _omvp_monitor_on_health(gint vid_idx, OMVPMonitorHealth health,
+  gpointer user_data);
+static gboolean _omvp_vids_reload_timeout(gpointer user_data);
+static void _omvp_on_vids_changed(GFileMonitor *monitor, GFile *file,
+  GFile *other_file, GFileMonitorEvent event_type, gpointer user_data);
 
 static gint _omvp_remove_transition(ClutterActor *actor, const gchar *name) {
   ClutterTransition *transition;
@@ -201,17 +370,132 @@ static gint _omvp_calc_best_num_vid_per_row(gint num_vids) {
   return i;
 }
 
-static gint _omvp_calc_vid_idx(gint vid_idx_1, gint vid_idx_2,
-  gint num_vids) {
+static gint _omvp_tile_create(OMVPPlayer *player, gint vid_idx) {
+  ClutterActor *texture;
+  gfloat x, y;
+
+  g_assert(player->scan_textures[vid_idx] == NULL);
+
+  x = (gfloat)(vid_idx % _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE;
+  y = (gfloat)(vid_idx / _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE;
+
+  if (player->free_scan_textures->len) {
+    texture = g_ptr_array_remove_index_fast(player->free_scan_textures,
+      player->free_scan_textures->len - 1);
+  } else {
+#if CLUTTER_GST_MAJOR_VERSION > 2
+    texture = clutter_actor_new();
+#else
+    texture =
+      g_object_new(CLUTTER_TYPE_TEXTURE, "disable-slicing", TRUE, NULL);
+#endif
+    clutter_actor_insert_child_below(player->root_actor, texture,
+      player->texture);
+    g_object_ref(texture);
+    g_ptr_array_add(player->all_scan_textures, texture);
+    clutter_actor_set_size(texture, _OMVP_TEX_SIZE, _OMVP_TEX_SIZE);
+    clutter_actor_set_pivot_point(texture, 0.5f, 0.5f);
+    clutter_actor_set_scale(texture,
+      _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
+  }
+  clutter_actor_set_opacity(texture, 0);
+  clutter_actor_set_position(texture, x, y);
+  clutter_actor_show(texture);
+
+  player->scan_textures[vid_idx] = texture;
+  player->o_scan_textures[vid_idx].player = player;
+  player->o_scan_textures[vid_idx].idx = vid_idx;
+  player->o_scan_textures[vid_idx].texture = texture;
+  ++player->num_tiles;
+
+  return 0;
+}
+
+static gint _omvp_tile_destroy(OMVPPlayer *player, gint vid_idx) {
+  g_assert(player->scan_textures[vid_idx]);
+
+  _omvp_scan_vid_finish(player, vid_idx);
+
+  clutter_actor_hide(player->scan_textures[vid_idx]);
+  g_ptr_array_add(player->free_scan_textures, player->scan_textures[vid_idx]);
+  player->scan_textures[vid_idx] = NULL;
+  player->o_scan_textures[vid_idx].texture = NULL;
+  --player->num_tiles;
+
+  return 0;
+}
+
+/*
+  Only the tiles inside the view bounds plus a margin have actors. While the
+  root actor is still moving, the tiles of the old view are kept as well, and
+  they are released once the transition completes.
+*/
+static gint _omvp_update_tiles(OMVPPlayer *player) {
+  gint min_x, max_x, min_y, max_y;
+  gboolean trim;
   gint vid_idx;
-  vid_idx = vid_idx_1 + vid_idx_2;
-  if (vid_idx >= num_vids) {
-    vid_idx -= num_vids;
+  gint x, y;
+
+  _omvp_get_view_bounds(player, &min_x, &max_x, &min_y, &max_y);
+  player->win_min_x = MAX(min_x - _OMVP_TILE_MARGIN, 0);
+  player->win_max_x =
+    MIN(max_x + _OMVP_TILE_MARGIN, _omvp_num_vid_per_row - 1);
+  player->win_min_y = MAX(min_y - _OMVP_TILE_MARGIN, 0);
+  player->win_max_y = MIN(max_y + _OMVP_TILE_MARGIN, player->num_row - 1);
+
+  trim = !clutter_actor_get_transition(player->root_actor, "position") &&
+    !clutter_actor_get_transition(player->root_actor, "scale-x") &&
+    !clutter_actor_get_transition(player->root_actor, "scale-y");
+
+  if (trim && player->num_tiles) {
+    for (y = player->tile_min_y; y <= player->tile_max_y; y++) {
+      for (x = player->tile_min_x; x <= player->tile_max_x; x++) {
+        vid_idx = y * _omvp_num_vid_per_row + x;
+        if (vid_idx >= player->vids->num_vids) {
+          break;
+        }
+        if (player->scan_textures[vid_idx] &&
+          (x < player->win_min_x || x > player->win_max_x ||
+          y < player->win_min_y || y > player->win_max_y)) {
+          _omvp_tile_destroy(player, vid_idx);
+        }
+      }
+    }
   }
-  if (vid_idx < 0) {
-    vid_idx += num_vids;
+
+  for (y = player->win_min_y; y <= player->win_max_y; y++) {
+    for (x = player->win_min_x; x <= player->win_max_x; x++) {
+      vid_idx = y * _omvp_num_vid_per_row + x;
+      if (vid_idx >= player->vids->num_vids) {
+        break;
+      }
+      if (!player->scan_textures[vid_idx]) {
+        _omvp_tile_create(player, vid_idx);
+      }
+    }
   }
-  return vid_idx;
+
+  if (trim || player->num_tiles == 0) {
+    player->tile_min_x = player->win_min_x;
+    player->tile_max_x = player->win_max_x;
+    player->tile_min_y = player->win_min_y;
+    player->tile_max_y = player->win_max_y;
+  } else {
+    player->tile_min_x = MIN(player->tile_min_x, player->win_min_x);
+    player->tile_max_x = MAX(player->tile_max_x, player->win_max_x);
+    player->tile_min_y = MIN(player->tile_min_y, player->win_min_y);
+    player->tile_max_y = MAX(player->tile_max_y, player->win_max_y);
+  }
+  omvp_labels_set_window(OMVP_LABELS(player->root_scan_texts),
+    player->tile_min_x, player->tile_max_x,
+    player->tile_min_y, player->tile_max_y);
+  omvp_badges_set_window(OMVP_BADGES(player->root_badges),
+    player->tile_min_x, player->tile_max_x,
+    player->tile_min_y, player->tile_max_y);
+
+  _omvp_scan_vid_start_all(player);
+
+  return 0;
 }
 
 static gint _omvp_scan_vid_cancel_timeout(OMVPPlayer *player,
@@ -233,24 +517,45 @@ static gboolean _omvp_scan_vid_timeout(gpointer user_data) {
   player = o_texture->player;
 
   _omvp_scan_vid_finish(player, o_texture->idx);
-  _omvp_scan_vid_start(player, player->scan_vid_idx);
-  player->scan_vid_idx =
-    _omvp_calc_vid_idx(player->scan_vid_idx, 1, player->vids->num_vids);
+  _omvp_scan_vid_start_next(player);
 
   return FALSE;
 }
 
+/* returns the first tile at or after scan_vid_idx inside the window. */
+static gint _omvp_scan_vid_clamp(OMVPPlayer *player, gint scan_vid_idx) {
+  gint x, y;
+
+  x = scan_vid_idx % _omvp_num_vid_per_row;
+  y = scan_vid_idx / _omvp_num_vid_per_row;
+  if (y < player->win_min_y) {
+    x = player->win_min_x;
+    y = player->win_min_y;
+  } else if (x < player->win_min_x) {
+    x = player->win_min_x;
+  } else if (x > player->win_max_x) {
+    x = player->win_min_x;
+    y++;
+  }
+  if (y > player->win_max_y ||
+    y * _omvp_num_vid_per_row + x >= player->vids->num_vids) {
+    x = player->win_min_x;
+    y = player->win_min_y;
+  }
+
+  return y * _omvp_num_vid_per_row + x;
+}
+
 static gint _omvp_scan_vid_start(OMVPPlayer *player, gint scan_vid_idx) {
 
   g_assert(player->scan_gsts[scan_vid_idx] == NULL);
+  g_assert(player->scan_textures[scan_vid_idx]);
 
   player->scan_gsts[scan_vid_idx] =
     omvp_gst_open(_omvp_proxy_uri, player->vids->uris[scan_vid_idx],
       player->scan_textures[scan_vid_idx], TRUE,
       _omvp_scan_width, _omvp_scan_height, _omvp_scan_texture_on_callback,
       &player->o_scan_textures[scan_vid_idx]);
-  player->o_scan_textures[scan_vid_idx].content =
-    clutter_actor_get_content(player->scan_textures[scan_vid_idx]);
   player->scan_timeout_ids[scan_vid_idx] =
     clutter_threads_add_timeout(
       _omvp_scan_timeout, _omvp_scan_vid_timeout,
@@ -260,12 +565,41 @@ static gint _omvp_scan_vid_start(OMVPPlayer *player, gint scan_vid_idx) {
   return 0;
 }
 
+static gint _omvp_scan_vid_start_next(OMVPPlayer *player) {
+  gint num_win_tiles;
+  gint scan_vid_idx;
+  gint i;
+
+  num_win_tiles = (player->win_max_x - player->win_min_x + 1) *
+    (player->win_max_y - player->win_min_y + 1);
+  scan_vid_idx = player->scan_vid_idx;
+  for (i = 0; i < num_win_tiles; i++) {
+    scan_vid_idx = _omvp_scan_vid_clamp(player, scan_vid_idx);
+    if (scan_vid_idx >= player->vids->num_vids) {
+      break;
+    }
+    /* a channel the monitor knows is dead is not worth a decoder. */
+    if (player->scan_textures[scan_vid_idx] &&
+      !player->scan_gsts[scan_vid_idx] &&
+      (!player->monitor ||
+      omvp_monitor_get_health(player->monitor, scan_vid_idx) !=
+      OMVP_MONITOR_HEALTH_DEAD)) {
+      _omvp_scan_vid_start(player, scan_vid_idx);
+      player->scan_vid_idx = scan_vid_idx + 1;
+      return 0;
+    }
+    scan_vid_idx++;
+  }
+
+  return -1;
+}
+
 static gint _omvp_scan_vid_start_all(OMVPPlayer *player) {
 
-  while (player->num_scan_vids != player->max_num_scan_vids) {
-    _omvp_scan_vid_start(player, player->scan_vid_idx);
-    player->scan_vid_idx =
-      _omvp_calc_vid_idx(player->scan_vid_idx, 1, player->vids->num_vids);
+  while (player->num_scan_vids < player->max_num_scan_vids) {
+    if (_omvp_scan_vid_start_next(player) != 0) {
+      break;
+    }
   }
 
   return 0;
@@ -320,11 +654,15 @@ static gint _omvp_reshape(OMVPPlayer *player) {
 
   clutter_actor_set_scale(player->root_actor, ra_scale_x, ra_scale_y);
   clutter_actor_set_position(player->root_actor, ra_x, ra_y);
+  omvp_labels_set_scale(OMVP_LABELS(player->root_scan_texts),
+    (gfloat)MAX(ra_scale_x, ra_scale_y));
 
   _omvp_remove_transition(player->root_actor, "position");
   _omvp_remove_transition(player->root_actor, "scale-x");
   _omvp_remove_transition(player->root_actor, "scale-y");
 
+  _omvp_update_tiles(player);
+
   if (player->view_num_per_row == 1) {
     clutter_actor_set_scale(player->texture,
       _OMVP_VID_SCALE, _OMVP_VID_SCALE);
@@ -333,19 +671,269 @@ static gint _omvp_reshape(OMVPPlayer *player) {
       _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
   }
 
+  _omvp_refresh_throttle(player);
+
   return 0;
 }
 
+static gboolean _omvp_is_animating(OMVPPlayer *player) {
+  if (clutter_actor_get_transition(player->root_actor, "position") ||
+    clutter_actor_get_transition(player->root_actor, "scale-x") ||
+    clutter_actor_get_transition(player->root_actor, "scale-y") ||
+    clutter_actor_get_transition(player->texture, "opacity") ||
+    clutter_actor_get_transition(player->texture, "scale-x") ||
+    clutter_actor_get_transition(player->texture, "scale-y")) {
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*
+  While nothing is animating, scan videos can only update once per throttle
+  epoch, so their updates are merged into a few redraws per epoch instead of
+  one redraw per decoded frame.
+*/
+static gint _omvp_refresh_throttle(OMVPPlayer *player) {
+  if (_omvp_max_idle_fps <= 0) {
+    return 0;
+  }
+
+  omvp_gst_set_render_throttle(!_omvp_is_animating(player));
+
+  return 0;
+}
+
+static gboolean _omvp_throttle_timeout(gpointer user_data) {
+  (void)user_data;
+
+  omvp_gst_advance_render_throttle();
+
+  return TRUE;
+}
+
+static void _omvp_on_transitions_completed(ClutterActor *actor,
+  gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+
+  if (actor == player->root_actor) {
+    _omvp_update_tiles(player);
+  }
+  _omvp_refresh_throttle(player);
+}
+
 static gint _omvp_move_focus(OMVPPlayer *player) {
+  if (player->search_open_timeout_id) {
+    g_source_remove(player->search_open_timeout_id);
+    player->search_open_timeout_id = 0;
+  }
+  if (player->reconnect_timeout_id) {
+    g_source_remove(player->reconnect_timeout_id);
+    player->reconnect_timeout_id = 0;
+  }
+  player->num_reconnect_attempts = 0;
   player->is_texture_showing = FALSE;
   _omvp_refresh_texture(player);
-  omvp_gst_close(player->gst);
+  _omvp_open_focus(player);
+  _omvp_set_focus_position(player);
+  return 0;
+}
+
+/* (re)opens the focus pipeline without touching what is on screen. */
+static gint _omvp_open_focus(OMVPPlayer *player) {
+  if (player->gst) {
+    omvp_gst_close(player->gst);
+  }
   player->gst = omvp_gst_open(_omvp_proxy_uri,
     player->vids->uris[player->vid_idx], player->texture, FALSE, 0, 0,
     _omvp_texture_on_callback, &player->o_texture);
   player->o_texture.content = clutter_actor_get_content(player->texture);
   omvp_gst_set_volume(player->gst, player->volume);
   omvp_gst_set_mute(player->gst, player->mute);
+
+  player->focus_state = OMVP_FOCUS_STATE_CONNECTING;
+  player->watchdog_num_buffers = 0;
+  player->watchdog_time = g_get_monotonic_time();
+  _omvp_update_gop_cache(player);
+  return 0;
+}
+
+/* returns the new number of vid_idxs. */
+static gint _omvp_add_cached_vid_idx(gint *vid_idxs, gint num_vid_idxs,
+  gint vid_idx) {
+
+  if (!_omvp_has_cached_vid_idx(vid_idxs, num_vid_idxs, vid_idx)) {
+    vid_idxs[num_vid_idxs++] = vid_idx;
+  }
+
+  return num_vid_idxs;
+}
+
+static gboolean _omvp_has_cached_vid_idx(const gint *vid_idxs,
+  gint num_vid_idxs, gint vid_idx) {
+  gint i;
+
+  for (i = 0; i < num_vid_idxs; i++) {
+    if (vid_idxs[i] == vid_idx) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/*
+  The focus, its neighbors and the recently focused channels keep their
+  last GOP in the monitor, so focusing one of them again starts decoding
+  from the cached keyframe instead of waiting for the next one. Setting a
+  cache size takes the receive lock, so only the channels that enter or
+  leave the cache are updated.
+*/
+static gint _omvp_update_gop_cache(OMVPPlayer *player) {
+  gint vid_idxs[_OMVP_GOP_CACHE_NUM_VIDS];
+  gint num_vid_idxs;
+  gint vid_idx;
+  gint i;
+
+  if (!player->monitor || _omvp_gop_cache_size <= 0) {
+    return 0;
+  }
+
+  for (i = 0; i < _OMVP_GOP_CACHE_NUM_RECENT - 1; i++) {
+    if (player->recent_vid_idxs[i] == player->vid_idx) {
+      break;
+    }
+  }
+  memmove(&player->recent_vid_idxs[1], &player->recent_vid_idxs[0],
+    sizeof(gint) * i);
+  player->recent_vid_idxs[0] = player->vid_idx;
+
+  num_vid_idxs = 0;
+  for (i = 0; i < _OMVP_GOP_CACHE_NUM_RECENT; i++) {
+    if (player->recent_vid_idxs[i] >= 0) {
+      num_vid_idxs = _omvp_add_cached_vid_idx(vid_idxs, num_vid_idxs,
+        player->recent_vid_idxs[i]);
+    }
+  }
+  vid_idx = player->vid_idx;
+  if (vid_idx % _omvp_num_vid_per_row > 0) {
+    num_vid_idxs = _omvp_add_cached_vid_idx(vid_idxs, num_vid_idxs,
+      vid_idx - 1);
+  }
+  if (vid_idx % _omvp_num_vid_per_row < _omvp_num_vid_per_row - 1 &&
+    vid_idx + 1 < player->vids->num_vids) {
+    num_vid_idxs = _omvp_add_cached_vid_idx(vid_idxs, num_vid_idxs,
+      vid_idx + 1);
+  }
+  if (vid_idx - _omvp_num_vid_per_row >= 0) {
+    num_vid_idxs = _omvp_add_cached_vid_idx(vid_idxs, num_vid_idxs,
+      vid_idx - _omvp_num_vid_per_row);
+  }
+  if (vid_idx + _omvp_num_vid_per_row < player->vids->num_vids) {
+    num_vid_idxs = _omvp_add_cached_vid_idx(vid_idxs, num_vid_idxs,
+      vid_idx + _omvp_num_vid_per_row);
+  }
+
+  for (i = 0; i < player->num_cached_vid_idxs; i++) {
+    if (!_omvp_has_cached_vid_idx(vid_idxs, num_vid_idxs,
+      player->cached_vid_idxs[i])) {
+      omvp_monitor_set_gop_cache(player->monitor,
+        player->cached_vid_idxs[i], 0);
+    }
+  }
+  for (i = 0; i < num_vid_idxs; i++) {
+    if (!_omvp_has_cached_vid_idx(player->cached_vid_idxs,
+      player->num_cached_vid_idxs, vid_idxs[i])) {
+      omvp_monitor_set_gop_cache(player->monitor, vid_idxs[i],
+        (gsize)_omvp_gop_cache_size * 1024 * 1024);
+    }
+  }
+  memcpy(player->cached_vid_idxs, vid_idxs, sizeof(gint) * num_vid_idxs);
+  player->num_cached_vid_idxs = num_vid_idxs;
+
+  return 0;
+}
+
+/*
+  A failed or stalled focus stream is reopened after a delay that doubles
+  with every attempt up to a cap, with jitter so that many screens behind
+  one proxy don't retry in lockstep. The last frame stays on screen until
+  the stream comes back.
+*/
+static gint _omvp_schedule_reconnect(OMVPPlayer *player) {
+  gint delay;
+
+  if (player->reconnect_timeout_id) {
+    return 0;
+  }
+
+  delay = _OMVP_RECONNECT_MAX_DELAY;
+  if (player->num_reconnect_attempts < 16) {
+    delay = MIN(_OMVP_RECONNECT_MIN_DELAY << player->num_reconnect_attempts,
+      _OMVP_RECONNECT_MAX_DELAY);
+  }
+  delay = delay / 2 + g_random_int_range(0, delay / 2 + 1);
+  player->num_reconnect_attempts++;
+
+  g_debug("focus vid_idx(%d) retry(%d) in %dms", player->vid_idx,
+    player->num_reconnect_attempts, delay);
+
+  player->focus_state = OMVP_FOCUS_STATE_RETRYING;
+  player->reconnect_time = g_get_monotonic_time() + (gint64)delay * 1000;
+  player->reconnect_timeout_id = clutter_threads_add_timeout(delay,
+    _omvp_reconnect_timeout, player);
+  return 0;
+}
+
+static gboolean _omvp_reconnect_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+  player->reconnect_timeout_id = 0;
+  player->num_reconnects++;
+  _omvp_open_focus(player);
+
+  return FALSE;
+}
+
+/*
+  The focus stream is alive as long as decoded frames reach its sink, which
+  does not depend on the stage being painted.
+*/
+static gboolean _omvp_watchdog_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+  gint num_buffers;
+  gint64 now;
+
+  player = (OMVPPlayer *)user_data;
+  if (player->reconnect_timeout_id) {
+    return TRUE;
+  }
+
+  now = g_get_monotonic_time();
+  num_buffers = omvp_gst_get_num_buffers(player->gst);
+  if (num_buffers != player->watchdog_num_buffers) {
+    if (player->focus_state != OMVP_FOCUS_STATE_PLAYING) {
+      player->focus_state = OMVP_FOCUS_STATE_PLAYING;
+      player->playing_time = now;
+    } else if (now - player->playing_time >=
+      (gint64)_OMVP_RECONNECT_MAX_DELAY * 1000) {
+      player->num_reconnect_attempts = 0;
+    }
+    player->watchdog_num_buffers = num_buffers;
+    player->watchdog_time = now;
+  } else if (now - player->watchdog_time >=
+    (gint64)_OMVP_STALL_TIMEOUT * 1000) {
+    g_debug("focus vid_idx(%d) stalled", player->vid_idx);
+    _omvp_schedule_reconnect(player);
+  }
+
+  return TRUE;
+}
+
+static gint _omvp_set_focus_position(OMVPPlayer *player) {
   clutter_actor_set_position(player->focus_actor,
     (gfloat)(player->vid_idx % _omvp_num_vid_per_row) *
       (gfloat)_OMVP_TEX_SIZE,
@@ -425,39 +1013,195 @@ static gint _omvp_auto_view(OMVPPlayer *player) {
   return 0;
 }
 
-static gint _omvp_refresh_text(OMVPPlayer *player) {
-  gchar *text;
-  text = g_strdup_printf(
+/*
+  The debug text is rebuilt from cached state a few times per second at most,
+  and only handed to the text actor when it has changed, so showing it does
+  not disturb the frame timing it reports.
+*/
+static gint _omvp_update_debug_text(OMVPPlayer *player) {
+  OMVPDebugInfo info;
+  GString *text;
+  gint64 now;
+  gint64 elapsed;
+  gint num_frames;
+  guint num_bytes;
+  const GstStructure *stats;
+
+  memset(&info, 0, sizeof(info));
+  info.vid_idx = player->vid_idx;
+  info.volume = player->volume;
+  info.mute = player->mute;
+  info.frame_callbacks_per_frame = player->frame_callbacks_per_frame;
+  info.max_frame_callbacks_per_frame = player->max_frame_callbacks_per_frame;
+  info.is_texture_showing = player->is_texture_showing;
+
+  now = g_get_monotonic_time();
+  num_frames = omvp_gst_get_num_frames(player->gst);
+  num_bytes = omvp_gst_get_num_bytes(player->gst);
+  if (player->debug_gst != player->gst) {
+    player->debug_gst = player->gst;
+    player->debug_time = now;
+    player->debug_num_frames = num_frames;
+    player->debug_num_bytes = num_bytes;
+    player->debug_fps_x10 = 0;
+    player->debug_kbps = 0;
+  }
+  elapsed = now - player->debug_time;
+  if (elapsed >= G_USEC_PER_SEC) {
+    player->debug_fps_x10 = (gint)((gint64)(num_frames -
+      player->debug_num_frames) * 10 * G_USEC_PER_SEC / elapsed);
+    player->debug_kbps = (gint)((gint64)(num_bytes -
+      player->debug_num_bytes) * 8 * 1000 / elapsed);
+    player->debug_time = now;
+    player->debug_num_frames = num_frames;
+    player->debug_num_bytes = num_bytes;
+  }
+  info.fps_x10 = player->debug_fps_x10;
+  info.kbps = player->debug_kbps;
+  info.num_dropped_frames = omvp_gst_get_num_dropped_frames(player->gst);
+  stats = omvp_gst_get_source_stats(player->gst);
+  if (stats) {
+    info.has_source_stats = TRUE;
+    gst_structure_get_uint64(stats, "kernel-drops", &info.num_kernel_drops);
+    gst_structure_get_uint64(stats, "pool-drops", &info.num_pool_drops);
+    gst_structure_get_uint(stats, "latency", &info.rtp_latency);
+    gst_structure_get_uint(stats, "jitter", &info.rtp_jitter);
+    info.e2e_latency = -1;
+    gst_structure_get_int(stats, "end-to-end-latency", &info.e2e_latency);
+    gst_structure_get_double(stats, "clock-drift", &info.clock_drift);
+    gst_structure_get_uint(stats, "ssrc-count", &info.num_ssrcs);
+    gst_structure_get_uint64(stats, "ssrc-switches",
+      &info.num_ssrc_switches);
+  }
+  if (player->monitor && omvp_monitor_get_stats(player->monitor,
+    player->vid_idx, &info.monitor_stats) == 0) {
+    info.has_monitor_stats = TRUE;
+  }
+  omvp_hls_get_stats(&info.hls_stats);
+  info.focus_state = player->focus_state;
+  info.num_reconnect_attempts = player->num_reconnect_attempts;
+  info.num_reconnects = player->num_reconnects;
+  if (player->reconnect_timeout_id) {
+    info.retry_in_ds = (gint)MAX((player->reconnect_time - now) / 100000, 0);
+  }
+
+  if (player->is_texture_showing) {
+    info.audio_caps_str = omvp_gst_get_audio_caps_str(player->gst);
+    info.audio_tags_str = omvp_gst_get_audio_tags_str(player->gst);
+    info.video_caps_str = omvp_gst_get_video_caps_str(player->gst);
+    info.video_tags_str = omvp_gst_get_video_tags_str(player->gst);
+    info.num_audio = omvp_gst_get_num_audio(player->gst);
+    info.current_audio = omvp_gst_get_current_audio(player->gst);
+  }
+
+  text = g_string_new(NULL);
+  g_string_printf(text,
     "vid_idx: %d\n"
     "uri: %s\n"
     "volume: %f\n"
-    "mute: %u",
-    player->vid_idx,
-    player->vids->uris[player->vid_idx],
-    player->volume,
-    player->mute);
-  if (player->is_texture_showing) {
-    gchar *text2;
-    text2 = g_strdup_printf(
-      "%s\n"
+    "mute: %u\n"
+    "frame_callbacks: %d (max %d)\n"
+    "fps: %d.%d\n"
+    "bitrate: %d kbps\n"
+    "dropped_frames: %d\n"
+    "focus: %s (attempts %d, reconnects %d)",
+    info.vid_idx,
+    player->vids->uris[info.vid_idx],
+    info.volume,
+    info.mute,
+    info.frame_callbacks_per_frame,
+    info.max_frame_callbacks_per_frame,
+    info.fps_x10 / 10, info.fps_x10 % 10,
+    info.kbps,
+    info.num_dropped_frames,
+    _omvp_focus_state_names[info.focus_state],
+    info.num_reconnect_attempts,
+    info.num_reconnects);
+  if (player->reconnect_timeout_id) {
+    g_string_append_printf(text, " retry in %d.%ds",
+      info.retry_in_ds / 10, info.retry_in_ds % 10);
+  }
+  if (info.has_source_stats) {
+    g_string_append_printf(text,
+      "\nudp_drops: kernel %" G_GUINT64_FORMAT ", pool %" G_GUINT64_FORMAT,
+      info.num_kernel_drops, info.num_pool_drops);
+  }
+  if (info.rtp_latency) {
+    g_string_append_printf(text, "\nrtp_latency: %u ms (jitter %u us)",
+      info.rtp_latency, info.rtp_jitter);
+  }
+  if (info.rtp_latency && info.e2e_latency >= 0) {
+    g_string_append_printf(text, "\ne2e_latency: %d ms (drift %.1f ppm)",
+      info.e2e_latency, info.clock_drift);
+  }
+  if (info.num_ssrcs > 1 || info.num_ssrc_switches) {
+    g_string_append_printf(text,
+      "\nrtp_sources: %u (switches %" G_GUINT64_FORMAT ")",
+      info.num_ssrcs, info.num_ssrc_switches);
+  }
+  if (info.has_monitor_stats) {
+    g_string_append_printf(text,
+      "\nhealth: %s (gaps %" G_GUINT64_FORMAT ", cc %" G_GUINT64_FORMAT
+      ", pcr_jitter %d us, %d kbps)",
+      _omvp_health_names[info.monitor_stats.health],
+      info.monitor_stats.num_seq_gaps, info.monitor_stats.num_cc_errors,
+      info.monitor_stats.pcr_jitter_us, info.monitor_stats.kbps);
+  }
+  if (info.hls_stats.num_thumbnails) {
+    g_string_append_printf(text,
+      "\nhls_thumbnails: %" G_GUINT64_FORMAT " (%" G_GUINT64_FORMAT
+      " KB each, last %" G_GSIZE_FORMAT " KB)",
+      info.hls_stats.num_thumbnails,
+      info.hls_stats.num_bytes / info.hls_stats.num_thumbnails / 1024,
+      info.hls_stats.last_num_bytes / 1024);
+  }
+  if (info.is_texture_showing) {
+    g_string_append_printf(text,
+      "\n"
       "audio_caps: %s\n"
       "audio_tags: %s\n"
       "video_caps: %s\n"
       "video_tags: %s\n"
       "num_audio: %d\n"
       "current_audio: %d\n",
-      text,
-      omvp_gst_get_audio_caps_str(player->gst),
-      omvp_gst_get_audio_tags_str(player->gst),
-      omvp_gst_get_video_caps_str(player->gst),
-      omvp_gst_get_video_tags_str(player->gst),
-      omvp_gst_get_num_audio(player->gst),
-      omvp_gst_get_current_audio(player->gst));
-    g_free(text);
-    text = text2;
-  }
-  clutter_text_set_text(CLUTTER_TEXT(player->text), text);
-  g_free(text);
+      info.audio_caps_str,
+      info.audio_tags_str,
+      info.video_caps_str,
+      info.video_tags_str,
+      info.num_audio,
+      info.current_audio);
+  }
+  if (g_strcmp0(text->str, player->debug_text) == 0) {
+    g_string_free(text, TRUE);
+    return 0;
+  }
+  g_free(player->debug_text);
+  player->debug_text = g_string_free(text, FALSE);
+  clutter_text_set_text(CLUTTER_TEXT(player->text), player->debug_text);
+
+  return 0;
+}
+
+static gboolean _omvp_debug_text_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+  _omvp_update_debug_text(player);
+
+  return TRUE;
+}
+
+static gint _omvp_refresh_text(OMVPPlayer *player) {
+  if (player->text_info == OMVP_TEXT_INFO_MAIN_AND_DEBUG) {
+    if (!player->debug_text_timeout_id) {
+      _omvp_update_debug_text(player);
+      player->debug_text_timeout_id = clutter_threads_add_timeout(
+        _OMVP_DEBUG_TEXT_INTERVAL, _omvp_debug_text_timeout, player);
+    }
+  } else if (player->debug_text_timeout_id) {
+    g_source_remove(player->debug_text_timeout_id);
+    player->debug_text_timeout_id = 0;
+  }
   switch (player->text_info) {
     case OMVP_TEXT_INFO_NONE:
       clutter_actor_set_opacity(player->text, 0);
@@ -506,6 +1250,7 @@ static gint _omvp_refresh_texture(OMVPPlayer *player) {
   } else {
     clutter_actor_set_opacity(player->texture, 0);
   }
+  _omvp_refresh_throttle(player);
   return 0;
 }
 
@@ -539,6 +1284,116 @@ static gboolean _omvp_scan_texts_timer_timeout(gpointer user_data) {
   return FALSE;
 }
 
+/*
+  Letters and digits build a query that jumps the focus to the first channel
+  whose id or name matches it. The focus moves at once, but the pipeline is
+  only opened when typing pauses, so typing "740" opens a single pipeline.
+*/
+static gboolean _omvp_search_on_key_press(OMVPPlayer *player,
+  ClutterEvent *event) {
+  GString *query;
+  gunichar c;
+
+  query = player->search_query;
+  c = clutter_event_get_key_unicode(event);
+
+  switch (clutter_event_get_key_symbol(event)) {
+    case CLUTTER_KEY_BackSpace:
+      if (!query->len) {
+        return FALSE;
+      }
+      g_string_truncate(query,
+        g_utf8_find_prev_char(query->str, query->str + query->len) -
+        query->str);
+      break;
+    case CLUTTER_KEY_Escape:
+      if (!query->len) {
+        return FALSE;
+      }
+      _omvp_search_reset(player);
+      return TRUE;
+    default:
+      if (!g_unichar_isalnum(c) && !(c == ' ' && query->len)) {
+        return FALSE;
+      }
+      g_string_append_unichar(query, c);
+      break;
+  }
+
+  _omvp_search_jump(player);
+
+  if (player->search_reset_timeout_id) {
+    g_source_remove(player->search_reset_timeout_id);
+  }
+  player->search_reset_timeout_id = clutter_threads_add_timeout(
+    _OMVP_SEARCH_RESET_DELAY, _omvp_search_reset_timeout, player);
+
+  return TRUE;
+}
+
+static gint _omvp_search_jump(OMVPPlayer *player) {
+  gint vid_idx;
+
+  clutter_text_set_text(CLUTTER_TEXT(player->search_text),
+    player->search_query->str);
+  clutter_actor_show(player->search_text);
+
+  vid_idx = omvp_search_find(player->search, player->search_query->str);
+  g_debug("search(%s) vid_idx(%d)", player->search_query->str, vid_idx);
+  if (vid_idx < 0 || vid_idx == player->vid_idx) {
+    return 0;
+  }
+
+  player->vid_idx = vid_idx;
+  omvp_gst_cancel_new_frame_callback(player->gst);
+  player->is_texture_showing = FALSE;
+  _omvp_refresh_texture(player);
+  _omvp_set_focus_position(player);
+  if (!_omvp_is_focus_visible(player)) {
+    _omvp_auto_view(player);
+    _omvp_reshape(player);
+  }
+
+  if (player->search_open_timeout_id) {
+    g_source_remove(player->search_open_timeout_id);
+  }
+  player->search_open_timeout_id = clutter_threads_add_timeout(
+    _OMVP_SEARCH_OPEN_DELAY, _omvp_search_open_timeout, player);
+
+  return 0;
+}
+
+static gint _omvp_search_reset(OMVPPlayer *player) {
+  if (player->search_reset_timeout_id) {
+    g_source_remove(player->search_reset_timeout_id);
+    player->search_reset_timeout_id = 0;
+  }
+  g_string_truncate(player->search_query, 0);
+  clutter_actor_hide(player->search_text);
+
+  return 0;
+}
+
+static gboolean _omvp_search_open_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+  player->search_open_timeout_id = 0;
+  _omvp_move_focus(player);
+
+  return FALSE;
+}
+
+static gboolean _omvp_search_reset_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+  player->search_reset_timeout_id = 0;
+  _omvp_search_reset(player);
+
+  return FALSE;
+}
+
 static gboolean _omvp_on_key_press(ClutterActor *actor, ClutterEvent *event,
   gpointer user_data) {
   guint key_symbol;
@@ -551,6 +1406,10 @@ static gboolean _omvp_on_key_press(ClutterActor *actor, ClutterEvent *event,
   g_debug("on_key_press event key_symbol(%u)",
     clutter_event_get_key_symbol(event));
 
+  if (_omvp_search_on_key_press(player, event)) {
+    return TRUE;
+  }
+
   switch (key_symbol) {
     case CLUTTER_KEY_F11:
       {
@@ -809,6 +1668,45 @@ static void _omvp_on_destroy(ClutterActor *actor, gpointer user_data) {
 
   player = (OMVPPlayer *)user_data;
 
+  clutter_threads_remove_repaint_func(player->repaint_func_id);
+  if (player->throttle_timeout_id) {
+    g_source_remove(player->throttle_timeout_id);
+    player->throttle_timeout_id = 0;
+  }
+  if (player->debug_text_timeout_id) {
+    g_source_remove(player->debug_text_timeout_id);
+    player->debug_text_timeout_id = 0;
+  }
+  if (player->watchdog_timeout_id) {
+    g_source_remove(player->watchdog_timeout_id);
+    player->watchdog_timeout_id = 0;
+  }
+  if (player->reconnect_timeout_id) {
+    g_source_remove(player->reconnect_timeout_id);
+    player->reconnect_timeout_id = 0;
+  }
+  if (player->vids_reload_timeout_id) {
+    g_source_remove(player->vids_reload_timeout_id);
+    player->vids_reload_timeout_id = 0;
+  }
+  if (player->vids_monitor) {
+    g_file_monitor_cancel(player->vids_monitor);
+    g_object_unref(player->vids_monitor);
+    player->vids_monitor = NULL;
+  }
+  omvp_fetch_close(player->fetch);
+  player->fetch = NULL;
+  omvp_monitor_close(player->monitor);
+  player->monitor = NULL;
+  if (player->search_open_timeout_id) {
+    g_source_remove(player->search_open_timeout_id);
+    player->search_open_timeout_id = 0;
+  }
+  if (player->search_reset_timeout_id) {
+    g_source_remove(player->search_reset_timeout_id);
+    player->search_reset_timeout_id = 0;
+  }
+
   _omvp_scan_vid_finish_all(player);
 
   if (player->gst) {
@@ -816,10 +1714,14 @@ static void _omvp_on_destroy(ClutterActor *actor, gpointer user_data) {
     player->gst = NULL;
   }
 
-  for (i = 0; i < player->vids->num_vids; i++) {
-    g_object_unref(player->o_scan_textures[i].texture);
-    if (player->o_scan_textures[i].content) {
-      g_object_unref(player->o_scan_textures[i].content);
+  for (i = 0; i < (gint)player->all_scan_textures->len; i++) {
+    ClutterActor *texture;
+    ClutterContent *content;
+    texture = g_ptr_array_index(player->all_scan_textures, i);
+    content = clutter_actor_get_content(texture);
+    g_object_unref(texture);
+    if (content) {
+      g_object_unref(content);
     }
   }
   g_object_unref(player->o_texture.texture);
@@ -828,10 +1730,15 @@ static void _omvp_on_destroy(ClutterActor *actor, gpointer user_data) {
   }
 
   g_free(player->scan_gsts);
-  g_free(player->scan_texts);
   g_free(player->scan_textures);
   g_free(player->o_scan_textures);
+  g_ptr_array_free(player->all_scan_textures, TRUE);
+  g_ptr_array_free(player->free_scan_textures, TRUE);
+  omvp_search_close(player->search);
+  g_string_free(player->search_query, TRUE);
   omvp_vids_close(player->vids);
+  g_free(player->vids_filename);
+  g_free(player->debug_text);
 
   clutter_main_quit();
 }
@@ -846,19 +1753,11 @@ static void _omvp_texture_on_callback(OMVPGstCallbackID id,
 
   switch (id) {
     case OMVP_GST_CALLBACK_ID_NEW_FRAME:
-      player->is_texture_showing = TRUE;
-      _omvp_refresh_texture(player);
-      _omvp_refresh_text(player);
-      _omvp_scan_texts_timer_cancel_timeout(player);
-      _omvp_scan_texts_timer_start(player);
-
-      if (omvp_gst_get_video_caps_str(player->gst) &&
-        omvp_gst_get_audio_caps_str(player->gst)) {
-        omvp_gst_cancel_new_frame_callback(player->gst);
-      }
+      player->num_frame_callbacks++;
+      _omvp_texture_on_new_frame(player);
       break;
     case OMVP_GST_CALLBACK_ID_ERROR:
-      _omvp_move_focus(player);
+      _omvp_schedule_reconnect(player);
       break;
     default:
       g_assert(FALSE);
@@ -870,18 +1769,17 @@ static void _omvp_scan_texture_on_callback(OMVPGstCallbackID id,
   gpointer user_data) {
   OMVPTexture *o_texture;
   OMVPPlayer *player;
-  ClutterActor *texture;
   gint scan_vid_idx;
 
   o_texture = (OMVPTexture *)user_data;
   player = o_texture->player;
-  texture = o_texture->texture;
   scan_vid_idx = o_texture->idx;
 
   switch (id) {
     case OMVP_GST_CALLBACK_ID_NEW_FRAME:
-      clutter_actor_set_opacity(texture, 0xff);
-      break;
+      player->num_frame_callbacks++;
+      _omvp_scan_vid_on_new_frame(player, scan_vid_idx);
+      return;
     case OMVP_GST_CALLBACK_ID_ERROR:
       break;
     default:
@@ -889,14 +1787,291 @@ static void _omvp_scan_texture_on_callback(OMVPGstCallbackID id,
       break;
   }
 
-  if (player->max_num_scan_vids != player->vids->num_vids) {
+  if (player->max_num_scan_vids < player->num_tiles) {
     _omvp_scan_vid_finish(player, scan_vid_idx);
-    _omvp_scan_vid_start(player, player->scan_vid_idx);
-    player->scan_vid_idx =
-      _omvp_calc_vid_idx(player->scan_vid_idx, 1, player->vids->num_vids);
+    _omvp_scan_vid_start_next(player);
   }
 }
 
+static gint _omvp_scan_vid_on_new_frame(OMVPPlayer *player,
+  gint scan_vid_idx) {
+
+  clutter_actor_set_opacity(player->scan_textures[scan_vid_idx], 0xff);
+
+  if (player->max_num_scan_vids < player->num_tiles) {
+    _omvp_scan_vid_finish(player, scan_vid_idx);
+    _omvp_scan_vid_start_next(player);
+  }
+
+  return 0;
+}
+
+static gint _omvp_texture_on_new_frame(OMVPPlayer *player) {
+  player->is_texture_showing = TRUE;
+  _omvp_refresh_texture(player);
+  _omvp_refresh_text(player);
+  _omvp_scan_texts_timer_cancel_timeout(player);
+  _omvp_scan_texts_timer_start(player);
+
+  if (omvp_gst_get_video_caps_str(player->gst) &&
+    omvp_gst_get_audio_caps_str(player->gst)) {
+    omvp_gst_cancel_new_frame_callback(player->gst);
+  }
+
+  return 0;
+}
+
+/*
+  New frames of all pipelines are taken, uploaded and announced here in one
+  pass right before the stage is painted, so the main loop work follows the
+  display refresh rate instead of the number of tiles.
+*/
+static gboolean _omvp_on_repaint(gpointer user_data) {
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+
+  player->num_frame_callbacks = 0;
+  omvp_gst_update_frames();
+  player->frame_callbacks_per_frame = player->num_frame_callbacks;
+  if (player->max_frame_callbacks_per_frame <
+    player->frame_callbacks_per_frame) {
+    player->max_frame_callbacks_per_frame = player->frame_callbacks_per_frame;
+  }
+
+  return TRUE;
+}
+
+static gint _omvp_update_max_num_scan_vids(OMVPPlayer *player) {
+  player->max_num_scan_vids =
+    MIN(_omvp_scan_num_jobs, player->vids->num_vids);
+
+  return 0;
+}
+
+/*
+  The new playlist is matched against the running one by uri. Entries that
+  are kept keep their tile, their scan pipeline and their last frame, and are
+  only moved if their index changed. Removed entries release their tiles, and
+  new entries get tiles from _omvp_update_tiles() like any other.
+*/
+static gint _omvp_reload_vids(OMVPPlayer *player, OMVPVids *vids) {
+  GHashTable *old_idxs;
+  OMVPTexture *o_scan_textures;
+  ClutterActor **scan_textures;
+  OMVPGst *scan_gsts;
+  guint *scan_timeout_ids;
+  gint *new_idxs;
+  gint num_old_vids;
+  gint focus_idx;
+  gpointer value;
+  gint vid_idx;
+  gint i;
+
+  num_old_vids = player->vids->num_vids;
+
+  old_idxs = g_hash_table_new(g_str_hash, g_str_equal);
+  for (i = num_old_vids - 1; i >= 0; i--) {
+    g_hash_table_insert(old_idxs, player->vids->uris[i],
+      GINT_TO_POINTER(i + 1));
+  }
+  new_idxs = g_malloc(sizeof(gint) * num_old_vids);
+  for (i = 0; i < num_old_vids; i++) {
+    new_idxs[i] = -1;
+  }
+  for (vid_idx = 0; vid_idx < vids->num_vids; vid_idx++) {
+    value = g_hash_table_lookup(old_idxs, vids->uris[vid_idx]);
+    if (value) {
+      g_hash_table_remove(old_idxs, vids->uris[vid_idx]);
+      new_idxs[GPOINTER_TO_INT(value) - 1] = vid_idx;
+    }
+  }
+  g_hash_table_destroy(old_idxs);
+
+  for (i = 0; i < num_old_vids; i++) {
+    if (new_idxs[i] < 0 && player->scan_textures[i]) {
+      _omvp_tile_destroy(player, i);
+    }
+  }
+
+  if (_omvp_auto_num_vid_per_row) {
+    _omvp_num_vid_per_row = _omvp_calc_best_num_vid_per_row(vids->num_vids);
+  }
+  player->num_row = (vids->num_vids - 1) / _omvp_num_vid_per_row + 1;
+
+  o_scan_textures = g_malloc0(sizeof(OMVPTexture) * vids->num_vids);
+  scan_textures = g_malloc0(sizeof(ClutterActor *) * vids->num_vids);
+  scan_gsts = g_malloc0(sizeof(OMVPGst) * vids->num_vids);
+  scan_timeout_ids = g_malloc0(sizeof(guint) * vids->num_vids);
+  for (i = 0; i < num_old_vids; i++) {
+    vid_idx = new_idxs[i];
+    if (vid_idx < 0 || !player->scan_textures[i]) {
+      continue;
+    }
+    scan_textures[vid_idx] = player->scan_textures[i];
+    o_scan_textures[vid_idx] = player->o_scan_textures[i];
+    o_scan_textures[vid_idx].idx = vid_idx;
+    clutter_actor_set_position(scan_textures[vid_idx],
+      (gfloat)(vid_idx % _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE,
+      (gfloat)(vid_idx / _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE);
+    if (player->scan_gsts[i]) {
+      scan_gsts[vid_idx] = player->scan_gsts[i];
+      omvp_gst_set_callback_data(scan_gsts[vid_idx],
+        &o_scan_textures[vid_idx]);
+    }
+    if (player->scan_timeout_ids[i]) {
+      g_source_remove(player->scan_timeout_ids[i]);
+      scan_timeout_ids[vid_idx] = clutter_threads_add_timeout(
+        _omvp_scan_timeout, _omvp_scan_vid_timeout,
+        &o_scan_textures[vid_idx]);
+    }
+  }
+  focus_idx = new_idxs[player->vid_idx];
+  g_free(new_idxs);
+
+  g_free(player->o_scan_textures);
+  g_free(player->scan_textures);
+  g_free(player->scan_gsts);
+  g_free(player->scan_timeout_ids);
+  player->o_scan_textures = o_scan_textures;
+  player->scan_textures = scan_textures;
+  player->scan_gsts = scan_gsts;
+  player->scan_timeout_ids = scan_timeout_ids;
+
+  omvp_labels_set_vids(OMVP_LABELS(player->root_scan_texts), vids,
+    _omvp_num_vid_per_row);
+  omvp_badges_set_vids(OMVP_BADGES(player->root_badges), vids,
+    _omvp_num_vid_per_row);
+  omvp_search_close(player->search);
+  player->search = omvp_search_open(vids);
+  omvp_monitor_close(player->monitor);
+  omvp_vids_close(player->vids);
+  player->vids = vids;
+  _omvp_update_max_num_scan_vids(player);
+  player->monitor = _omvp_monitor_open(player);
+  for (i = 0; i < _OMVP_GOP_CACHE_NUM_RECENT; i++) {
+    player->recent_vid_idxs[i] = -1;
+  }
+  player->num_cached_vid_idxs = 0;
+
+  clutter_actor_set_size(player->root_actor,
+    _omvp_num_vid_per_row * _OMVP_TEX_SIZE, player->num_row * _OMVP_TEX_SIZE);
+  clutter_actor_set_size(player->root_scan_texts,
+    _omvp_num_vid_per_row * _OMVP_TEX_SIZE, player->num_row * _OMVP_TEX_SIZE);
+  clutter_actor_set_size(player->root_badges,
+    _omvp_num_vid_per_row * _OMVP_TEX_SIZE, player->num_row * _OMVP_TEX_SIZE);
+
+  if (focus_idx >= 0) {
+    player->vid_idx = focus_idx;
+    _omvp_set_focus_position(player);
+  } else {
+    player->vid_idx = MIN(player->vid_idx, vids->num_vids - 1);
+    _omvp_move_focus(player);
+  }
+  _omvp_update_gop_cache(player);
+
+  player->view_num_per_row =
+    MIN(player->view_num_per_row, _omvp_num_vid_per_row);
+  player->org_view_num_per_row =
+    MIN(player->org_view_num_per_row, _omvp_num_vid_per_row);
+  if (!_omvp_is_focus_visible(player)) {
+    _omvp_auto_view(player);
+  }
+
+  /* kept tiles can be anywhere in the new grid until they are trimmed. */
+  player->tile_min_x = 0;
+  player->tile_max_x = _omvp_num_vid_per_row - 1;
+  player->tile_min_y = 0;
+  player->tile_max_y = player->num_row - 1;
+  _omvp_reshape(player);
+
+  g_debug("reloaded %s num_vids(%d)", player->vids_filename,
+    vids->num_vids);
+
+  return 0;
+}
+
+/* behind a proxy the channels arrive over http and can't be monitored. */
+static OMVPMonitor _omvp_monitor_open(OMVPPlayer *player) {
+
+  if (_omvp_no_monitor || _omvp_proxy_uri) {
+    return NULL;
+  }
+
+  return omvp_monitor_open(player->vids, _omvp_monitor_on_health, player);
+}
+
+static void _omvp_monitor_on_health(gint vid_idx, OMVPMonitorHealth health,
+  gpointer user_data) {
+  static const ClutterColor colors[] = {
+    {0, 0, 0, 0}, {0, 200, 0, 255}, {255, 180, 0, 255}, {220, 0, 0, 255}
+  };
+  OMVPPlayer *player;
+
+  player = (OMVPPlayer *)user_data;
+  omvp_badges_set_badge(OMVP_BADGES(player->root_badges), vid_idx,
+    health == OMVP_MONITOR_HEALTH_UNKNOWN ? NULL : &colors[health]);
+
+  /* a channel that came back may be scanned again. */
+  if (health != OMVP_MONITOR_HEALTH_DEAD) {
+    _omvp_scan_vid_start_all(player);
+  }
+}
+
+static gboolean _omvp_vids_reload_timeout(gpointer user_data) {
+  OMVPPlayer *player;
+  OMVPVids *vids;
+  gchar *data;
+  gsize size;
+
+  player = (OMVPPlayer *)user_data;
+  player->vids_reload_timeout_id = 0;
+
+  /*
+    The file is copied rather than mapped because an editor may truncate it
+    while it is parsed, which would fault on the mapping.
+  */
+  vids = NULL;
+  if (g_file_get_contents(player->vids_filename, &data, &size, NULL)) {
+    vids = omvp_vids_open_data(player->vids_filename, data, size);
+    g_free(data);
+  }
+  if (vids == NULL) {
+    g_debug("failed to reload %s", player->vids_filename);
+    return FALSE;
+  }
+  _omvp_reload_vids(player, vids);
+
+  return FALSE;
+}
+
+/* editors write in several steps, so reload once the file settles down. */
+static void _omvp_on_vids_changed(GFileMonitor *monitor, GFile *file,
+  GFile *other_file, GFileMonitorEvent event_type, gpointer user_data) {
+  OMVPPlayer *player;
+
+  (void)monitor;
+  (void)file;
+  (void)other_file;
+
+  player = (OMVPPlayer *)user_data;
+
+  switch (event_type) {
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_CREATED:
+      break;
+    default:
+      return;
+  }
+
+  if (player->vids_reload_timeout_id) {
+    g_source_remove(player->vids_reload_timeout_id);
+  }
+  player->vids_reload_timeout_id = clutter_threads_add_timeout(
+    _OMVP_RELOAD_DELAY, _omvp_vids_reload_timeout, player);
+}
+
 int main(int argc, char *argv[]) {
   GError *error = NULL;
   OMVPPlayer player;
@@ -904,14 +2079,14 @@ int main(int argc, char *argv[]) {
   ClutterColor stage_color = {0, 0, 0, 255};
   ClutterColor focus_color = {255, 255, 0, 255};
   ClutterColor text_color = {255, 255, 255, 255};
-  gchar *text;
   PangoAttribute *text_attr;
   PangoAttrList *text_attrs;
   ClutterConstraint *constraint;
   gint i;
 
-  if (clutter_gst_init_with_args(&argc, &argv, "[videos m3u/csv file]",
-    _omvp_entries, NULL, &error) != CLUTTER_INIT_SUCCESS) {
+  if (clutter_gst_init_with_args(&argc, &argv,
+    "[videos m3u/csv file or http(s) uri]", _omvp_entries, NULL, &error) !=
+    CLUTTER_INIT_SUCCESS) {
     g_print("Failed to initialize: %s\n", error->message);
     g_error_free(error);
     return -1;
@@ -936,6 +2111,8 @@ int main(int argc, char *argv[]) {
       "Home               : Change audio\n"
       "End                : Mute/Unmute\n"
       "Insert             : Change text mode(none/main_only/main_debug)\n"
+      "0-9/a-z            : Jump to the channel matching the typed id/name\n"
+      "Backspace/Esc      : Edit/Clear the typed id/name\n"
     );
     return 0;
   }
@@ -947,27 +2124,46 @@ int main(int argc, char *argv[]) {
   }
 
   memset(&player, 0, sizeof(OMVPPlayer));
-  player.vids = omvp_vids_open(_omvp_vids_filename);
+  if (omvp_fetch_is_remote(_omvp_vids_filename)) {
+    player.fetch = omvp_fetch_open(_omvp_vids_filename,
+      _omvp_refresh_interval);
+    player.vids_filename = g_strdup(omvp_fetch_get_filename(player.fetch));
+  } else {
+    player.vids_filename = g_strdup(_omvp_vids_filename);
+  }
+  player.vids = omvp_vids_open(player.vids_filename);
   if (player.vids == NULL) {
-    if (strcmp(_omvp_vids_filename, "omvp.m3u") != 0) {
-      player.vids = omvp_vids_open("omvp.m3u");
+    const gchar *filename;
+    filename = "omvp.m3u";
+    if (strcmp(_omvp_vids_filename, filename) != 0) {
+      player.vids = omvp_vids_open(filename);
     }
     if (player.vids == NULL) {
-      player.vids = omvp_vids_open("omvp.csv");
+      filename = "omvp.csv";
+      player.vids = omvp_vids_open(filename);
       if (player.vids == NULL) {
         g_print("Failed to open %s\n", _omvp_vids_filename);
+        g_free(player.vids_filename);
+        omvp_fetch_close(player.fetch);
         return -1;
       }
     }
+    /* the cache file stays watched, so the first fetch replaces these. */
+    if (!player.fetch) {
+      g_free(player.vids_filename);
+      player.vids_filename = g_strdup(filename);
+    }
   }
+  player.search = omvp_search_open(player.vids);
+  player.search_query = g_string_new(NULL);
   player.o_scan_textures =
     g_malloc0(sizeof(OMVPTexture) * player.vids->num_vids);
   player.scan_textures =
     g_malloc0(sizeof(ClutterActor *) * player.vids->num_vids);
-  player.scan_texts =
-    g_malloc0(sizeof(ClutterActor *) * player.vids->num_vids);
   player.scan_gsts = g_malloc0(sizeof(OMVPGst) * player.vids->num_vids);
   player.scan_timeout_ids = g_malloc0(sizeof(guint) * player.vids->num_vids);
+  player.all_scan_textures = g_ptr_array_new();
+  player.free_scan_textures = g_ptr_array_new();
   player.volume = _omvp_default_volume;
   player.mute = _omvp_default_mute;
   player.text_info = OMVP_TEXT_INFO_MAIN_ONLY;
@@ -978,6 +2174,7 @@ int main(int argc, char *argv[]) {
     player.text_info = OMVP_TEXT_INFO_MAIN_AND_DEBUG;
   }
   if (!_omvp_num_vid_per_row) {
+    _omvp_auto_num_vid_per_row = TRUE;
     _omvp_num_vid_per_row =
       _omvp_calc_best_num_vid_per_row(player.vids->num_vids);
   }
@@ -1012,29 +2209,6 @@ int main(int argc, char *argv[]) {
   clutter_actor_set_scale(player.focus_actor,
     _OMVP_FOCUS_SCALE, _OMVP_FOCUS_SCALE);
 
-  for (i = 0; i < player.vids->num_vids; i++) {
-#if CLUTTER_GST_MAJOR_VERSION > 2
-    player.scan_textures[i] = clutter_actor_new();
-#else
-    player.scan_textures[i] =
-      g_object_new(CLUTTER_TYPE_TEXTURE, "disable-slicing", TRUE, NULL);
-#endif
-    player.o_scan_textures[i].player = &player;
-    player.o_scan_textures[i].idx = i;
-    player.o_scan_textures[i].texture = player.scan_textures[i];
-    clutter_actor_set_opacity(player.scan_textures[i], 0);
-    clutter_actor_add_child(player.root_actor, player.scan_textures[i]);
-    g_object_ref(player.o_scan_textures[i].texture);
-    clutter_actor_set_position(player.scan_textures[i],
-      (gfloat)(i % _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE,
-      (gfloat)(i / _omvp_num_vid_per_row) * (gfloat)_OMVP_TEX_SIZE);
-    clutter_actor_set_size(player.scan_textures[i],
-      _OMVP_TEX_SIZE, _OMVP_TEX_SIZE);
-    clutter_actor_set_pivot_point(player.scan_textures[i], 0.5f, 0.5f);
-    clutter_actor_set_scale(player.scan_textures[i],
-      _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
-  }
-
 #if CLUTTER_GST_MAJOR_VERSION > 2
   player.texture = clutter_actor_new();
 #else
@@ -1053,31 +2227,26 @@ int main(int argc, char *argv[]) {
   clutter_actor_set_scale(player.texture,
     _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
 
-  player.root_scan_texts = clutter_actor_new();
+  player.root_scan_texts = omvp_labels_new(_OMVP_SCAN_TEXT_FONT,
+    (gfloat)_OMVP_TEX_SIZE, _OMVP_SCAN_VID_SCALE);
+  omvp_labels_set_vids(OMVP_LABELS(player.root_scan_texts), player.vids,
+    _omvp_num_vid_per_row);
   clutter_actor_set_position(player.root_scan_texts, 0.0f, 0.0f);
   clutter_actor_set_size(player.root_scan_texts,
     _omvp_num_vid_per_row * _OMVP_TEX_SIZE, player.num_row * _OMVP_TEX_SIZE);
   clutter_actor_add_child(player.root_actor, player.root_scan_texts);
-
-  for (i = 0; i < player.vids->num_vids; i++) {
-    text = g_strdup_printf("%s\n%s",
-      player.vids->ids[i], player.vids->names[i]);
-    player.scan_texts[i] =
-      clutter_text_new_full(_OMVP_SCAN_TEXT_FONT, text, &text_color);
-    g_free(text);
-    text_attrs = pango_attr_list_new();
-    text_attr = pango_attr_background_new(0, 0, 0);
-    pango_attr_list_insert(text_attrs, text_attr);
-    clutter_text_set_attributes(
-      CLUTTER_TEXT(player.scan_texts[i]), text_attrs);
-    pango_attr_list_unref(text_attrs);
-    clutter_actor_add_child(player.root_scan_texts, player.scan_texts[i]);
-    constraint = clutter_bind_constraint_new(
-      player.scan_textures[i], CLUTTER_BIND_ALL, 0.0f);
-    clutter_actor_add_constraint(player.scan_texts[i], constraint);
-    clutter_actor_set_pivot_point(player.scan_texts[i], 0.5f, 0.5f);
-    clutter_actor_set_scale(player.scan_texts[i],
-      _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
+  /* the badges stay visible while the labels are hidden. */
+  player.root_badges = omvp_badges_new((gfloat)_OMVP_TEX_SIZE,
+    _OMVP_SCAN_VID_SCALE);
+  omvp_badges_set_vids(OMVP_BADGES(player.root_badges), player.vids,
+    _omvp_num_vid_per_row);
+  clutter_actor_set_position(player.root_badges, 0.0f, 0.0f);
+  clutter_actor_set_size(player.root_badges,
+    _omvp_num_vid_per_row * _OMVP_TEX_SIZE, player.num_row * _OMVP_TEX_SIZE);
+  clutter_actor_add_child(player.root_actor, player.root_badges);
+  player.monitor = _omvp_monitor_open(&player);
+  for (i = 0; i < _OMVP_GOP_CACHE_NUM_RECENT; i++) {
+    player.recent_vid_idxs[i] = -1;
   }
 
   player.text = clutter_text_new_full(_OMVP_TEXT_FONT, "", &text_color);
@@ -1101,25 +2270,57 @@ int main(int argc, char *argv[]) {
   clutter_actor_set_scale(player.text,
     _OMVP_SCAN_VID_SCALE, _OMVP_SCAN_VID_SCALE);
 
-  _omvp_refresh_text(&player);
+  player.search_text =
+    clutter_text_new_full(_OMVP_SEARCH_TEXT_FONT, "", &text_color);
+  text_attrs = pango_attr_list_new();
+  text_attr = pango_attr_background_new(0, 0, 0);
+  pango_attr_list_insert(text_attrs, text_attr);
+  clutter_text_set_attributes(CLUTTER_TEXT(player.search_text), text_attrs);
+  pango_attr_list_unref(text_attrs);
+  clutter_actor_set_position(player.search_text, 10.0f, 10.0f);
+  clutter_actor_add_child(stage, player.search_text);
+  clutter_actor_hide(player.search_text);
 
   clutter_actor_set_easing_mode(player.root_actor, CLUTTER_EASE_OUT_CUBIC);
   clutter_actor_set_easing_duration(player.root_actor, _omvp_ani_duration);
 
   clutter_actor_show(stage);
 
-  player.gst = omvp_gst_open(_omvp_proxy_uri,
-    player.vids->uris[player.vid_idx], player.texture, FALSE, 0, 0,
-    _omvp_texture_on_callback, &player.o_texture);
-  player.o_texture.content = clutter_actor_get_content(player.texture);
-  omvp_gst_set_volume(player.gst, player.volume);
-  omvp_gst_set_mute(player.gst, player.mute);
+  player.repaint_func_id = clutter_threads_add_repaint_func_full(
+    CLUTTER_REPAINT_FLAGS_PRE_PAINT, _omvp_on_repaint, &player, NULL);
+
+  g_signal_connect(player.root_actor, "transitions-completed",
+    G_CALLBACK(_omvp_on_transitions_completed), &player);
+  if (_omvp_max_idle_fps > 0) {
+    g_signal_connect(player.texture, "transitions-completed",
+      G_CALLBACK(_omvp_on_transitions_completed), &player);
+    player.throttle_timeout_id = clutter_threads_add_timeout(
+      MAX(1000 / _omvp_max_idle_fps, 1), _omvp_throttle_timeout, &player);
+    _omvp_refresh_throttle(&player);
+  }
+
+  _omvp_open_focus(&player);
+  player.watchdog_timeout_id = clutter_threads_add_timeout(
+    _OMVP_WATCHDOG_INTERVAL, _omvp_watchdog_timeout, &player);
+
+  _omvp_refresh_text(&player);
 
-  player.max_num_scan_vids = _omvp_scan_num_jobs;
-  if (player.max_num_scan_vids > player.vids->num_vids) {
-    player.max_num_scan_vids = player.vids->num_vids;
+  _omvp_update_max_num_scan_vids(&player);
+  _omvp_update_tiles(&player);
+
+  {
+    GFile *file;
+    file = g_file_new_for_path(player.vids_filename);
+    player.vids_monitor =
+      g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+    g_object_unref(file);
+    if (player.vids_monitor) {
+      g_signal_connect(player.vids_monitor, "changed",
+        G_CALLBACK(_omvp_on_vids_changed), &player);
+    } else {
+      g_debug("can't watch %s", player.vids_filename);
+    }
   }
-  _omvp_scan_vid_start_all(&player);
 
   clutter_main();
 
@@ -0,0 +1,567 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "config.h"
+#include "omvp_monitor.h"
+#include "omvp_recv.h"
+#include "omvp_ts.h"
+
+#define _OMVP_MONITOR_INTERVAL 1000
+/* a channel without packets for this long is dead. */
+#define _OMVP_MONITOR_DEAD_TIMEOUT (3 * G_USEC_PER_SEC)
+/* an error keeps a channel degraded for this long. */
+#define _OMVP_MONITOR_DEGRADED_HOLD (5 * G_USEC_PER_SEC)
+/* PAT and PMT are sent a few times per second, PCR every 100ms. */
+#define _OMVP_MONITOR_PSI_TIMEOUT (2 * G_USEC_PER_SEC)
+#define _OMVP_MONITOR_PCR_TIMEOUT (G_USEC_PER_SEC)
+#define _OMVP_MONITOR_MAX_PCR_JITTER 50000
+/* the monitor frees every packet at once, so a few buffers are enough. */
+#define _OMVP_MONITOR_BATCH_SIZE 8
+#define _OMVP_MONITOR_POOL_SIZE 64
+
+#define _OMVP_MONITOR_NUM_PIDS 8192
+#define _OMVP_MONITOR_PID_SEEN 0x10
+#define _OMVP_MONITOR_PID_PMT 0x20
+/* PCR is 33 bits of 90kHz base and 9 bits of 27MHz extension. */
+#define _OMVP_MONITOR_PCR_WRAP ((G_GINT64_CONSTANT(1) << 33) * 300)
+
+struct _OMVPMonitorImpl;
+
+typedef struct _OMVPMonitorChannel {
+  struct _OMVPMonitorImpl *monitor_impl;
+  gint vid_idx;
+  OMVPRecv receiver;
+  OMVPMonitorHealth health;
+  OMVPMonitorStats stats;
+
+  gboolean has_seq;
+  guint16 last_seq;
+  /* continuity counter and flags of every PID, once TS is seen. */
+  guint8 *pids;
+  gint pcr_pid;
+  gint64 last_pcr;
+  gint64 pcr_clock;
+  gboolean has_pcr_offset;
+  gint64 min_pcr_offset;
+  gint64 max_pcr_offset;
+  gint64 last_arrival;
+  gint64 last_pat;
+  gint64 last_pmt;
+  gint64 last_pcr_arrival;
+  gint64 last_error;
+  guint64 window_bytes;
+} OMVPMonitorChannel;
+
+typedef struct _OMVPMonitorImpl {
+  GMutex lock;
+  OMVPMonitorChannel *channels;
+  gint num_channels;
+  gint64 open_time;
+  gint64 window_time;
+  guint timeout_id;
+  OMVPMonitorCallback callback;
+  gpointer callback_data;
+} OMVPMonitorImpl;
+
+static gint _omvp_monitor_parse_uri(const gchar *uri, gchar **host,
+  guint16 *port, gint *program);
+static gint _omvp_monitor_get_ts_offset(const guint8 *data, gsize size);
+static gint _omvp_monitor_parse_pat(OMVPMonitorChannel *channel,
+  const guint8 *section, gsize size);
+static gint _omvp_monitor_parse_pcr(OMVPMonitorChannel *channel,
+  const guint8 *packet, gint64 now);
+static gint _omvp_monitor_parse_ts(OMVPMonitorChannel *channel,
+  const guint8 *data, gsize size, gint64 now);
+static void _omvp_monitor_on_packet(GstBuffer *buffer, gpointer user_data);
+static OMVPMonitorHealth _omvp_monitor_update(OMVPMonitorChannel *channel,
+  gint64 now, gint64 elapsed);
+static gboolean _omvp_monitor_on_timeout(gpointer user_data);
+
+/*
+  Only multicast and unicast UDP uris can be monitored, in the forms
+  udp://@239.1.1.1:1234, rtp://239.1.1.1:5000 and ortp://[ff15::1]:5000,
+  with an optional "program" parameter.
+*/
+static gint _omvp_monitor_parse_uri(const gchar *uri, gchar **host,
+  guint16 *port, gint *program) {
+  const gchar *location;
+  const gchar *query;
+  const gchar *host_end;
+  const gchar *colon;
+  gchar **params;
+  gint i;
+
+  if (g_str_has_prefix(uri, "udp://")) {
+    location = uri + strlen("udp://");
+  } else if (g_str_has_prefix(uri, "rtp://")) {
+    location = uri + strlen("rtp://");
+  } else if (g_str_has_prefix(uri, "ortp://")) {
+    location = uri + strlen("ortp://");
+  } else {
+    return -1;
+  }
+
+  query = strchr(location, '?');
+  if (!query) {
+    query = location + strlen(location);
+  }
+  host_end = memchr(location, '@', query - location);
+  if (host_end) {
+    location = host_end + 1;
+  }
+  if (*location == '[') {
+    host_end = memchr(location, ']', query - location);
+    if (!host_end) {
+      return -1;
+    }
+    *host = g_strndup(location + 1, host_end - location - 1);
+    colon = host_end + 1;
+  } else {
+    colon = memchr(location, ':', query - location);
+    if (!colon) {
+      return -1;
+    }
+    *host = g_strndup(location, colon - location);
+  }
+  if (*colon != ':') {
+    g_free(*host);
+    return -1;
+  }
+  *port = (guint16)g_ascii_strtoull(colon + 1, NULL, 10);
+
+  *program = 0;
+  if (*query) {
+    params = g_strsplit(query + 1, "&", -1);
+    for (i = 0; params[i]; i++) {
+      if (g_str_has_prefix(params[i], "program=")) {
+        *program = CLAMP(g_ascii_strtoll(params[i] + strlen("program="),
+          NULL, 10), 0, 65535);
+      }
+    }
+    g_strfreev(params);
+  }
+
+  return 0;
+}
+
+/* the offset of the TS packets in a raw or RTP datagram, or -1. */
+static gint _omvp_monitor_get_ts_offset(const guint8 *data, gsize size) {
+  gsize offset;
+
+  if (size >= OMVP_TS_PACKET_SIZE && data[0] == 0x47) {
+    return 0;
+  }
+  if (size < 12 || (data[0] >> 6) != 2) {
+    return -1;
+  }
+  offset = 12 + (data[0] & 0x0f) * 4;
+  if (data[0] & 0x10) {
+    if (offset + 4 > size) {
+      return -1;
+    }
+    offset += 4 + ((data[offset + 2] << 8) | data[offset + 3]) * 4;
+  }
+  if (offset >= size || data[offset] != 0x47) {
+    return -1;
+  }
+
+  return (gint)offset;
+}
+
+/* marks the PMT PIDs of every program of the PAT section. */
+static gint _omvp_monitor_parse_pat(OMVPMonitorChannel *channel,
+  const guint8 *section, gsize size) {
+  gsize section_length;
+  gsize i;
+  gint pid;
+
+  if (size < 8 || section[0] != 0x00) {
+    return -1;
+  }
+  section_length = ((section[1] & 0x0f) << 8) | section[2];
+  if (section_length < 9 || 3 + section_length > size) {
+    return -1;
+  }
+  for (i = 8; i + 4 <= 3 + section_length - 4; i += 4) {
+    if (((section[i] << 8) | section[i + 1]) == 0) {
+      continue;
+    }
+    pid = ((section[i + 2] & 0x1f) << 8) | section[i + 3];
+    channel->pids[pid] |= _OMVP_MONITOR_PID_PMT;
+  }
+
+  return 0;
+}
+
+/*
+  The PCR jitter is the spread of arrival time minus PCR time over an
+  interval, which covers both the encoder and the network.
+*/
+static gint _omvp_monitor_parse_pcr(OMVPMonitorChannel *channel,
+  const guint8 *packet, gint64 now) {
+  gint64 pcr;
+  gint64 delta;
+  gint64 offset;
+
+  pcr = ((gint64)packet[6] << 25) | (packet[7] << 17) | (packet[8] << 9) |
+    (packet[9] << 1) | (packet[10] >> 7);
+  pcr = pcr * 300 + (((packet[10] & 0x01) << 8) | packet[11]);
+
+  channel->stats.num_pcrs++;
+  channel->last_pcr_arrival = now;
+  delta = (pcr - channel->last_pcr + _OMVP_MONITOR_PCR_WRAP) %
+    _OMVP_MONITOR_PCR_WRAP;
+  channel->last_pcr = pcr;
+  if (channel->pcr_clock == 0 || delta > 27000000) {
+    /* the first PCR or a discontinuity restarts the PCR clock. */
+    channel->pcr_clock = now;
+    channel->has_pcr_offset = FALSE;
+    return 0;
+  }
+  channel->pcr_clock += delta / 27;
+
+  offset = now - channel->pcr_clock;
+  if (!channel->has_pcr_offset) {
+    channel->has_pcr_offset = TRUE;
+    channel->min_pcr_offset = offset;
+    channel->max_pcr_offset = offset;
+  }
+  channel->min_pcr_offset = MIN(channel->min_pcr_offset, offset);
+  channel->max_pcr_offset = MAX(channel->max_pcr_offset, offset);
+
+  return 0;
+}
+
+static gint _omvp_monitor_parse_ts(OMVPMonitorChannel *channel,
+  const guint8 *data, gsize size, gint64 now) {
+  const guint8 *packet;
+  gsize offset;
+  guint8 flags;
+  gint pid;
+  gint cc;
+  gboolean has_adaptation, has_payload, discontinuity;
+
+  if (!channel->pids) {
+    channel->pids = g_malloc0(_OMVP_MONITOR_NUM_PIDS);
+    channel->pcr_pid = -1;
+  }
+
+  for (packet = data; packet + OMVP_TS_PACKET_SIZE <= data + size;
+    packet += OMVP_TS_PACKET_SIZE) {
+    if (packet[0] != 0x47) {
+      channel->stats.num_cc_errors++;
+      channel->last_error = now;
+      continue;
+    }
+    pid = ((packet[1] & 0x1f) << 8) | packet[2];
+    if (pid == 0x1fff) {
+      continue;
+    }
+    has_adaptation = (packet[3] & 0x20) != 0;
+    has_payload = (packet[3] & 0x10) != 0;
+    cc = packet[3] & 0x0f;
+    discontinuity = has_adaptation && packet[4] > 0 && (packet[5] & 0x80);
+
+    /* a repeated counter is a legal duplicate packet. */
+    flags = channel->pids[pid];
+    if (has_payload) {
+      if ((flags & _OMVP_MONITOR_PID_SEEN) && !discontinuity &&
+        cc != ((flags + 1) & 0x0f) && cc != (flags & 0x0f)) {
+        channel->stats.num_cc_errors++;
+        channel->last_error = now;
+      }
+      channel->pids[pid] = (flags & ~0x0f) | _OMVP_MONITOR_PID_SEEN | cc;
+    }
+
+    if (has_adaptation && packet[4] >= 7 && (packet[5] & 0x10)) {
+      if (channel->pcr_pid < 0) {
+        channel->pcr_pid = pid;
+      }
+      if (pid == channel->pcr_pid) {
+        _omvp_monitor_parse_pcr(channel, packet, now);
+      }
+    }
+
+    if (!has_payload || !(packet[1] & 0x40)) {
+      continue;
+    }
+    offset = 4 + (has_adaptation ? 1 + packet[4] : 0);
+    if (pid == 0) {
+      channel->last_pat = now;
+      if (offset < OMVP_TS_PACKET_SIZE &&
+        offset + 1 + packet[offset] < OMVP_TS_PACKET_SIZE) {
+        _omvp_monitor_parse_pat(channel, packet + offset + 1 + packet[offset],
+          OMVP_TS_PACKET_SIZE - offset - 1 - packet[offset]);
+      }
+    } else if (flags & _OMVP_MONITOR_PID_PMT) {
+      channel->last_pmt = now;
+    }
+  }
+
+  return 0;
+}
+
+/* called from the receive thread. */
+static void _omvp_monitor_on_packet(GstBuffer *buffer, gpointer user_data) {
+  OMVPMonitorChannel *channel;
+  GstMapInfo map;
+  gint64 now;
+  gint offset;
+  gint16 delta;
+
+  channel = (OMVPMonitorChannel *)user_data;
+  if (!gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+    gst_buffer_unref(buffer);
+    return;
+  }
+  now = g_get_monotonic_time();
+
+  g_mutex_lock(&channel->monitor_impl->lock);
+  if (channel->last_arrival == 0) {
+    /* PSI and PCR get their full timeout from the first packet on. */
+    channel->last_pat = now;
+    channel->last_pmt = now;
+    channel->last_pcr_arrival = now;
+  }
+  channel->last_arrival = now;
+  channel->stats.num_packets++;
+  channel->window_bytes += map.size;
+
+  offset = _omvp_monitor_get_ts_offset(map.data, map.size);
+  if (offset != 0 && map.size >= 12 && (map.data[0] >> 6) == 2) {
+    delta = (gint16)(GST_READ_UINT16_BE(map.data + 2) - channel->last_seq);
+    if (channel->has_seq && delta > 1) {
+      channel->stats.num_seq_gaps += delta - 1;
+      channel->last_error = now;
+    }
+    if (!channel->has_seq || delta > 0) {
+      channel->has_seq = TRUE;
+      channel->last_seq = GST_READ_UINT16_BE(map.data + 2);
+    }
+  }
+  if (offset >= 0) {
+    _omvp_monitor_parse_ts(channel, map.data + offset, map.size - offset,
+      now);
+  }
+  g_mutex_unlock(&channel->monitor_impl->lock);
+
+  gst_buffer_unmap(buffer, &map);
+  gst_buffer_unref(buffer);
+}
+
+/* called with the lock, once per interval. */
+static OMVPMonitorHealth _omvp_monitor_update(OMVPMonitorChannel *channel,
+  gint64 now, gint64 elapsed) {
+  OMVPMonitorStats *stats;
+
+  stats = &channel->stats;
+  stats->kbps = elapsed > 0 ?
+    (gint)(channel->window_bytes * 8 * 1000 / elapsed) : 0;
+  channel->window_bytes = 0;
+  stats->pcr_jitter_us = channel->has_pcr_offset ?
+    (gint)(channel->max_pcr_offset - channel->min_pcr_offset) : 0;
+  channel->has_pcr_offset = FALSE;
+
+  if (!channel->receiver) {
+    return OMVP_MONITOR_HEALTH_UNKNOWN;
+  }
+  if (channel->last_arrival == 0) {
+    return now - channel->monitor_impl->open_time >
+      _OMVP_MONITOR_DEAD_TIMEOUT ?
+      OMVP_MONITOR_HEALTH_DEAD : OMVP_MONITOR_HEALTH_UNKNOWN;
+  }
+  if (now - channel->last_arrival > _OMVP_MONITOR_DEAD_TIMEOUT) {
+    return OMVP_MONITOR_HEALTH_DEAD;
+  }
+
+  if (channel->pids) {
+    stats->has_pat = now - channel->last_pat <= _OMVP_MONITOR_PSI_TIMEOUT;
+    stats->has_pmt = now - channel->last_pmt <= _OMVP_MONITOR_PSI_TIMEOUT;
+    if (!stats->has_pat || !stats->has_pmt ||
+      now - channel->last_pcr_arrival > _OMVP_MONITOR_PCR_TIMEOUT ||
+      stats->pcr_jitter_us > _OMVP_MONITOR_MAX_PCR_JITTER) {
+      channel->last_error = now;
+    }
+  }
+  if (channel->last_error &&
+    now - channel->last_error < _OMVP_MONITOR_DEGRADED_HOLD) {
+    return OMVP_MONITOR_HEALTH_DEGRADED;
+  }
+
+  return OMVP_MONITOR_HEALTH_OK;
+}
+
+static gboolean _omvp_monitor_on_timeout(gpointer user_data) {
+  OMVPMonitorImpl *monitor_impl;
+  OMVPMonitorChannel *channel;
+  OMVPMonitorHealth health;
+  GArray *changed;
+  gint64 now;
+  gint i;
+
+  monitor_impl = (OMVPMonitorImpl *)user_data;
+  now = g_get_monotonic_time();
+  changed = g_array_new(FALSE, FALSE, sizeof(gint));
+
+  g_mutex_lock(&monitor_impl->lock);
+  for (i = 0; i < monitor_impl->num_channels; i++) {
+    channel = &monitor_impl->channels[i];
+    health = _omvp_monitor_update(channel, now,
+      now - monitor_impl->window_time);
+    if (health != channel->health) {
+      channel->health = health;
+      channel->stats.health = health;
+      g_array_append_val(changed, i);
+    }
+  }
+  monitor_impl->window_time = now;
+  g_mutex_unlock(&monitor_impl->lock);
+
+  /* the callback may look at the monitor again. */
+  for (i = 0; i < (gint)changed->len; i++) {
+    channel = &monitor_impl->channels[g_array_index(changed, gint, i)];
+    monitor_impl->callback(channel->vid_idx, channel->health,
+      monitor_impl->callback_data);
+  }
+  g_array_free(changed, TRUE);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*
+  Stays joined to every UDP channel of the playlist and checks it at the
+  packet level, without any decoder: RTP sequence gaps, TS continuity
+  counters, PCR presence and jitter, PAT and PMT presence and bitrate.
+*/
+OMVPMonitor omvp_monitor_open(OMVPVids *vids, OMVPMonitorCallback callback,
+  gpointer user_data) {
+  OMVPMonitorImpl *monitor_impl;
+  OMVPMonitorChannel *channel;
+  gchar *host;
+  guint16 port;
+  gint program;
+  gint i;
+
+  monitor_impl = g_malloc0(sizeof(OMVPMonitorImpl));
+  g_mutex_init(&monitor_impl->lock);
+  monitor_impl->callback = callback;
+  monitor_impl->callback_data = user_data;
+  monitor_impl->num_channels = vids->num_vids;
+  monitor_impl->channels =
+    g_malloc0(sizeof(OMVPMonitorChannel) * vids->num_vids);
+  monitor_impl->open_time = g_get_monotonic_time();
+  monitor_impl->window_time = monitor_impl->open_time;
+
+  for (i = 0; i < vids->num_vids; i++) {
+    channel = &monitor_impl->channels[i];
+    channel->monitor_impl = monitor_impl;
+    channel->vid_idx = i;
+    channel->health = OMVP_MONITOR_HEALTH_UNKNOWN;
+    if (_omvp_monitor_parse_uri(vids->uris[i], &host, &port,
+      &program) != 0) {
+      continue;
+    }
+    channel->receiver = omvp_recv_open(host, port, program, 0,
+      _OMVP_MONITOR_BATCH_SIZE, _OMVP_MONITOR_POOL_SIZE,
+      _omvp_monitor_on_packet, channel);
+    g_free(host);
+  }
+
+  monitor_impl->timeout_id = g_timeout_add(_OMVP_MONITOR_INTERVAL,
+    _omvp_monitor_on_timeout, monitor_impl);
+
+  g_debug("omvp_monitor_open monitor(%p) %d channels", monitor_impl,
+    vids->num_vids);
+
+  return monitor_impl;
+}
+
+gint omvp_monitor_close(OMVPMonitor monitor) {
+  OMVPMonitorImpl *monitor_impl;
+  gint i;
+
+  monitor_impl = (OMVPMonitorImpl *)monitor;
+  if (!monitor_impl) {
+    return 0;
+  }
+
+  g_source_remove(monitor_impl->timeout_id);
+  /* no callback runs once its receiver is closed. */
+  for (i = 0; i < monitor_impl->num_channels; i++) {
+    if (monitor_impl->channels[i].receiver) {
+      omvp_recv_close(monitor_impl->channels[i].receiver);
+    }
+    g_free(monitor_impl->channels[i].pids);
+  }
+  g_free(monitor_impl->channels);
+  g_mutex_clear(&monitor_impl->lock);
+  g_free(monitor_impl);
+
+  g_debug("omvp_monitor_close monitor(%p)", monitor);
+
+  return 0;
+}
+
+OMVPMonitorHealth omvp_monitor_get_health(OMVPMonitor monitor,
+  gint vid_idx) {
+  OMVPMonitorImpl *monitor_impl;
+
+  g_assert(monitor);
+  monitor_impl = (OMVPMonitorImpl *)monitor;
+  if (vid_idx < 0 || vid_idx >= monitor_impl->num_channels) {
+    return OMVP_MONITOR_HEALTH_UNKNOWN;
+  }
+
+  return monitor_impl->channels[vid_idx].health;
+}
+
+gint omvp_monitor_get_stats(OMVPMonitor monitor, gint vid_idx,
+  OMVPMonitorStats *stats) {
+  OMVPMonitorImpl *monitor_impl;
+
+  g_assert(monitor);
+  monitor_impl = (OMVPMonitorImpl *)monitor;
+  if (vid_idx < 0 || vid_idx >= monitor_impl->num_channels) {
+    return -1;
+  }
+
+  g_mutex_lock(&monitor_impl->lock);
+  *stats = monitor_impl->channels[vid_idx].stats;
+  g_mutex_unlock(&monitor_impl->lock);
+
+  return 0;
+}
+
+/* the receiver of vid_idx keeps its last GOP for the pipelines opened next. */
+gint omvp_monitor_set_gop_cache(OMVPMonitor monitor, gint vid_idx,
+  gsize max_bytes) {
+  OMVPMonitorImpl *monitor_impl;
+
+  g_assert(monitor);
+  monitor_impl = (OMVPMonitorImpl *)monitor;
+  if (vid_idx < 0 || vid_idx >= monitor_impl->num_channels ||
+    !monitor_impl->channels[vid_idx].receiver) {
+    return -1;
+  }
+
+  return omvp_recv_set_cache_size(monitor_impl->channels[vid_idx].receiver,
+    max_bytes);
+}
@@ -0,0 +1,62 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_MONITOR_H_
+#define _OMVP_MONITOR_H_
+
+#include <glib.h>
+#include "omvp_vids.h"
+
+typedef void *OMVPMonitor;
+
+typedef enum _OMVPMonitorHealth {
+  OMVP_MONITOR_HEALTH_UNKNOWN,
+  OMVP_MONITOR_HEALTH_OK,
+  OMVP_MONITOR_HEALTH_DEGRADED,
+  OMVP_MONITOR_HEALTH_DEAD
+} OMVPMonitorHealth;
+
+typedef struct _OMVPMonitorStats {
+  OMVPMonitorHealth health;
+  guint64 num_packets;
+  guint64 num_seq_gaps;
+  guint64 num_cc_errors;
+  guint64 num_pcrs;
+  gint pcr_jitter_us;
+  gboolean has_pat;
+  gboolean has_pmt;
+  gint kbps;
+} OMVPMonitorStats;
+
+/* called from the main loop when the health of vid_idx changes. */
+typedef void (*OMVPMonitorCallback)(gint vid_idx, OMVPMonitorHealth health,
+  gpointer user_data);
+
+extern OMVPMonitor omvp_monitor_open(OMVPVids *vids,
+  OMVPMonitorCallback callback, gpointer user_data);
+extern gint omvp_monitor_close(OMVPMonitor monitor);
+extern OMVPMonitorHealth omvp_monitor_get_health(OMVPMonitor monitor,
+  gint vid_idx);
+extern gint omvp_monitor_get_stats(OMVPMonitor monitor, gint vid_idx,
+  OMVPMonitorStats *stats);
+extern gint omvp_monitor_set_gop_cache(OMVPMonitor monitor, gint vid_idx,
+  gsize max_bytes);
+
+#endif /* _OMVP_MONITOR_H_ */
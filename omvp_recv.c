@@ -0,0 +1,991 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include <gio/gio.h>
+#include <gio/gnetworking.h>
+#ifdef G_OS_UNIX
+#include <sys/stat.h>
+#endif
+#include "config.h"
+#include "omvp_recv.h"
+#include "omvp_ts.h"
+
+/* larger datagrams are truncated, which is counted in the stats. */
+#define _OMVP_RECV_MAX_DATAGRAM 2048
+/* how long a group stays joined after its last receiver is closed. */
+#define _OMVP_RECV_LINGER 5000
+/* how often the kernel drop counts of the sockets are refreshed. */
+#define _OMVP_RECV_KERNEL_DROPS_INTERVAL 1000
+
+/*
+  One socket is opened per group and port, bound to the group so that the
+  kernel routes the datagrams of each group to its own socket. All sockets
+  are polled by a single thread, and a socket is shared by every receiver
+  of the same group and port. Receivers of one program of a multi-program
+  transport stream get copies holding only the packets of their program,
+  from a PAT/PMT parse shared by the socket.
+*/
+typedef struct _OMVPRecvSocket {
+  gchar *key;
+  GSocket *socket;
+  GInetAddress *group;
+  GSocketFamily family;
+  guint64 inode;
+  GSource *source;
+  GSource *linger_source;
+  GstBufferPool *pool;
+  guint pool_size;
+  gint buffer_size;
+  guint batch_size;
+  GInputMessage *msgs;
+  GInputVector *vecs;
+  GstBuffer **buffers;
+  GstMapInfo *maps;
+  GList *receivers;
+  guint num_caches;
+  OMVPTs ts;
+  OMVPRecvStats stats;
+} OMVPRecvSocket;
+
+typedef struct _OMVPRecvImpl {
+  OMVPRecvSocket *recv_socket;
+  gint program;
+  GstBufferPool *pool;
+  GstBuffer *filtered;
+  gboolean replay_pending;
+  GQueue cache;
+  gsize cache_bytes;
+  gsize cache_max_bytes;
+  GstBufferPool *cache_pool;
+  GList *cache_pat;
+  gboolean cache_has_keyframe;
+  OMVPRecvCallback callback;
+  gpointer callback_data;
+} OMVPRecvImpl;
+
+typedef struct _OMVPRecvShared {
+  GMutex lock;
+  GHashTable *sockets;
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GSource *kernel_drops_source;
+  guint8 scratch[_OMVP_RECV_MAX_DATAGRAM];
+} OMVPRecvShared;
+
+static OMVPRecvShared _omvp_recv_shared;
+
+static GInetAddress *_omvp_recv_resolve(const gchar *host);
+static gint _omvp_recv_set_buffer_size(OMVPRecvSocket *recv_socket,
+  gint buffer_size);
+static gint _omvp_recv_open_socket(OMVPRecvSocket *recv_socket,
+  const gchar *host, guint16 port, gint buffer_size);
+static GstBufferPool *_omvp_recv_new_pool(guint min_size, guint max_size);
+static GstBuffer *_omvp_recv_acquire(GstBufferPool *pool);
+static gint _omvp_recv_read_kernel_drops(const gchar *path,
+  GHashTable *drops);
+static gboolean _omvp_recv_on_kernel_drops(gpointer user_data);
+static OMVPRecvSocket *_omvp_recv_socket_new(const gchar *key,
+  const gchar *host, guint16 port, gint buffer_size, guint batch_size,
+  guint pool_size);
+static void _omvp_recv_socket_free(OMVPRecvSocket *recv_socket);
+static gint _omvp_recv_socket_grow(OMVPRecvSocket *recv_socket,
+  gint buffer_size, guint batch_size, guint pool_size);
+static gint _omvp_recv_get_ts_offset(const guint8 *data, gsize size);
+static GstBuffer *_omvp_recv_filter(OMVPRecvSocket *recv_socket,
+  OMVPRecvImpl *recv_impl, const guint8 *data, gsize size, gsize offset);
+static void _omvp_recv_cache_clear(OMVPRecvImpl *recv_impl);
+static void _omvp_recv_cache_add(OMVPRecvImpl *recv_impl, GstBuffer *buffer,
+  gsize offset);
+static void _omvp_recv_replay(OMVPRecvSocket *recv_socket,
+  OMVPRecvImpl *recv_impl);
+static gboolean _omvp_recv_on_socket(GSocket *socket, GIOCondition condition,
+  gpointer user_data);
+static gboolean _omvp_recv_on_linger(gpointer user_data);
+static gpointer _omvp_recv_thread(gpointer user_data);
+static OMVPRecvShared *_omvp_recv_get_shared(void);
+
+static GInetAddress *_omvp_recv_resolve(const gchar *host) {
+  GInetAddress *addr;
+  GResolver *resolver;
+  GList *addrs;
+  GError *error;
+
+  if (!host || !*host) {
+    return NULL;
+  }
+  addr = g_inet_address_new_from_string(host);
+  if (addr) {
+    return addr;
+  }
+
+  error = NULL;
+  resolver = g_resolver_get_default();
+  addrs = g_resolver_lookup_by_name(resolver, host, NULL, &error);
+  g_object_unref(resolver);
+  if (!addrs) {
+    g_warning("can't resolve %s: %s", host, error->message);
+    g_error_free(error);
+    return NULL;
+  }
+  addr = g_object_ref(addrs->data);
+  g_resolver_free_addresses(addrs);
+
+  return addr;
+}
+
+static gint _omvp_recv_set_buffer_size(OMVPRecvSocket *recv_socket,
+  gint buffer_size) {
+
+  recv_socket->buffer_size = buffer_size;
+  if (buffer_size > 0) {
+    g_socket_set_option(recv_socket->socket, SOL_SOCKET, SO_RCVBUF,
+      buffer_size, NULL);
+  }
+  g_socket_get_option(recv_socket->socket, SOL_SOCKET, SO_RCVBUF,
+    &recv_socket->stats.buffer_size, NULL);
+  if (recv_socket->stats.buffer_size < buffer_size) {
+    g_warning("socket receive buffer is %d bytes instead of %d, "
+      "raise net.core.rmem_max", recv_socket->stats.buffer_size, buffer_size);
+  }
+
+  return 0;
+}
+
+static gint _omvp_recv_open_socket(OMVPRecvSocket *recv_socket,
+  const gchar *host, guint16 port, gint buffer_size) {
+  GInetAddress *addr;
+  GInetAddress *bind_addr;
+  GSocketAddress *sock_addr;
+  GError *error;
+  gboolean multicast;
+
+  error = NULL;
+  addr = _omvp_recv_resolve(host);
+  if (host && *host && !addr) {
+    return -1;
+  }
+  recv_socket->family = addr ? g_inet_address_get_family(addr) :
+    G_SOCKET_FAMILY_IPV4;
+  multicast = addr && g_inet_address_get_is_multicast(addr);
+
+  recv_socket->socket = g_socket_new(recv_socket->family,
+    G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error);
+  if (!recv_socket->socket) {
+    g_warning("can't create socket: %s", error->message);
+    g_error_free(error);
+    g_clear_object(&addr);
+    return -1;
+  }
+  g_socket_set_blocking(recv_socket->socket, FALSE);
+  _omvp_recv_set_buffer_size(recv_socket, buffer_size);
+
+  /* binding to the group filters out other groups on the same port. */
+#ifdef G_OS_WIN32
+  bind_addr = g_inet_address_new_any(recv_socket->family);
+#else
+  bind_addr = addr ? g_object_ref(addr) :
+    g_inet_address_new_any(recv_socket->family);
+#endif
+  sock_addr = g_inet_socket_address_new(bind_addr, port);
+  g_object_unref(bind_addr);
+  if (!g_socket_bind(recv_socket->socket, sock_addr, TRUE, &error)) {
+    g_warning("can't bind to %s:%u: %s", host, port, error->message);
+    g_error_free(error);
+    g_object_unref(sock_addr);
+    g_clear_object(&addr);
+    return -1;
+  }
+  g_object_unref(sock_addr);
+
+  if (multicast) {
+    if (!g_socket_join_multicast_group(recv_socket->socket, addr, FALSE, NULL,
+      &error)) {
+      g_warning("can't join %s: %s", host, error->message);
+      g_error_free(error);
+      g_object_unref(addr);
+      return -1;
+    }
+    recv_socket->group = addr;
+  } else {
+    g_clear_object(&addr);
+  }
+
+#ifdef G_OS_UNIX
+  {
+    struct stat st;
+    if (fstat(g_socket_get_fd(recv_socket->socket), &st) == 0) {
+      recv_socket->inode = (guint64)st.st_ino;
+    }
+  }
+#endif
+
+  return 0;
+}
+
+/*
+  The kernel counts the datagrams dropped because the socket buffer was full
+  in the last column of /proc/net/udp, in the line of the socket inode. The
+  counts of all sockets in the file are added to drops, by inode.
+*/
+static gint _omvp_recv_read_kernel_drops(const gchar *path,
+  GHashTable *drops) {
+  gchar *contents;
+  gchar **lines;
+  gint i;
+
+  if (!g_file_get_contents(path, &contents, NULL, NULL)) {
+    return -1;
+  }
+
+  lines = g_strsplit(contents, "\n", -1);
+  g_free(contents);
+  for (i = 1; lines[i]; i++) {
+    gchar **fields;
+    gint num_fields;
+    gint j;
+    fields = g_strsplit_set(g_strstrip(lines[i]), " ", -1);
+    num_fields = 0;
+    for (j = 0; fields[j]; j++) {
+      if (*fields[j]) {
+        fields[num_fields++] = fields[j];
+      } else {
+        g_free(fields[j]);
+      }
+    }
+    fields[num_fields] = NULL;
+    if (num_fields >= 13) {
+      guint64 *inode;
+      inode = g_new(guint64, 1);
+      *inode = g_ascii_strtoull(fields[9], NULL, 10);
+      g_hash_table_insert(drops, inode,
+        GUINT_TO_POINTER((guint)g_ascii_strtoull(fields[12], NULL, 10)));
+    }
+    g_strfreev(fields);
+  }
+  g_strfreev(lines);
+
+  return 0;
+}
+
+/*
+  The kernel drop counts of all sockets are refreshed together once per
+  interval on the receive thread, from one read of each /proc file, so the
+  stats of a receiver are a plain copy.
+*/
+static gboolean _omvp_recv_on_kernel_drops(gpointer user_data) {
+  OMVPRecvSocket *recv_socket;
+  GHashTableIter iter;
+  GHashTable *drops;
+  gboolean has_ipv4;
+  gboolean has_ipv6;
+
+  (void)user_data;
+
+  has_ipv4 = FALSE;
+  has_ipv6 = FALSE;
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  g_hash_table_iter_init(&iter, _omvp_recv_shared.sockets);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&recv_socket)) {
+    if (recv_socket->family == G_SOCKET_FAMILY_IPV6) {
+      has_ipv6 = TRUE;
+    } else {
+      has_ipv4 = TRUE;
+    }
+  }
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+  if (!has_ipv4 && !has_ipv6) {
+    return G_SOURCE_CONTINUE;
+  }
+
+  drops = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+  if (has_ipv4) {
+    _omvp_recv_read_kernel_drops("/proc/net/udp", drops);
+  }
+  if (has_ipv6) {
+    _omvp_recv_read_kernel_drops("/proc/net/udp6", drops);
+  }
+
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  g_hash_table_iter_init(&iter, _omvp_recv_shared.sockets);
+  while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&recv_socket)) {
+    if (recv_socket->inode) {
+      recv_socket->stats.num_kernel_drops = GPOINTER_TO_UINT(
+        g_hash_table_lookup(drops, &recv_socket->inode));
+    }
+  }
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+  g_hash_table_destroy(drops);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* min_size buffers are allocated up front, up to max_size on demand. */
+static GstBufferPool *_omvp_recv_new_pool(guint min_size, guint max_size) {
+  GstBufferPool *pool;
+  GstStructure *config;
+
+  pool = gst_buffer_pool_new();
+  config = gst_buffer_pool_get_config(pool);
+  gst_buffer_pool_config_set_params(config, NULL, _OMVP_RECV_MAX_DATAGRAM,
+    min_size, max_size);
+  if (!gst_buffer_pool_set_config(pool, config) ||
+    !gst_buffer_pool_set_active(pool, TRUE)) {
+    g_warning("can't allocate %u packet buffers", min_size);
+    gst_object_unref(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+/* a buffer of the pool, or NULL right away when the pool is exhausted. */
+static GstBuffer *_omvp_recv_acquire(GstBufferPool *pool) {
+  GstBufferPoolAcquireParams params;
+  GstBuffer *buffer;
+
+  if (!pool) {
+    return NULL;
+  }
+  memset(&params, 0, sizeof(params));
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+  buffer = NULL;
+  if (gst_buffer_pool_acquire_buffer(pool, &buffer, &params) != GST_FLOW_OK) {
+    return NULL;
+  }
+
+  return buffer;
+}
+
+/*
+  Resolving the host may block, so this is called without the shared lock,
+  and the socket is only read once it is in the shared table.
+*/
+static OMVPRecvSocket *_omvp_recv_socket_new(const gchar *key,
+  const gchar *host, guint16 port, gint buffer_size, guint batch_size,
+  guint pool_size) {
+  OMVPRecvSocket *recv_socket;
+
+  recv_socket = g_malloc0(sizeof(OMVPRecvSocket));
+  recv_socket->key = g_strdup(key);
+  recv_socket->batch_size = MAX(batch_size, 1);
+  recv_socket->msgs = g_new0(GInputMessage, recv_socket->batch_size);
+  recv_socket->vecs = g_new0(GInputVector, recv_socket->batch_size);
+  recv_socket->buffers = g_new0(GstBuffer *, recv_socket->batch_size);
+  recv_socket->maps = g_new0(GstMapInfo, recv_socket->batch_size);
+
+  if (_omvp_recv_open_socket(recv_socket, host, port, buffer_size) != 0) {
+    _omvp_recv_socket_free(recv_socket);
+    return NULL;
+  }
+
+  recv_socket->pool = _omvp_recv_new_pool(pool_size, pool_size);
+  if (!recv_socket->pool) {
+    _omvp_recv_socket_free(recv_socket);
+    return NULL;
+  }
+  recv_socket->pool_size = pool_size;
+
+  g_debug("omvp_recv joined %s", key);
+
+  return recv_socket;
+}
+
+static void _omvp_recv_socket_free(OMVPRecvSocket *recv_socket) {
+  guint i;
+
+  if (recv_socket->source) {
+    g_source_destroy(recv_socket->source);
+    g_source_unref(recv_socket->source);
+  }
+  if (recv_socket->linger_source) {
+    g_source_destroy(recv_socket->linger_source);
+    g_source_unref(recv_socket->linger_source);
+  }
+  if (recv_socket->socket) {
+    if (recv_socket->group) {
+      g_socket_leave_multicast_group(recv_socket->socket, recv_socket->group,
+        FALSE, NULL, NULL);
+    }
+    g_socket_close(recv_socket->socket, NULL);
+    g_object_unref(recv_socket->socket);
+  }
+  g_clear_object(&recv_socket->group);
+  for (i = 0; i < recv_socket->batch_size; i++) {
+    if (recv_socket->buffers[i]) {
+      gst_buffer_unmap(recv_socket->buffers[i], &recv_socket->maps[i]);
+      gst_buffer_unref(recv_socket->buffers[i]);
+    }
+  }
+  /* buffers still downstream keep the pool alive until they return. */
+  if (recv_socket->pool) {
+    gst_buffer_pool_set_active(recv_socket->pool, FALSE);
+    gst_object_unref(recv_socket->pool);
+  }
+  omvp_ts_close(recv_socket->ts);
+  g_debug("omvp_recv left %s", recv_socket->key);
+  g_free(recv_socket->maps);
+  g_free(recv_socket->buffers);
+  g_free(recv_socket->vecs);
+  g_free(recv_socket->msgs);
+  g_free(recv_socket->key);
+  g_free(recv_socket);
+}
+
+/*
+  A socket opened by a light receiver, such as the health monitor, is grown
+  when a player joins it with larger settings. Packet buffers of the old
+  pool return to it and are freed with it.
+*/
+static gint _omvp_recv_socket_grow(OMVPRecvSocket *recv_socket,
+  gint buffer_size, guint batch_size, guint pool_size) {
+  GstBufferPool *pool;
+  guint i;
+
+  if (buffer_size > recv_socket->buffer_size) {
+    _omvp_recv_set_buffer_size(recv_socket, buffer_size);
+  }
+  if (pool_size > recv_socket->pool_size) {
+    pool = _omvp_recv_new_pool(pool_size, pool_size);
+    if (pool) {
+      for (i = 0; i < recv_socket->batch_size; i++) {
+        if (recv_socket->buffers[i]) {
+          gst_buffer_unmap(recv_socket->buffers[i], &recv_socket->maps[i]);
+          gst_buffer_unref(recv_socket->buffers[i]);
+          recv_socket->buffers[i] = NULL;
+        }
+      }
+      gst_buffer_pool_set_active(recv_socket->pool, FALSE);
+      gst_object_unref(recv_socket->pool);
+      recv_socket->pool = pool;
+      recv_socket->pool_size = pool_size;
+    }
+  }
+  if (batch_size > recv_socket->batch_size) {
+    recv_socket->msgs = g_renew(GInputMessage, recv_socket->msgs, batch_size);
+    recv_socket->vecs = g_renew(GInputVector, recv_socket->vecs, batch_size);
+    recv_socket->buffers = g_renew(GstBuffer *, recv_socket->buffers,
+      batch_size);
+    recv_socket->maps = g_renew(GstMapInfo, recv_socket->maps, batch_size);
+    for (i = recv_socket->batch_size; i < batch_size; i++) {
+      memset(&recv_socket->msgs[i], 0, sizeof(GInputMessage));
+      recv_socket->buffers[i] = NULL;
+    }
+    recv_socket->batch_size = batch_size;
+  }
+
+  return 0;
+}
+
+/* the offset of the TS packets in a raw or RTP datagram, or -1. */
+static gint _omvp_recv_get_ts_offset(const guint8 *data, gsize size) {
+  gsize offset;
+
+  if (size >= OMVP_TS_PACKET_SIZE && data[0] == 0x47) {
+    return 0;
+  }
+  if (size < 12 || (data[0] >> 6) != 2) {
+    return -1;
+  }
+  offset = 12 + (data[0] & 0x0f) * 4;
+  if ((data[0] & 0x10) && offset + 4 <= size) {
+    offset += 4 + ((data[offset + 2] << 8) | data[offset + 3]) * 4;
+  }
+  if (offset >= size || data[offset] != 0x47) {
+    return -1;
+  }
+
+  return (gint)offset;
+}
+
+/*
+  An RTP datagram keeps its header even when none of its packets belong to
+  the program, so the jitterbuffer doesn't wait for a missing sequence
+  number. A raw datagram without packets of the program is dropped. The
+  copies come from the pool of the receiver and are dropped like packets
+  when it is exhausted.
+*/
+static GstBuffer *_omvp_recv_filter(OMVPRecvSocket *recv_socket,
+  OMVPRecvImpl *recv_impl, const guint8 *data, gsize size, gsize offset) {
+  GstBuffer *buffer;
+  GstMapInfo map;
+  gsize len;
+
+  buffer = _omvp_recv_acquire(recv_impl->pool);
+  if (!buffer) {
+    recv_socket->stats.num_pool_drops++;
+    return NULL;
+  }
+  if (!gst_buffer_map(buffer, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref(buffer);
+    return NULL;
+  }
+  memcpy(map.data, data, offset);
+  len = omvp_ts_filter(recv_socket->ts, recv_impl->program, data + offset,
+    size - offset, map.data + offset);
+  gst_buffer_unmap(buffer, &map);
+  if (!len && !offset) {
+    gst_buffer_unref(buffer);
+    return NULL;
+  }
+  gst_buffer_resize(buffer, 0, offset + len);
+
+  return buffer;
+}
+
+static void _omvp_recv_cache_clear(OMVPRecvImpl *recv_impl) {
+  GstBuffer *buffer;
+
+  while ((buffer = g_queue_pop_head(&recv_impl->cache))) {
+    gst_buffer_unref(buffer);
+  }
+  recv_impl->cache_bytes = 0;
+  recv_impl->cache_pat = NULL;
+  recv_impl->cache_has_keyframe = FALSE;
+}
+
+/*
+  The cache holds the datagrams since the last PAT before the last keyframe,
+  so a demuxer fed from its start finds the PAT, the PMT and then a frame it
+  can decode. A GOP larger than the cache, or than its pool, empties it
+  until the next one.
+*/
+static void _omvp_recv_cache_add(OMVPRecvImpl *recv_impl, GstBuffer *buffer,
+  gsize offset) {
+  GstBuffer *copy;
+  GstMapInfo map;
+  gboolean has_pat;
+  gboolean is_keyframe;
+  gsize size;
+
+  /* a copy, so the packet buffer returns to the pool */
+  copy = _omvp_recv_acquire(recv_impl->cache_pool);
+  if (!copy) {
+    _omvp_recv_cache_clear(recv_impl);
+    return;
+  }
+  if (!gst_buffer_map(copy, &map, GST_MAP_WRITE)) {
+    gst_buffer_unref(copy);
+    return;
+  }
+  size = gst_buffer_extract(buffer, 0, map.data, map.size);
+  has_pat = omvp_ts_has_pid(map.data + offset, size - offset, 0);
+  is_keyframe = omvp_ts_has_keyframe(map.data + offset, size - offset);
+  gst_buffer_unmap(copy, &map);
+  gst_buffer_resize(copy, 0, size);
+  GST_BUFFER_FLAG_SET(copy, OMVP_RECV_BUFFER_FLAG_CACHED);
+
+  g_queue_push_tail(&recv_impl->cache, copy);
+  recv_impl->cache_bytes += gst_buffer_get_size(copy);
+  if (has_pat) {
+    recv_impl->cache_pat = recv_impl->cache.tail;
+  }
+  if (recv_impl->cache_pat &&
+    (is_keyframe || !recv_impl->cache_has_keyframe)) {
+    while (recv_impl->cache.head != recv_impl->cache_pat) {
+      copy = g_queue_pop_head(&recv_impl->cache);
+      recv_impl->cache_bytes -= gst_buffer_get_size(copy);
+      gst_buffer_unref(copy);
+    }
+    if (is_keyframe) {
+      recv_impl->cache_has_keyframe = TRUE;
+    }
+  }
+  if (recv_impl->cache_bytes > recv_impl->cache_max_bytes) {
+    _omvp_recv_cache_clear(recv_impl);
+  }
+}
+
+/*
+  A new receiver first gets the cached GOP of another receiver of the same
+  program, before its first live datagram, so a decoder can start without
+  waiting for the next keyframe.
+*/
+static void _omvp_recv_replay(OMVPRecvSocket *recv_socket,
+  OMVPRecvImpl *recv_impl) {
+  OMVPRecvImpl *cache_impl;
+  GList *l;
+
+  recv_impl->replay_pending = FALSE;
+  for (l = recv_socket->receivers; l; l = l->next) {
+    cache_impl = (OMVPRecvImpl *)l->data;
+    if (cache_impl != recv_impl && cache_impl->cache_has_keyframe &&
+      cache_impl->program == recv_impl->program) {
+      break;
+    }
+  }
+  if (!l) {
+    return;
+  }
+
+  /* shallow copies share the memory but not the timestamps */
+  for (l = cache_impl->cache.head; l; l = l->next) {
+    recv_impl->callback(gst_buffer_copy(l->data), recv_impl->callback_data);
+  }
+  g_debug("omvp_recv receiver(%p) replayed %u cached datagrams", recv_impl,
+    cache_impl->cache.length);
+}
+
+/*
+  Up to batch_size datagrams are read per wakeup with one
+  g_socket_receive_messages call (recvmmsg on Linux), straight into buffers
+  of the pre-allocated pool. When the pool is exhausted because downstream
+  is too slow, datagrams are read into a scratch buffer and dropped, so the
+  memory stays bounded and the socket buffer keeps draining. A lingering
+  socket without receivers is drained the same way.
+*/
+static gboolean _omvp_recv_on_socket(GSocket *socket, GIOCondition condition,
+  gpointer user_data) {
+  OMVPRecvSocket *recv_socket;
+  GstBufferPoolAcquireParams params;
+  GError *error;
+  GList *l;
+  guint i;
+  gint n;
+
+  (void)condition;
+
+  recv_socket = (OMVPRecvSocket *)user_data;
+
+  memset(&params, 0, sizeof(params));
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  for (i = 0; i < recv_socket->batch_size; i++) {
+    GstBuffer **buffer;
+    GstMapInfo *map;
+    buffer = &recv_socket->buffers[i];
+    map = &recv_socket->maps[i];
+    if (!*buffer && recv_socket->receivers &&
+      gst_buffer_pool_acquire_buffer(recv_socket->pool, buffer,
+      &params) == GST_FLOW_OK) {
+      if (!gst_buffer_map(*buffer, map, GST_MAP_WRITE)) {
+        gst_buffer_unref(*buffer);
+        *buffer = NULL;
+      }
+    }
+    if (*buffer) {
+      recv_socket->vecs[i].buffer = map->data;
+      recv_socket->vecs[i].size = map->size;
+    } else {
+      recv_socket->vecs[i].buffer = _omvp_recv_shared.scratch;
+      recv_socket->vecs[i].size = _OMVP_RECV_MAX_DATAGRAM;
+    }
+    recv_socket->msgs[i].vectors = &recv_socket->vecs[i];
+    recv_socket->msgs[i].num_vectors = 1;
+    recv_socket->msgs[i].bytes_received = 0;
+    recv_socket->msgs[i].flags = 0;
+  }
+
+  error = NULL;
+  n = g_socket_receive_messages(socket, recv_socket->msgs,
+    recv_socket->batch_size, 0, NULL, &error);
+  if (n < 0) {
+    if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
+      g_warning("can't receive from %s: %s", recv_socket->key,
+        error->message);
+    }
+    g_error_free(error);
+    g_mutex_unlock(&_omvp_recv_shared.lock);
+    return G_SOURCE_CONTINUE;
+  }
+
+  recv_socket->stats.num_batches++;
+  for (i = 0; i < (guint)n; i++) {
+    GstBuffer *buffer;
+    const guint8 *data;
+    gsize size;
+    gint offset;
+    recv_socket->stats.num_packets++;
+    recv_socket->stats.num_bytes += recv_socket->msgs[i].bytes_received;
+#ifdef MSG_TRUNC
+    if (recv_socket->msgs[i].flags & MSG_TRUNC) {
+      recv_socket->stats.num_truncated++;
+    }
+#endif
+    buffer = recv_socket->buffers[i];
+    if (!buffer) {
+      if (recv_socket->receivers) {
+        recv_socket->stats.num_pool_drops++;
+      }
+      continue;
+    }
+    recv_socket->buffers[i] = NULL;
+    data = recv_socket->maps[i].data;
+    size = recv_socket->msgs[i].bytes_received;
+    offset = -1;
+    if (recv_socket->ts || recv_socket->num_caches) {
+      offset = _omvp_recv_get_ts_offset(data, size);
+      if (offset >= 0 && recv_socket->ts) {
+        omvp_ts_parse(recv_socket->ts, data + offset, size - offset);
+      }
+    }
+    for (l = recv_socket->receivers; l; l = l->next) {
+      OMVPRecvImpl *recv_impl;
+      recv_impl = (OMVPRecvImpl *)l->data;
+      if (recv_impl->replay_pending) {
+        _omvp_recv_replay(recv_socket, recv_impl);
+      }
+      if (recv_impl->program && offset >= 0) {
+        recv_impl->filtered = _omvp_recv_filter(recv_socket, recv_impl,
+          data, size, offset);
+      }
+    }
+    gst_buffer_unmap(buffer, &recv_socket->maps[i]);
+    gst_buffer_resize(buffer, 0, size);
+    for (l = recv_socket->receivers; l; l = l->next) {
+      OMVPRecvImpl *recv_impl;
+      GstBuffer *out;
+      recv_impl = (OMVPRecvImpl *)l->data;
+      if (recv_impl->program && offset >= 0) {
+        out = recv_impl->filtered;
+        recv_impl->filtered = NULL;
+      } else {
+        out = gst_buffer_ref(buffer);
+      }
+      if (out && recv_impl->cache_max_bytes && offset >= 0) {
+        _omvp_recv_cache_add(recv_impl, out, offset);
+      }
+      if (out) {
+        recv_impl->callback(out, recv_impl->callback_data);
+      }
+    }
+    gst_buffer_unref(buffer);
+  }
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean _omvp_recv_on_linger(gpointer user_data) {
+  OMVPRecvSocket *recv_socket;
+
+  recv_socket = (OMVPRecvSocket *)user_data;
+
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  if (recv_socket->linger_source != g_main_current_source()) {
+    /* reopened while this was being dispatched. */
+    g_mutex_unlock(&_omvp_recv_shared.lock);
+    return G_SOURCE_REMOVE;
+  }
+  g_source_unref(recv_socket->linger_source);
+  recv_socket->linger_source = NULL;
+  if (!recv_socket->receivers) {
+    g_hash_table_remove(_omvp_recv_shared.sockets, recv_socket->key);
+    _omvp_recv_socket_free(recv_socket);
+  }
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gpointer _omvp_recv_thread(gpointer user_data) {
+  OMVPRecvShared *shared;
+
+  shared = (OMVPRecvShared *)user_data;
+  g_main_context_push_thread_default(shared->context);
+  g_main_loop_run(shared->loop);
+  g_main_context_pop_thread_default(shared->context);
+
+  return NULL;
+}
+
+/* the receive thread lives as long as the process. */
+static OMVPRecvShared *_omvp_recv_get_shared(void) {
+  static gsize initialized;
+
+  if (g_once_init_enter(&initialized)) {
+    g_mutex_init(&_omvp_recv_shared.lock);
+    _omvp_recv_shared.sockets = g_hash_table_new(g_str_hash, g_str_equal);
+    _omvp_recv_shared.context = g_main_context_new();
+    _omvp_recv_shared.loop = g_main_loop_new(_omvp_recv_shared.context,
+      FALSE);
+    _omvp_recv_shared.kernel_drops_source =
+      g_timeout_source_new(_OMVP_RECV_KERNEL_DROPS_INTERVAL);
+    g_source_set_callback(_omvp_recv_shared.kernel_drops_source,
+      _omvp_recv_on_kernel_drops, NULL, NULL);
+    g_source_attach(_omvp_recv_shared.kernel_drops_source,
+      _omvp_recv_shared.context);
+    _omvp_recv_shared.thread = g_thread_new("omvp_recv", _omvp_recv_thread,
+      &_omvp_recv_shared);
+    g_once_init_leave(&initialized, 1);
+  }
+
+  return &_omvp_recv_shared;
+}
+
+OMVPRecv omvp_recv_open(const gchar *host, guint16 port, gint program,
+  gint buffer_size, guint batch_size, guint pool_size,
+  OMVPRecvCallback callback, gpointer user_data) {
+  OMVPRecvShared *shared;
+  OMVPRecvSocket *recv_socket;
+  OMVPRecvSocket *new_socket;
+  OMVPRecvImpl *recv_impl;
+  gchar *key;
+
+  shared = _omvp_recv_get_shared();
+  key = g_strdup_printf("%s:%u", host ? host : "", port);
+
+  new_socket = NULL;
+  g_mutex_lock(&shared->lock);
+  recv_socket = g_hash_table_lookup(shared->sockets, key);
+  if (!recv_socket) {
+    g_mutex_unlock(&shared->lock);
+    new_socket = _omvp_recv_socket_new(key, host, port, buffer_size,
+      batch_size, pool_size);
+    if (!new_socket) {
+      g_free(key);
+      return NULL;
+    }
+    g_mutex_lock(&shared->lock);
+    /* another receiver may have opened the same group meanwhile. */
+    recv_socket = g_hash_table_lookup(shared->sockets, key);
+  }
+  if (!recv_socket) {
+    recv_socket = new_socket;
+    new_socket = NULL;
+    recv_socket->source = g_socket_create_source(recv_socket->socket,
+      G_IO_IN, NULL);
+    g_source_set_callback(recv_socket->source,
+      (GSourceFunc)_omvp_recv_on_socket, recv_socket, NULL);
+    g_source_attach(recv_socket->source, shared->context);
+    g_hash_table_insert(shared->sockets, recv_socket->key, recv_socket);
+  } else {
+    _omvp_recv_socket_grow(recv_socket, buffer_size, batch_size, pool_size);
+  }
+  if (recv_socket->linger_source) {
+    g_source_destroy(recv_socket->linger_source);
+    g_source_unref(recv_socket->linger_source);
+    recv_socket->linger_source = NULL;
+  }
+  if (program && !recv_socket->ts) {
+    recv_socket->ts = omvp_ts_open();
+  }
+  recv_impl = g_malloc0(sizeof(OMVPRecvImpl));
+  recv_impl->recv_socket = recv_socket;
+  recv_impl->program = program;
+  if (program) {
+    recv_impl->pool = _omvp_recv_new_pool(0, MAX(pool_size, 1));
+  }
+  recv_impl->callback = callback;
+  recv_impl->callback_data = user_data;
+  recv_impl->replay_pending = TRUE;
+  g_queue_init(&recv_impl->cache);
+  recv_socket->receivers = g_list_append(recv_socket->receivers, recv_impl);
+  g_mutex_unlock(&shared->lock);
+  if (new_socket) {
+    _omvp_recv_socket_free(new_socket);
+  }
+  g_free(key);
+
+  g_debug("omvp_recv_open receiver(%p) %s:%u program %d", recv_impl, host,
+    port, program);
+
+  return recv_impl;
+}
+
+gint omvp_recv_close(OMVPRecv receiver) {
+  OMVPRecvImpl *recv_impl;
+  OMVPRecvSocket *recv_socket;
+
+  recv_impl = (OMVPRecvImpl *)receiver;
+  if (recv_impl) {
+    g_mutex_lock(&_omvp_recv_shared.lock);
+    recv_socket = recv_impl->recv_socket;
+    recv_socket->receivers = g_list_remove(recv_socket->receivers,
+      recv_impl);
+    if (recv_impl->cache_max_bytes) {
+      recv_socket->num_caches--;
+      _omvp_recv_cache_clear(recv_impl);
+    }
+    if (!recv_socket->receivers) {
+      /* an immediate rescan finds the group still joined. */
+      recv_socket->linger_source = g_timeout_source_new(_OMVP_RECV_LINGER);
+      g_source_set_callback(recv_socket->linger_source, _omvp_recv_on_linger,
+        recv_socket, NULL);
+      g_source_attach(recv_socket->linger_source, _omvp_recv_shared.context);
+    }
+    g_mutex_unlock(&_omvp_recv_shared.lock);
+    /* copies still downstream keep the pools alive until they return. */
+    if (recv_impl->pool) {
+      gst_buffer_pool_set_active(recv_impl->pool, FALSE);
+      gst_object_unref(recv_impl->pool);
+    }
+    if (recv_impl->cache_pool) {
+      gst_buffer_pool_set_active(recv_impl->cache_pool, FALSE);
+      gst_object_unref(recv_impl->cache_pool);
+    }
+    g_free(recv_impl);
+  }
+
+  g_debug("omvp_recv_close receiver(%p)", receiver);
+
+  return 0;
+}
+
+gint omvp_recv_get_stats(OMVPRecv receiver, OMVPRecvStats *stats) {
+  OMVPRecvImpl *recv_impl;
+
+  recv_impl = (OMVPRecvImpl *)receiver;
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  *stats = recv_impl->recv_socket->stats;
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+
+  return 0;
+}
+
+/*
+  Keeps the last GOP of the receiver's MPEG-TS stream, up to max_bytes, for
+  the receivers opened after it. 0 drops the cache. The copies come from a
+  pool of max_bytes of datagram buffers, allocated as the cache fills.
+*/
+gint omvp_recv_set_cache_size(OMVPRecv receiver, gsize max_bytes) {
+  OMVPRecvImpl *recv_impl;
+
+  recv_impl = (OMVPRecvImpl *)receiver;
+  g_mutex_lock(&_omvp_recv_shared.lock);
+  if (max_bytes == recv_impl->cache_max_bytes) {
+    g_mutex_unlock(&_omvp_recv_shared.lock);
+    return 0;
+  }
+  _omvp_recv_cache_clear(recv_impl);
+  if (recv_impl->cache_pool) {
+    gst_buffer_pool_set_active(recv_impl->cache_pool, FALSE);
+    gst_object_unref(recv_impl->cache_pool);
+    recv_impl->cache_pool = NULL;
+  }
+  if (max_bytes) {
+    recv_impl->cache_pool = _omvp_recv_new_pool(0,
+      MAX(max_bytes / _OMVP_RECV_MAX_DATAGRAM, 1));
+    if (!recv_impl->cache_pool) {
+      max_bytes = 0;
+    }
+  }
+  if (!recv_impl->cache_max_bytes && max_bytes) {
+    recv_impl->recv_socket->num_caches++;
+  } else if (recv_impl->cache_max_bytes && !max_bytes) {
+    recv_impl->recv_socket->num_caches--;
+  }
+  recv_impl->cache_max_bytes = max_bytes;
+  g_mutex_unlock(&_omvp_recv_shared.lock);
+
+  return 0;
+}
@@ -0,0 +1,52 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_RECV_H_
+#define _OMVP_RECV_H_
+
+#include <gst/gst.h>
+
+typedef void *OMVPRecv;
+
+/* set on the buffers a new receiver gets from the cache of another one. */
+#define OMVP_RECV_BUFFER_FLAG_CACHED GST_BUFFER_FLAG_LAST
+
+/* called from the receive thread, takes the ownership of the buffer. */
+typedef void (*OMVPRecvCallback)(GstBuffer *buffer, gpointer user_data);
+
+typedef struct _OMVPRecvStats {
+  guint64 num_packets;
+  guint64 num_bytes;
+  guint64 num_batches;
+  guint64 num_truncated;
+  guint64 num_pool_drops;
+  guint64 num_kernel_drops;
+  gint buffer_size;
+} OMVPRecvStats;
+
+/* a program other than 0 selects one program of an MPEG-TS stream. */
+extern OMVPRecv omvp_recv_open(const gchar *host, guint16 port, gint program,
+  gint buffer_size, guint batch_size, guint pool_size,
+  OMVPRecvCallback callback, gpointer user_data);
+extern gint omvp_recv_close(OMVPRecv receiver);
+extern gint omvp_recv_get_stats(OMVPRecv receiver, OMVPRecvStats *stats);
+extern gint omvp_recv_set_cache_size(OMVPRecv receiver, gsize max_bytes);
+
+#endif /* _OMVP_RECV_H_ */
@@ -0,0 +1,198 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gio/gio.h>
+#include <gst/gst.h>
+#include "omvp_recv.h"
+
+#define _OMVP_RECV_TEST_GROUP "239.255.42.42"
+#define _OMVP_RECV_TEST_NUM_PACKETS 100000
+/* 7 MPEG-TS packets, the usual payload of a multicast channel. */
+#define _OMVP_RECV_TEST_PACKET_SIZE (7 * 188)
+#define _OMVP_RECV_TEST_BUFFER_SIZE (2 * 1024 * 1024)
+#define _OMVP_RECV_TEST_BATCH_SIZE 32
+#define _OMVP_RECV_TEST_POOL_SIZE 1024
+#define _OMVP_RECV_TEST_PROBE_TIMEOUT 1000
+/* the kernel drops are read once per second by the receiver. */
+#define _OMVP_RECV_TEST_SETTLE 1200
+/* exit status that makes "make check" report the test as skipped. */
+#define _OMVP_RECV_TEST_SKIP 77
+
+static guint16 _omvp_recv_test_port;
+static GSocket *_omvp_recv_test_socket;
+static GSocketAddress *_omvp_recv_test_addr;
+static guint8 _omvp_recv_test_packet[_OMVP_RECV_TEST_PACKET_SIZE];
+static gint _omvp_recv_test_num_packets;
+
+static void _omvp_recv_test_on_buffer(GstBuffer *buffer, gpointer user_data);
+static gboolean _omvp_recv_test_send(void);
+static gint _omvp_recv_test_wait_idle(void);
+static gboolean _omvp_recv_test_probe(void);
+static void _omvp_recv_test_bench(void);
+
+static void _omvp_recv_test_on_buffer(GstBuffer *buffer, gpointer user_data) {
+  (void)user_data;
+
+  g_atomic_int_inc(&_omvp_recv_test_num_packets);
+  gst_buffer_unref(buffer);
+}
+
+static gboolean _omvp_recv_test_send(void) {
+  gssize n;
+
+  n = g_socket_send_to(_omvp_recv_test_socket, _omvp_recv_test_addr,
+    (const gchar *)_omvp_recv_test_packet, sizeof(_omvp_recv_test_packet),
+    NULL, NULL);
+
+  return n == (gssize)sizeof(_omvp_recv_test_packet);
+}
+
+/* returns once no datagram arrived for a while. */
+static gint _omvp_recv_test_wait_idle(void) {
+  gint num_packets;
+
+  do {
+    num_packets = g_atomic_int_get(&_omvp_recv_test_num_packets);
+    g_usleep(100 * 1000);
+  } while (num_packets != g_atomic_int_get(&_omvp_recv_test_num_packets));
+
+  return 0;
+}
+
+/* hosts without a multicast route or with loopback disabled are skipped. */
+static gboolean _omvp_recv_test_probe(void) {
+  OMVPRecv receiver;
+  GInetAddress *group;
+  gint64 deadline;
+  gboolean ok;
+  gint i;
+
+  _omvp_recv_test_port = (guint16)g_random_int_range(20000, 30000);
+  receiver = omvp_recv_open(_OMVP_RECV_TEST_GROUP, _omvp_recv_test_port, 0,
+    _OMVP_RECV_TEST_BUFFER_SIZE, _OMVP_RECV_TEST_BATCH_SIZE,
+    _OMVP_RECV_TEST_POOL_SIZE, _omvp_recv_test_on_buffer, NULL);
+  if (!receiver) {
+    return FALSE;
+  }
+
+  _omvp_recv_test_socket = g_socket_new(G_SOCKET_FAMILY_IPV4,
+    G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, NULL);
+  g_assert(_omvp_recv_test_socket);
+  g_socket_set_multicast_loopback(_omvp_recv_test_socket, TRUE);
+  g_socket_set_multicast_ttl(_omvp_recv_test_socket, 0);
+  group = g_inet_address_new_from_string(_OMVP_RECV_TEST_GROUP);
+  _omvp_recv_test_addr = g_inet_socket_address_new(group,
+    _omvp_recv_test_port);
+  g_object_unref(group);
+
+  for (i = 0; i < _OMVP_RECV_TEST_PACKET_SIZE; i += 188) {
+    _omvp_recv_test_packet[i] = 0x47;
+    _omvp_recv_test_packet[i + 1] = 0x01;
+    _omvp_recv_test_packet[i + 3] = 0x10;
+  }
+
+  deadline = g_get_monotonic_time() + _OMVP_RECV_TEST_PROBE_TIMEOUT * 1000;
+  ok = FALSE;
+  while (!ok && g_get_monotonic_time() < deadline) {
+    if (!_omvp_recv_test_send()) {
+      break;
+    }
+    g_usleep(10 * 1000);
+    ok = g_atomic_int_get(&_omvp_recv_test_num_packets) > 0;
+  }
+  _omvp_recv_test_wait_idle();
+  omvp_recv_close(receiver);
+
+  return ok;
+}
+
+/*
+  Sends the datagrams as fast as the sender can and reports how many made it
+  through the receiver and where the others were dropped. The stats of the
+  socket include the probe, so only the difference is reported.
+*/
+static void _omvp_recv_test_bench(void) {
+  OMVPRecvStats start;
+  OMVPRecvStats stats;
+  OMVPRecv receiver;
+  gdouble elapsed;
+  gint num_sent;
+  gint num_packets;
+  gint i;
+
+  receiver = omvp_recv_open(_OMVP_RECV_TEST_GROUP, _omvp_recv_test_port, 0,
+    _OMVP_RECV_TEST_BUFFER_SIZE, _OMVP_RECV_TEST_BATCH_SIZE,
+    _OMVP_RECV_TEST_POOL_SIZE, _omvp_recv_test_on_buffer, NULL);
+  g_assert(receiver);
+  omvp_recv_get_stats(receiver, &start);
+  g_atomic_int_set(&_omvp_recv_test_num_packets, 0);
+
+  g_test_timer_start();
+  num_sent = 0;
+  for (i = 0; i < _OMVP_RECV_TEST_NUM_PACKETS; i++) {
+    if (_omvp_recv_test_send()) {
+      num_sent++;
+    }
+  }
+  elapsed = g_test_timer_elapsed();
+  _omvp_recv_test_wait_idle();
+  g_usleep(_OMVP_RECV_TEST_SETTLE * 1000);
+
+  num_packets = g_atomic_int_get(&_omvp_recv_test_num_packets);
+  omvp_recv_get_stats(receiver, &stats);
+  stats.num_packets -= start.num_packets;
+  stats.num_batches -= start.num_batches;
+  stats.num_truncated -= start.num_truncated;
+  stats.num_pool_drops -= start.num_pool_drops;
+  stats.num_kernel_drops -= start.num_kernel_drops;
+  omvp_recv_close(receiver);
+
+  g_test_message("sent %d in %.1f ms (%.0f packets/s), received %d",
+    num_sent, elapsed * 1000.0, num_sent / elapsed, num_packets);
+  g_test_message("%.1f packets per batch, pool drops %" G_GUINT64_FORMAT
+    ", kernel drops %" G_GUINT64_FORMAT ", buffer size %d",
+    stats.num_batches ? (gdouble)stats.num_packets / stats.num_batches : 0.0,
+    stats.num_pool_drops, stats.num_kernel_drops, stats.buffer_size);
+
+  g_assert_cmpint(num_packets, >, 0);
+  g_assert_cmpuint(stats.num_packets, ==,
+    (guint64)num_packets + stats.num_pool_drops);
+  g_assert_cmpuint(stats.num_truncated, ==, 0);
+}
+
+int main(int argc, char *argv[]) {
+  gint ret;
+
+  gst_init(&argc, &argv);
+  g_test_init(&argc, &argv, NULL);
+
+  if (!_omvp_recv_test_probe()) {
+    g_printerr("multicast loopback is not available, skipped\n");
+    return _OMVP_RECV_TEST_SKIP;
+  }
+
+  g_test_add_func("/recv/bench", _omvp_recv_test_bench);
+  ret = g_test_run();
+
+  g_object_unref(_omvp_recv_test_addr);
+  g_object_unref(_omvp_recv_test_socket);
+
+  return ret;
+}
@@ -0,0 +1,297 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "omvp_search.h"
+
+/*
+  Every vid is indexed by its lowercased "id\nname" text.
+
+  Prefix lookups binary search a sorted array of all ids and names, so the
+  shortest matching key wins, e.g. "74" finds id "74" before "740".
+
+  Substring lookups use a trigram index: the sorted distinct trigrams, and
+  for each of them the sorted list of vids containing it. The candidates of
+  the rarest trigram of the query are checked with strstr().
+*/
+
+typedef struct _OMVPSearchKey {
+  const gchar *key;
+  gint vid_idx;
+} OMVPSearchKey;
+
+typedef struct _OMVPSearchImpl {
+  gint num_vids;
+  gchar *texts;
+  gint *text_offsets;
+  OMVPSearchKey *keys;
+  gint num_keys;
+  guint32 *trigrams;
+  gint *trigram_offsets;
+  gint num_trigrams;
+  gint *postings;
+} OMVPSearchImpl;
+
+static gint _omvp_search_compare_keys(const void *a, const void *b);
+static gint _omvp_search_compare_pairs(const void *a, const void *b);
+static guint32 _omvp_search_trigram(const gchar *str);
+static gint _omvp_search_build_trigrams(OMVPSearchImpl *search_impl);
+static gint _omvp_search_find_prefix(OMVPSearchImpl *search_impl,
+  const gchar *query, gsize len);
+static gint _omvp_search_find_substring(OMVPSearchImpl *search_impl,
+  const gchar *query, gsize len);
+
+static gint _omvp_search_compare_keys(const void *a, const void *b) {
+  const OMVPSearchKey *key_a;
+  const OMVPSearchKey *key_b;
+  gint ret;
+
+  key_a = (const OMVPSearchKey *)a;
+  key_b = (const OMVPSearchKey *)b;
+  ret = strcmp(key_a->key, key_b->key);
+  if (ret == 0) {
+    ret = key_a->vid_idx - key_b->vid_idx;
+  }
+
+  return ret;
+}
+
+static gint _omvp_search_compare_pairs(const void *a, const void *b) {
+  guint64 pair_a;
+  guint64 pair_b;
+
+  pair_a = *(const guint64 *)a;
+  pair_b = *(const guint64 *)b;
+
+  return pair_a < pair_b ? -1 : (pair_a > pair_b ? 1 : 0);
+}
+
+static guint32 _omvp_search_trigram(const gchar *str) {
+  return ((guint32)(guchar)str[0] << 16) | ((guint32)(guchar)str[1] << 8) |
+    (guint32)(guchar)str[2];
+}
+
+static gint _omvp_search_build_trigrams(OMVPSearchImpl *search_impl) {
+  GArray *pairs;
+  guint64 pair;
+  guint64 *p;
+  const gchar *text;
+  guint32 trigram;
+  gint num_postings;
+  gint vid_idx;
+  guint i;
+
+  pairs = g_array_new(FALSE, FALSE, sizeof(guint64));
+  for (vid_idx = 0; vid_idx < search_impl->num_vids; vid_idx++) {
+    text = search_impl->texts + search_impl->text_offsets[vid_idx];
+    for (; text[0] && text[1] && text[2]; text++) {
+      if (text[0] == '\n' || text[1] == '\n' || text[2] == '\n') {
+        continue;
+      }
+      pair = ((guint64)_omvp_search_trigram(text) << 32) | (guint32)vid_idx;
+      g_array_append_val(pairs, pair);
+    }
+  }
+  qsort(pairs->data, pairs->len, sizeof(guint64),
+    _omvp_search_compare_pairs);
+
+  search_impl->trigrams = g_malloc(sizeof(guint32) * (pairs->len + 1));
+  search_impl->trigram_offsets = g_malloc(sizeof(gint) * (pairs->len + 1));
+  search_impl->postings = g_malloc(sizeof(gint) * (pairs->len + 1));
+  search_impl->num_trigrams = 0;
+  num_postings = 0;
+  p = (guint64 *)pairs->data;
+  for (i = 0; i < pairs->len; i++) {
+    if (i > 0 && p[i] == p[i - 1]) {
+      continue;
+    }
+    trigram = (guint32)(p[i] >> 32);
+    if (search_impl->num_trigrams == 0 ||
+      search_impl->trigrams[search_impl->num_trigrams - 1] != trigram) {
+      search_impl->trigrams[search_impl->num_trigrams] = trigram;
+      search_impl->trigram_offsets[search_impl->num_trigrams] = num_postings;
+      search_impl->num_trigrams++;
+    }
+    search_impl->postings[num_postings++] = (gint)(guint32)p[i];
+  }
+  search_impl->trigram_offsets[search_impl->num_trigrams] = num_postings;
+  g_array_free(pairs, TRUE);
+
+  return 0;
+}
+
+/* returns the vid of the smallest key starting with query, or -1. */
+static gint _omvp_search_find_prefix(OMVPSearchImpl *search_impl,
+  const gchar *query, gsize len) {
+  gint lo, hi, mid;
+
+  lo = 0;
+  hi = search_impl->num_keys;
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (strcmp(search_impl->keys[mid].key, query) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < search_impl->num_keys &&
+    strncmp(search_impl->keys[lo].key, query, len) == 0) {
+    return search_impl->keys[lo].vid_idx;
+  }
+
+  return -1;
+}
+
+/* returns the first vid whose text contains query, or -1. */
+static gint _omvp_search_find_substring(OMVPSearchImpl *search_impl,
+  const gchar *query, gsize len) {
+  gint best_start, best_end;
+  gint lo, hi, mid;
+  guint32 trigram;
+  gint i;
+  gsize j;
+
+  if (len < 3) {
+    return -1;
+  }
+
+  best_start = 0;
+  best_end = -1;
+  for (j = 0; j + 3 <= len; j++) {
+    trigram = _omvp_search_trigram(query + j);
+    lo = 0;
+    hi = search_impl->num_trigrams;
+    while (lo < hi) {
+      mid = lo + (hi - lo) / 2;
+      if (search_impl->trigrams[mid] < trigram) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == search_impl->num_trigrams ||
+      search_impl->trigrams[lo] != trigram) {
+      return -1;
+    }
+    if (best_end < 0 || search_impl->trigram_offsets[lo + 1] -
+      search_impl->trigram_offsets[lo] < best_end - best_start) {
+      best_start = search_impl->trigram_offsets[lo];
+      best_end = search_impl->trigram_offsets[lo + 1];
+    }
+  }
+
+  for (i = best_start; i < best_end; i++) {
+    if (strstr(search_impl->texts +
+      search_impl->text_offsets[search_impl->postings[i]], query)) {
+      return search_impl->postings[i];
+    }
+  }
+
+  return -1;
+}
+
+OMVPSearch omvp_search_open(OMVPVids *vids) {
+  OMVPSearchImpl *search_impl;
+  GString *texts;
+  gchar *text;
+  gint vid_idx;
+
+  search_impl = g_malloc0(sizeof(OMVPSearchImpl));
+  search_impl->num_vids = vids->num_vids;
+
+  texts = g_string_new(NULL);
+  search_impl->text_offsets = g_malloc(sizeof(gint) * vids->num_vids);
+  for (vid_idx = 0; vid_idx < vids->num_vids; vid_idx++) {
+    search_impl->text_offsets[vid_idx] = texts->len;
+    g_string_append(texts, vids->ids[vid_idx]);
+    g_string_append_c(texts, '\n');
+    g_string_append(texts, vids->names[vid_idx]);
+    g_string_append_c(texts, '\0');
+  }
+  search_impl->texts = g_string_free(texts, FALSE);
+  for (vid_idx = 0; vid_idx < vids->num_vids; vid_idx++) {
+    for (text = search_impl->texts + search_impl->text_offsets[vid_idx];
+      *text; text++) {
+      *text = g_ascii_tolower(*text);
+    }
+  }
+
+  search_impl->num_keys = vids->num_vids * 2;
+  search_impl->keys = g_malloc(sizeof(OMVPSearchKey) * search_impl->num_keys);
+  for (vid_idx = 0; vid_idx < vids->num_vids; vid_idx++) {
+    text = search_impl->texts + search_impl->text_offsets[vid_idx];
+    search_impl->keys[vid_idx * 2].key = text;
+    search_impl->keys[vid_idx * 2].vid_idx = vid_idx;
+    search_impl->keys[vid_idx * 2 + 1].key = strchr(text, '\n') + 1;
+    search_impl->keys[vid_idx * 2 + 1].vid_idx = vid_idx;
+  }
+  qsort(search_impl->keys, search_impl->num_keys, sizeof(OMVPSearchKey),
+    _omvp_search_compare_keys);
+
+  _omvp_search_build_trigrams(search_impl);
+
+  return (OMVPSearch)search_impl;
+}
+
+gint omvp_search_close(OMVPSearch search) {
+  OMVPSearchImpl *search_impl;
+
+  search_impl = (OMVPSearchImpl *)search;
+  if (search_impl) {
+    g_free(search_impl->texts);
+    g_free(search_impl->text_offsets);
+    g_free(search_impl->keys);
+    g_free(search_impl->trigrams);
+    g_free(search_impl->trigram_offsets);
+    g_free(search_impl->postings);
+    g_free(search_impl);
+  }
+
+  return 0;
+}
+
+/*
+  Returns the vid matching query, preferring an id or name that starts with
+  it over one that only contains it, or -1 if nothing matches.
+*/
+gint omvp_search_find(OMVPSearch search, const gchar *query) {
+  OMVPSearchImpl *search_impl;
+  gchar *lower_query;
+  gsize len;
+  gint vid_idx;
+
+  g_assert(search);
+  search_impl = (OMVPSearchImpl *)search;
+
+  len = strlen(query);
+  if (len == 0) {
+    return -1;
+  }
+  lower_query = g_ascii_strdown(query, len);
+  vid_idx = _omvp_search_find_prefix(search_impl, lower_query, len);
+  if (vid_idx < 0) {
+    vid_idx = _omvp_search_find_substring(search_impl, lower_query, len);
+  }
+  g_free(lower_query);
+
+  return vid_idx;
+}
@@ -0,0 +1,33 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_SEARCH_H_
+#define _OMVP_SEARCH_H_
+
+#include <glib.h>
+#include "omvp_vids.h"
+
+typedef void *OMVPSearch;
+
+extern OMVPSearch omvp_search_open(OMVPVids *vids);
+extern gint omvp_search_close(OMVPSearch search);
+extern gint omvp_search_find(OMVPSearch search, const gchar *query);
+
+#endif /* _OMVP_SEARCH_H_ */
@@ -0,0 +1,222 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "omvp_test_util.h"
+#include "omvp_ts.h"
+
+/* in seconds, for anything a test waits for. */
+#define _OMVP_TEST_UTIL_TIMEOUT 5
+
+/* the server runs in its own thread, so a blocking client still gets served. */
+typedef struct _OMVPTestUtilServerImpl {
+  SoupServer *server;
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  gchar *base_uri;
+} OMVPTestUtilServerImpl;
+
+static gpointer _omvp_test_util_server_thread(gpointer data);
+static gboolean _omvp_test_util_on_tick(gpointer user_data);
+
+static gpointer _omvp_test_util_server_thread(gpointer data) {
+  OMVPTestUtilServerImpl *server_impl;
+
+  server_impl = (OMVPTestUtilServerImpl *)data;
+  g_main_context_push_thread_default(server_impl->context);
+  g_main_loop_run(server_impl->loop);
+  g_main_context_pop_thread_default(server_impl->context);
+
+  return NULL;
+}
+
+/* wakes up omvp_test_util_wait(), which blocks in the main context. */
+static gboolean _omvp_test_util_on_tick(gpointer user_data) {
+  (void)user_data;
+
+  return TRUE;
+}
+
+/*
+  Listens on a local port and calls callback for every request, in the
+  server thread. The listening socket is attached to the server context
+  here, and the server thread only runs that context.
+*/
+OMVPTestUtilServer omvp_test_util_server_open(SoupServerCallback callback,
+  gpointer user_data) {
+  OMVPTestUtilServerImpl *server_impl;
+  GError *error = NULL;
+  GSList *uris;
+  gboolean ok;
+
+  server_impl = g_malloc0(sizeof(OMVPTestUtilServerImpl));
+  server_impl->context = g_main_context_new();
+  server_impl->loop = g_main_loop_new(server_impl->context, FALSE);
+
+  g_main_context_push_thread_default(server_impl->context);
+  server_impl->server = soup_server_new(NULL, NULL);
+  soup_server_add_handler(server_impl->server, NULL, callback, user_data,
+    NULL);
+  ok = soup_server_listen_local(server_impl->server, 0,
+    SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+  g_main_context_pop_thread_default(server_impl->context);
+  g_assert_no_error(error);
+  g_assert(ok);
+
+  uris = soup_server_get_uris(server_impl->server);
+  g_assert(uris);
+  server_impl->base_uri = soup_uri_to_string(uris->data, FALSE);
+  g_slist_free_full(uris, (GDestroyNotify)soup_uri_free);
+
+  server_impl->thread = g_thread_new("omvp_test_util",
+    _omvp_test_util_server_thread, server_impl);
+
+  return (OMVPTestUtilServer)server_impl;
+}
+
+gint omvp_test_util_server_close(OMVPTestUtilServer server) {
+  OMVPTestUtilServerImpl *server_impl;
+
+  server_impl = (OMVPTestUtilServerImpl *)server;
+  if (server_impl) {
+    g_main_loop_quit(server_impl->loop);
+    g_thread_join(server_impl->thread);
+    soup_server_disconnect(server_impl->server);
+    g_object_unref(server_impl->server);
+    g_main_loop_unref(server_impl->loop);
+    g_main_context_unref(server_impl->context);
+    g_free(server_impl->base_uri);
+    g_free(server_impl);
+  }
+
+  return 0;
+}
+
+/* the base uri ends with a slash and the paths start with one. */
+gchar *omvp_test_util_server_get_uri(OMVPTestUtilServer server,
+  const gchar *path) {
+  OMVPTestUtilServerImpl *server_impl;
+
+  g_assert(server);
+  server_impl = (OMVPTestUtilServerImpl *)server;
+
+  return g_strconcat(server_impl->base_uri, path + 1, NULL);
+}
+
+/*
+  Runs the main context until condition returns TRUE, or for at most
+  _OMVP_TEST_UTIL_TIMEOUT seconds. Returns the last result of condition.
+*/
+gboolean omvp_test_util_wait(OMVPTestUtilCondition condition,
+  gpointer user_data) {
+  gint64 deadline;
+  guint tick_id;
+  gboolean ok;
+
+  deadline = g_get_monotonic_time() +
+    _OMVP_TEST_UTIL_TIMEOUT * G_USEC_PER_SEC;
+  tick_id = g_timeout_add(10, _omvp_test_util_on_tick, NULL);
+  ok = condition(user_data);
+  while (!ok && g_get_monotonic_time() < deadline) {
+    g_main_context_iteration(NULL, TRUE);
+    ok = condition(user_data);
+  }
+  g_source_remove(tick_id);
+
+  return ok;
+}
+
+/* CRC-32/MPEG-2, written out again so the tests don't trust omvp_ts. */
+guint32 omvp_test_util_crc32(const guint8 *data, gsize len) {
+  guint32 crc;
+  gsize i;
+  gint j;
+
+  crc = 0xffffffff;
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32)data[i] << 24;
+    for (j = 0; j < 8; j++) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+/* a TS packet with a payload of stuffing, and the packet after it. */
+guint8 *omvp_test_util_ts_header(guint8 *packet, guint pid,
+  gboolean start, guint8 cc) {
+  memset(packet, 0xff, OMVP_TS_PACKET_SIZE);
+  packet[0] = 0x47;
+  packet[1] = (start ? 0x40 : 0x00) | (pid >> 8);
+  packet[2] = pid & 0xff;
+  packet[3] = 0x10 | (cc & 0x0f);
+
+  return packet + OMVP_TS_PACKET_SIZE;
+}
+
+/* a PSI section of a single packet, with its CRC. */
+guint8 *omvp_test_util_ts_section(guint8 *packet, guint pid, guint8 cc,
+  guint8 table_id, guint16 table_id_ext, guint8 version,
+  const guint8 *body, gsize len) {
+  guint8 *s;
+  guint32 crc;
+
+  omvp_test_util_ts_header(packet, pid, TRUE, cc);
+  packet[4] = 0x00;
+  s = packet + 5;
+  s[0] = table_id;
+  s[1] = 0xb0 | ((len + 9) >> 8);
+  s[2] = (len + 9) & 0xff;
+  s[3] = table_id_ext >> 8;
+  s[4] = table_id_ext & 0xff;
+  s[5] = 0xc1 | (version << 1);
+  s[6] = 0x00;
+  s[7] = 0x00;
+  memcpy(s + 8, body, len);
+  crc = omvp_test_util_crc32(s, len + 8);
+  s[len + 8] = crc >> 24;
+  s[len + 9] = (crc >> 16) & 0xff;
+  s[len + 10] = (crc >> 8) & 0xff;
+  s[len + 11] = crc & 0xff;
+
+  return packet + OMVP_TS_PACKET_SIZE;
+}
+
+/* a PES start, with an H.264 SPS when it is a keyframe. */
+guint8 *omvp_test_util_ts_pes(guint8 *packet, guint pid,
+  gboolean keyframe) {
+  static const guint8 pes[] = {
+    0x00, 0x00, 0x01, 0xe0, 0x00, 0x00, 0x80, 0x00, 0x00
+  };
+  guint8 *p;
+
+  omvp_test_util_ts_header(packet, pid, TRUE, 0);
+  p = packet + 4;
+  memcpy(p, pes, sizeof(pes));
+  p += sizeof(pes);
+  p[0] = 0x00;
+  p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = keyframe ? 0x67 : 0x41;
+
+  return packet + OMVP_TS_PACKET_SIZE;
+}
@@ -0,0 +1,46 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_TEST_UTIL_H_
+#define _OMVP_TEST_UTIL_H_
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+typedef void *OMVPTestUtilServer;
+typedef gboolean (*OMVPTestUtilCondition)(gpointer user_data);
+
+extern OMVPTestUtilServer omvp_test_util_server_open(
+  SoupServerCallback callback, gpointer user_data);
+extern gint omvp_test_util_server_close(OMVPTestUtilServer server);
+extern gchar *omvp_test_util_server_get_uri(OMVPTestUtilServer server,
+  const gchar *path);
+extern gboolean omvp_test_util_wait(OMVPTestUtilCondition condition,
+  gpointer user_data);
+extern guint32 omvp_test_util_crc32(const guint8 *data, gsize len);
+extern guint8 *omvp_test_util_ts_header(guint8 *packet, guint pid,
+  gboolean start, guint8 cc);
+extern guint8 *omvp_test_util_ts_section(guint8 *packet, guint pid,
+  guint8 cc, guint8 table_id, guint16 table_id_ext, guint8 version,
+  const guint8 *body, gsize len);
+extern guint8 *omvp_test_util_ts_pes(guint8 *packet, guint pid,
+  gboolean keyframe);
+
+#endif /* _OMVP_TEST_UTIL_H_ */
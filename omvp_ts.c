@@ -0,0 +1,424 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "omvp_ts.h"
+
+#define _OMVP_TS_SYNC_BYTE 0x47
+#define _OMVP_TS_NUM_PIDS 8192
+#define _OMVP_TS_PAT_PID 0x0000
+
+typedef struct _OMVPTsProgram {
+  gint program;
+  guint16 pmt_pid;
+  guint32 pmt_crc;
+  gboolean has_pmt;
+  guint8 pids[_OMVP_TS_NUM_PIDS / 8];
+  guint8 pat[OMVP_TS_PACKET_SIZE];
+} OMVPTsProgram;
+
+typedef struct _OMVPTsImpl {
+  guint32 pat_crc;
+  gboolean has_pat;
+  guint8 pmt_pids[_OMVP_TS_NUM_PIDS / 8];
+  OMVPTsProgram **programs;
+  gint num_programs;
+} OMVPTsImpl;
+
+static guint32 _omvp_ts_crc32(const guint8 *data, gsize len);
+static const guint8 *_omvp_ts_get_section(const guint8 *packet,
+  gsize *plen);
+static OMVPTsProgram *_omvp_ts_find_program(OMVPTsImpl *ts_impl,
+  gint program);
+static void _omvp_ts_build_pat(OMVPTsProgram *ts_program,
+  const guint8 *section);
+static gint _omvp_ts_parse_pat(OMVPTsImpl *ts_impl, const guint8 *section,
+  gsize len);
+static gint _omvp_ts_parse_pmt(OMVPTsImpl *ts_impl, const guint8 *section,
+  gsize len);
+
+#define _OMVP_TS_GET_PID(p) ((((p)[1] & 0x1f) << 8) | (p)[2])
+#define _OMVP_TS_HAS_PID(pids, pid) ((pids)[(pid) >> 3] & (1 << ((pid) & 7)))
+#define _OMVP_TS_SET_PID(pids, pid) ((pids)[(pid) >> 3] |= 1 << ((pid) & 7))
+
+/* CRC-32/MPEG-2, a valid section including its CRC gives 0. */
+static guint32 _omvp_ts_crc32(const guint8 *data, gsize len) {
+  guint32 crc;
+  gsize i;
+  gint j;
+
+  crc = 0xffffffff;
+  for (i = 0; i < len; i++) {
+    crc ^= (guint32)data[i] << 24;
+    for (j = 0; j < 8; j++) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+  }
+
+  return crc;
+}
+
+/*
+  Returns the PSI section starting in the packet. Only sections that fit in
+  one packet are handled, which is the case for the PAT and PMTs of usual
+  broadcasts.
+*/
+static const guint8 *_omvp_ts_get_section(const guint8 *packet,
+  gsize *plen) {
+  const guint8 *payload;
+  const guint8 *end;
+  gsize len;
+
+  if (!(packet[1] & 0x40) || !(packet[3] & 0x10)) {
+    return NULL;
+  }
+  end = packet + OMVP_TS_PACKET_SIZE;
+  payload = packet + 4;
+  if (packet[3] & 0x20) {
+    payload += 1 + payload[0];
+  }
+  if (payload >= end) {
+    return NULL;
+  }
+  payload += 1 + payload[0];
+  if (payload + 3 > end) {
+    return NULL;
+  }
+  len = 3 + (((payload[1] & 0x0f) << 8) | payload[2]);
+  if (len < 12 || payload + len > end || _omvp_ts_crc32(payload, len) != 0) {
+    return NULL;
+  }
+  *plen = len;
+
+  return payload;
+}
+
+static OMVPTsProgram *_omvp_ts_find_program(OMVPTsImpl *ts_impl,
+  gint program) {
+  gint i;
+
+  for (i = 0; i < ts_impl->num_programs; i++) {
+    if (ts_impl->programs[i]->program == program) {
+      return ts_impl->programs[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* a PAT listing only this program, so tsdemux doesn't wait for the others. */
+static void _omvp_ts_build_pat(OMVPTsProgram *ts_program,
+  const guint8 *section) {
+  guint8 *p;
+  guint8 *s;
+  guint32 crc;
+
+  p = ts_program->pat;
+  memset(p, 0xff, OMVP_TS_PACKET_SIZE);
+  p[0] = _OMVP_TS_SYNC_BYTE;
+  p[1] = 0x40;
+  p[2] = 0x00;
+  p[3] = 0x10;
+  p[4] = 0x00;
+  s = p + 5;
+  s[0] = 0x00;
+  s[1] = 0xb0;
+  s[2] = 13;
+  s[3] = section[3];
+  s[4] = section[4];
+  s[5] = section[5] | 0x01;
+  s[6] = 0x00;
+  s[7] = 0x00;
+  s[8] = ts_program->program >> 8;
+  s[9] = ts_program->program & 0xff;
+  s[10] = 0xe0 | (ts_program->pmt_pid >> 8);
+  s[11] = ts_program->pmt_pid & 0xff;
+  crc = _omvp_ts_crc32(s, 12);
+  s[12] = crc >> 24;
+  s[13] = (crc >> 16) & 0xff;
+  s[14] = (crc >> 8) & 0xff;
+  s[15] = crc & 0xff;
+}
+
+static gint _omvp_ts_parse_pat(OMVPTsImpl *ts_impl, const guint8 *section,
+  gsize len) {
+  OMVPTsProgram **programs;
+  OMVPTsProgram *ts_program;
+  gint num_programs;
+  const guint8 *p;
+  gint program;
+  guint16 pmt_pid;
+  gint i;
+
+  if (section[0] != 0x00) {
+    return -1;
+  }
+  ts_impl->pat_crc = ((guint32)section[len - 4] << 24) |
+    (section[len - 3] << 16) | (section[len - 2] << 8) | section[len - 1];
+  ts_impl->has_pat = TRUE;
+
+  programs = g_new0(OMVPTsProgram *, (len - 12) / 4);
+  num_programs = 0;
+  memset(ts_impl->pmt_pids, 0, sizeof(ts_impl->pmt_pids));
+  for (p = section + 8; p + 4 <= section + len - 4; p += 4) {
+    program = (p[0] << 8) | p[1];
+    pmt_pid = ((p[2] & 0x1f) << 8) | p[3];
+    if (program == 0) {
+      continue;
+    }
+    ts_program = _omvp_ts_find_program(ts_impl, program);
+    if (!ts_program) {
+      ts_program = g_malloc0(sizeof(OMVPTsProgram));
+      ts_program->program = program;
+    }
+    if (ts_program->pmt_pid != pmt_pid) {
+      ts_program->pmt_pid = pmt_pid;
+      ts_program->has_pmt = FALSE;
+    }
+    _omvp_ts_build_pat(ts_program, section);
+    _OMVP_TS_SET_PID(ts_impl->pmt_pids, pmt_pid);
+    programs[num_programs++] = ts_program;
+  }
+
+  /* programs that left the PAT are dropped. */
+  for (i = 0; i < ts_impl->num_programs; i++) {
+    gint j;
+    for (j = 0; j < num_programs; j++) {
+      if (programs[j] == ts_impl->programs[i]) {
+        break;
+      }
+    }
+    if (j == num_programs) {
+      g_free(ts_impl->programs[i]);
+    }
+  }
+  g_free(ts_impl->programs);
+  ts_impl->programs = programs;
+  ts_impl->num_programs = num_programs;
+
+  return 0;
+}
+
+static gint _omvp_ts_parse_pmt(OMVPTsImpl *ts_impl, const guint8 *section,
+  gsize len) {
+  OMVPTsProgram *ts_program;
+  const guint8 *p;
+  const guint8 *end;
+  guint32 crc;
+
+  if (section[0] != 0x02) {
+    return -1;
+  }
+  ts_program = _omvp_ts_find_program(ts_impl, (section[3] << 8) | section[4]);
+  if (!ts_program) {
+    return -1;
+  }
+  crc = ((guint32)section[len - 4] << 24) | (section[len - 3] << 16) |
+    (section[len - 2] << 8) | section[len - 1];
+  if (ts_program->has_pmt && ts_program->pmt_crc == crc) {
+    return 0;
+  }
+
+  memset(ts_program->pids, 0, sizeof(ts_program->pids));
+  _OMVP_TS_SET_PID(ts_program->pids, ts_program->pmt_pid);
+  _OMVP_TS_SET_PID(ts_program->pids, ((section[8] & 0x1f) << 8) | section[9]);
+  end = section + len - 4;
+  p = section + 12 + (((section[10] & 0x0f) << 8) | section[11]);
+  while (p + 5 <= end) {
+    _OMVP_TS_SET_PID(ts_program->pids, ((p[1] & 0x1f) << 8) | p[2]);
+    p += 5 + (((p[3] & 0x0f) << 8) | p[4]);
+  }
+  ts_program->pmt_crc = crc;
+  ts_program->has_pmt = TRUE;
+
+  return 0;
+}
+
+OMVPTs omvp_ts_open(void) {
+  OMVPTsImpl *ts_impl;
+
+  ts_impl = g_malloc0(sizeof(OMVPTsImpl));
+
+  return ts_impl;
+}
+
+gint omvp_ts_close(OMVPTs ts) {
+  OMVPTsImpl *ts_impl;
+  gint i;
+
+  ts_impl = (OMVPTsImpl *)ts;
+  if (ts_impl) {
+    for (i = 0; i < ts_impl->num_programs; i++) {
+      g_free(ts_impl->programs[i]);
+    }
+    g_free(ts_impl->programs);
+    g_free(ts_impl);
+  }
+
+  return 0;
+}
+
+/* keeps track of the PAT and PMTs in the packets. */
+gint omvp_ts_parse(OMVPTs ts, const guint8 *data, gsize size) {
+  OMVPTsImpl *ts_impl;
+  const guint8 *packet;
+  const guint8 *section;
+  gsize len;
+  guint pid;
+  guint32 crc;
+
+  ts_impl = (OMVPTsImpl *)ts;
+  for (packet = data; packet + OMVP_TS_PACKET_SIZE <= data + size;
+    packet += OMVP_TS_PACKET_SIZE) {
+    if (packet[0] != _OMVP_TS_SYNC_BYTE) {
+      return -1;
+    }
+    pid = _OMVP_TS_GET_PID(packet);
+    if (pid == _OMVP_TS_PAT_PID) {
+      section = _omvp_ts_get_section(packet, &len);
+      if (section) {
+        crc = ((guint32)section[len - 4] << 24) | (section[len - 3] << 16) |
+          (section[len - 2] << 8) | section[len - 1];
+        if (!ts_impl->has_pat || ts_impl->pat_crc != crc) {
+          _omvp_ts_parse_pat(ts_impl, section, len);
+        }
+      }
+    } else if (_OMVP_TS_HAS_PID(ts_impl->pmt_pids, pid)) {
+      section = _omvp_ts_get_section(packet, &len);
+      if (section) {
+        _omvp_ts_parse_pmt(ts_impl, section, len);
+      }
+    }
+  }
+
+  return 0;
+}
+
+gboolean omvp_ts_has_program(OMVPTs ts, gint program) {
+  OMVPTsProgram *ts_program;
+
+  ts_program = _omvp_ts_find_program((OMVPTsImpl *)ts, program);
+
+  return ts_program && ts_program->has_pmt;
+}
+
+/*
+  Copies the packets of the program to out, which must be as large as data.
+  The PAT is replaced by one listing only the program. Nothing is copied
+  until the PMT of the program has been seen.
+*/
+gsize omvp_ts_filter(OMVPTs ts, gint program, const guint8 *data,
+  gsize size, guint8 *out) {
+  OMVPTsProgram *ts_program;
+  const guint8 *packet;
+  guint8 *p;
+  guint pid;
+
+  ts_program = _omvp_ts_find_program((OMVPTsImpl *)ts, program);
+  if (!ts_program || !ts_program->has_pmt) {
+    return 0;
+  }
+
+  p = out;
+  for (packet = data; packet + OMVP_TS_PACKET_SIZE <= data + size;
+    packet += OMVP_TS_PACKET_SIZE) {
+    if (packet[0] != _OMVP_TS_SYNC_BYTE) {
+      break;
+    }
+    pid = _OMVP_TS_GET_PID(packet);
+    if (pid == _OMVP_TS_PAT_PID) {
+      memcpy(p, ts_program->pat, OMVP_TS_PACKET_SIZE);
+      p[3] = (p[3] & 0xf0) | (packet[3] & 0x0f);
+    } else if (_OMVP_TS_HAS_PID(ts_program->pids, pid)) {
+      memcpy(p, packet, OMVP_TS_PACKET_SIZE);
+    } else {
+      continue;
+    }
+    p += OMVP_TS_PACKET_SIZE;
+  }
+
+  return p - out;
+}
+
+/* whether the PAT seen so far lists pid as a PMT. */
+gboolean omvp_ts_is_pmt_pid(OMVPTs ts, guint pid) {
+  OMVPTsImpl *ts_impl;
+
+  ts_impl = (OMVPTsImpl *)ts;
+
+  return pid < _OMVP_TS_NUM_PIDS && _OMVP_TS_HAS_PID(ts_impl->pmt_pids, pid);
+}
+
+gboolean omvp_ts_has_pid(const guint8 *data, gsize size, guint pid) {
+  const guint8 *packet;
+
+  for (packet = data; packet + OMVP_TS_PACKET_SIZE <= data + size;
+    packet += OMVP_TS_PACKET_SIZE) {
+    if (packet[0] == _OMVP_TS_SYNC_BYTE && _OMVP_TS_GET_PID(packet) == pid) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/*
+  Whether a video PES starts in the packets with a random access indicator,
+  an MPEG-2 sequence header, an H.264 SPS or an H.265 VPS, which is where
+  a decoder can start.
+*/
+gboolean omvp_ts_has_keyframe(const guint8 *data, gsize size) {
+  const guint8 *packet;
+  gsize offset;
+  gsize i;
+
+  for (packet = data; packet + OMVP_TS_PACKET_SIZE <= data + size;
+    packet += OMVP_TS_PACKET_SIZE) {
+    if (packet[0] != _OMVP_TS_SYNC_BYTE || !(packet[1] & 0x40) ||
+      !(packet[3] & 0x10)) {
+      continue;
+    }
+    offset = 4;
+    if (packet[3] & 0x20) {
+      offset += 1 + packet[4];
+    }
+    if (offset + 9 > OMVP_TS_PACKET_SIZE || packet[offset] != 0x00 ||
+      packet[offset + 1] != 0x00 || packet[offset + 2] != 0x01 ||
+      (packet[offset + 3] & 0xf0) != 0xe0) {
+      continue;
+    }
+    if ((packet[3] & 0x20) && packet[4] > 0 && (packet[5] & 0x40)) {
+      return TRUE;
+    }
+    offset += 9 + packet[offset + 8];
+    for (i = offset; i + 4 < OMVP_TS_PACKET_SIZE; i++) {
+      if (packet[i] != 0x00 || packet[i + 1] != 0x00 ||
+        packet[i + 2] != 0x01) {
+        continue;
+      }
+      if (packet[i + 3] == 0xb3 || (packet[i + 3] & 0x9f) == 0x07 ||
+        (packet[i + 3] == 0x40 && packet[i + 4] == 0x01)) {
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
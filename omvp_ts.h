@@ -0,0 +1,40 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _OMVP_TS_H_
+#define _OMVP_TS_H_
+
+#include <glib.h>
+
+#define OMVP_TS_PACKET_SIZE 188
+
+typedef void *OMVPTs;
+
+extern OMVPTs omvp_ts_open(void);
+extern gint omvp_ts_close(OMVPTs ts);
+extern gint omvp_ts_parse(OMVPTs ts, const guint8 *data, gsize size);
+extern gboolean omvp_ts_has_program(OMVPTs ts, gint program);
+extern gsize omvp_ts_filter(OMVPTs ts, gint program, const guint8 *data,
+  gsize size, guint8 *out);
+extern gboolean omvp_ts_is_pmt_pid(OMVPTs ts, guint pid);
+extern gboolean omvp_ts_has_pid(const guint8 *data, gsize size, guint pid);
+extern gboolean omvp_ts_has_keyframe(const guint8 *data, gsize size);
+
+#endif /* _OMVP_TS_H_ */
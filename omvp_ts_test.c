@@ -0,0 +1,236 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+#include "omvp_ts.h"
+#include "omvp_test_util.h"
+
+/* two programs of one multi-program transport stream. */
+#define _OMVP_TS_TEST_PMT_PID_1 0x100
+#define _OMVP_TS_TEST_VIDEO_PID_1 0x101
+#define _OMVP_TS_TEST_AUDIO_PID_1 0x102
+#define _OMVP_TS_TEST_AUDIO_PID_1B 0x103
+#define _OMVP_TS_TEST_PMT_PID_2 0x200
+#define _OMVP_TS_TEST_VIDEO_PID_2 0x201
+#define _OMVP_TS_TEST_NULL_PID 0x1fff
+#define _OMVP_TS_TEST_MAX_PACKETS 8
+
+static guint8 *_omvp_ts_test_pat(guint8 *packet, guint8 version,
+  gboolean has_program_2);
+static guint8 *_omvp_ts_test_pmt(guint8 *packet, gint program, guint pmt_pid,
+  guint8 version, const guint *es_pids, gint num_es_pids);
+static guint _omvp_ts_test_get_pid(const guint8 *packet);
+static gsize _omvp_ts_test_filter(OMVPTs ts, gint program,
+  const guint8 *data, gsize size, guint *pids);
+static void _omvp_ts_test_filter_program(void);
+static void _omvp_ts_test_update(void);
+static void _omvp_ts_test_keyframe(void);
+
+static guint8 *_omvp_ts_test_pat(guint8 *packet, guint8 version,
+  gboolean has_program_2) {
+  guint8 body[8] = {
+    0x00, 101, 0xe0 | (_OMVP_TS_TEST_PMT_PID_1 >> 8),
+    _OMVP_TS_TEST_PMT_PID_1 & 0xff,
+    0x00, 102, 0xe0 | (_OMVP_TS_TEST_PMT_PID_2 >> 8),
+    _OMVP_TS_TEST_PMT_PID_2 & 0xff
+  };
+
+  return omvp_test_util_ts_section(packet, 0x0000, version, 0x00, 1, version,
+    body, has_program_2 ? 8 : 4);
+}
+
+/* the first elementary stream is also the PCR pid. */
+static guint8 *_omvp_ts_test_pmt(guint8 *packet, gint program, guint pmt_pid,
+  guint8 version, const guint *es_pids, gint num_es_pids) {
+  guint8 body[4 + 5 * 4];
+  guint8 *p;
+  gint i;
+
+  g_assert(num_es_pids <= 4);
+  body[0] = 0xe0 | (es_pids[0] >> 8);
+  body[1] = es_pids[0] & 0xff;
+  body[2] = 0xf0;
+  body[3] = 0x00;
+  p = body + 4;
+  for (i = 0; i < num_es_pids; i++) {
+    p[0] = i == 0 ? 0x1b : 0x0f;
+    p[1] = 0xe0 | (es_pids[i] >> 8);
+    p[2] = es_pids[i] & 0xff;
+    p[3] = 0xf0;
+    p[4] = 0x00;
+    p += 5;
+  }
+
+  return omvp_test_util_ts_section(packet, pmt_pid, version, 0x02,
+    (guint16)program, version, body, p - body);
+}
+
+static guint _omvp_ts_test_get_pid(const guint8 *packet) {
+  return ((packet[1] & 0x1f) << 8) | packet[2];
+}
+
+/* filters the packets and returns the number of packets kept, with pids. */
+static gsize _omvp_ts_test_filter(OMVPTs ts, gint program,
+  const guint8 *data, gsize size, guint *pids) {
+  guint8 out[_OMVP_TS_TEST_MAX_PACKETS * OMVP_TS_PACKET_SIZE];
+  gsize len;
+  gsize i;
+
+  g_assert_cmpuint(size, <=, sizeof(out));
+  len = omvp_ts_filter(ts, program, data, size, out);
+  g_assert_cmpuint(len % OMVP_TS_PACKET_SIZE, ==, 0);
+  for (i = 0; i < len / OMVP_TS_PACKET_SIZE; i++) {
+    pids[i] = _omvp_ts_test_get_pid(out + i * OMVP_TS_PACKET_SIZE);
+  }
+
+  return len / OMVP_TS_PACKET_SIZE;
+}
+
+/*
+  Only the packets of the program pass, and the PAT is replaced by a valid
+  one listing only the program, keeping the continuity counter.
+*/
+static void _omvp_ts_test_filter_program(void) {
+  static const guint es_pids_1[] = {
+    _OMVP_TS_TEST_VIDEO_PID_1, _OMVP_TS_TEST_AUDIO_PID_1
+  };
+  static const guint es_pids_2[] = {_OMVP_TS_TEST_VIDEO_PID_2};
+  guint8 data[_OMVP_TS_TEST_MAX_PACKETS * OMVP_TS_PACKET_SIZE];
+  guint8 out[_OMVP_TS_TEST_MAX_PACKETS * OMVP_TS_PACKET_SIZE];
+  guint pids[_OMVP_TS_TEST_MAX_PACKETS];
+  const guint8 *s;
+  OMVPTs ts;
+  guint8 *p;
+  gsize size;
+  gsize len;
+
+  p = _omvp_ts_test_pat(data, 3, TRUE);
+  p = _omvp_ts_test_pmt(p, 101, _OMVP_TS_TEST_PMT_PID_1, 0, es_pids_1, 2);
+  p = _omvp_ts_test_pmt(p, 102, _OMVP_TS_TEST_PMT_PID_2, 0, es_pids_2, 1);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_VIDEO_PID_1, FALSE);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_AUDIO_PID_1, FALSE);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_VIDEO_PID_2, FALSE);
+  p = omvp_test_util_ts_header(p, _OMVP_TS_TEST_NULL_PID, FALSE, 0);
+  size = p - data;
+
+  ts = omvp_ts_open();
+  g_assert(!omvp_ts_has_program(ts, 101));
+  g_assert_cmpuint(omvp_ts_filter(ts, 101, data, size, out), ==, 0);
+
+  omvp_ts_parse(ts, data, size);
+  g_assert(omvp_ts_has_program(ts, 101));
+  g_assert(omvp_ts_has_program(ts, 102));
+  g_assert(!omvp_ts_has_program(ts, 103));
+  g_assert(omvp_ts_is_pmt_pid(ts, _OMVP_TS_TEST_PMT_PID_1));
+  g_assert(omvp_ts_is_pmt_pid(ts, _OMVP_TS_TEST_PMT_PID_2));
+  g_assert(!omvp_ts_is_pmt_pid(ts, _OMVP_TS_TEST_VIDEO_PID_1));
+
+  g_assert_cmpuint(_omvp_ts_test_filter(ts, 101, data, size, pids), ==, 4);
+  g_assert_cmpuint(pids[0], ==, 0x0000);
+  g_assert_cmpuint(pids[1], ==, _OMVP_TS_TEST_PMT_PID_1);
+  g_assert_cmpuint(pids[2], ==, _OMVP_TS_TEST_VIDEO_PID_1);
+  g_assert_cmpuint(pids[3], ==, _OMVP_TS_TEST_AUDIO_PID_1);
+
+  g_assert_cmpuint(_omvp_ts_test_filter(ts, 102, data, size, pids), ==, 3);
+  g_assert_cmpuint(pids[0], ==, 0x0000);
+  g_assert_cmpuint(pids[1], ==, _OMVP_TS_TEST_PMT_PID_2);
+  g_assert_cmpuint(pids[2], ==, _OMVP_TS_TEST_VIDEO_PID_2);
+
+  len = omvp_ts_filter(ts, 101, data, size, out);
+  g_assert_cmpuint(len, ==, 4 * OMVP_TS_PACKET_SIZE);
+  g_assert_cmpuint(out[3] & 0x0f, ==, 3);
+  s = out + 5;
+  g_assert_cmpuint(s[0], ==, 0x00);
+  g_assert_cmpuint(((s[1] & 0x0f) << 8) | s[2], ==, 13);
+  g_assert_cmpuint((s[8] << 8) | s[9], ==, 101);
+  g_assert_cmpuint(((s[10] & 0x1f) << 8) | s[11], ==,
+    _OMVP_TS_TEST_PMT_PID_1);
+  g_assert_cmpuint(omvp_test_util_crc32(s, 16), ==, 0);
+
+  omvp_ts_close(ts);
+}
+
+/* a new PMT version moves a pid, and a program leaving the PAT is dropped. */
+static void _omvp_ts_test_update(void) {
+  static const guint es_pids_1[] = {
+    _OMVP_TS_TEST_VIDEO_PID_1, _OMVP_TS_TEST_AUDIO_PID_1
+  };
+  static const guint es_pids_1b[] = {
+    _OMVP_TS_TEST_VIDEO_PID_1, _OMVP_TS_TEST_AUDIO_PID_1B
+  };
+  static const guint es_pids_2[] = {_OMVP_TS_TEST_VIDEO_PID_2};
+  guint8 data[_OMVP_TS_TEST_MAX_PACKETS * OMVP_TS_PACKET_SIZE];
+  guint pids[_OMVP_TS_TEST_MAX_PACKETS];
+  OMVPTs ts;
+  guint8 *p;
+  gsize size;
+
+  ts = omvp_ts_open();
+  p = _omvp_ts_test_pat(data, 0, TRUE);
+  p = _omvp_ts_test_pmt(p, 101, _OMVP_TS_TEST_PMT_PID_1, 0, es_pids_1, 2);
+  p = _omvp_ts_test_pmt(p, 102, _OMVP_TS_TEST_PMT_PID_2, 0, es_pids_2, 1);
+  omvp_ts_parse(ts, data, p - data);
+
+  p = _omvp_ts_test_pmt(data, 101, _OMVP_TS_TEST_PMT_PID_1, 1, es_pids_1b,
+    2);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_AUDIO_PID_1, FALSE);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_AUDIO_PID_1B, FALSE);
+  size = p - data;
+  omvp_ts_parse(ts, data, size);
+  g_assert_cmpuint(_omvp_ts_test_filter(ts, 101, data, size, pids), ==, 2);
+  g_assert_cmpuint(pids[0], ==, _OMVP_TS_TEST_PMT_PID_1);
+  g_assert_cmpuint(pids[1], ==, _OMVP_TS_TEST_AUDIO_PID_1B);
+
+  p = _omvp_ts_test_pat(data, 1, FALSE);
+  omvp_ts_parse(ts, data, p - data);
+  g_assert(omvp_ts_has_program(ts, 101));
+  g_assert(!omvp_ts_has_program(ts, 102));
+  g_assert(!omvp_ts_is_pmt_pid(ts, _OMVP_TS_TEST_PMT_PID_2));
+  p = omvp_test_util_ts_pes(data, _OMVP_TS_TEST_VIDEO_PID_2, FALSE);
+  g_assert_cmpuint(_omvp_ts_test_filter(ts, 102, data, p - data, pids), ==,
+    0);
+
+  omvp_ts_close(ts);
+}
+
+static void _omvp_ts_test_keyframe(void) {
+  guint8 data[2 * OMVP_TS_PACKET_SIZE];
+  guint8 *p;
+
+  p = _omvp_ts_test_pat(data, 0, TRUE);
+  p = omvp_test_util_ts_pes(p, _OMVP_TS_TEST_VIDEO_PID_1, FALSE);
+  g_assert(omvp_ts_has_pid(data, p - data, 0x0000));
+  g_assert(!omvp_ts_has_pid(data, p - data, _OMVP_TS_TEST_VIDEO_PID_2));
+  g_assert(!omvp_ts_has_keyframe(data, p - data));
+
+  omvp_test_util_ts_pes(data + OMVP_TS_PACKET_SIZE, _OMVP_TS_TEST_VIDEO_PID_1,
+    TRUE);
+  g_assert(omvp_ts_has_keyframe(data, sizeof(data)));
+}
+
+int main(int argc, char *argv[]) {
+  g_test_init(&argc, &argv, NULL);
+
+  g_test_add_func("/ts/filter", _omvp_ts_test_filter_program);
+  g_test_add_func("/ts/update", _omvp_ts_test_update);
+  g_test_add_func("/ts/keyframe", _omvp_ts_test_keyframe);
+
+  return g_test_run();
+}
@@ -18,11 +18,43 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <stdio.h>
 #include <string.h>
 #include "omvp_vids.h"
 
+#define _OMVP_EXT_HDR "#EXTINF:"
+#define _OMVP_BOM "\xef\xbb\xbf"
+
+typedef struct _OMVPVidsParser {
+  GStringChunk *strings;
+  GString *scratch;
+  gint num_vids;
+  gint max_vids;
+  gchar **ids;
+  gchar **names;
+  gchar **uris;
+  gint *attr_offsets;
+  GArray *attrs;
+  guint attr_start;
+  const gchar *id;
+  gsize id_len;
+  const gchar *name;
+  gsize name_len;
+} OMVPVidsParser;
+
 static const gchar *_omvp_vids_get_filename_ext(const gchar *filename);
+static const gchar *_omvp_vids_next_line(const gchar **pstr, const gchar *end,
+  gsize *plen);
+static const gchar *_omvp_vids_intern(OMVPVidsParser *parser,
+  const gchar *str, gsize len);
+static gint _omvp_vids_add(OMVPVidsParser *parser, const gchar *uri,
+  gsize uri_len);
+static gint _omvp_vids_parse_extinf(OMVPVidsParser *parser,
+  const gchar *line, gsize len);
+static gint _omvp_vids_parse_m3u_line(OMVPVidsParser *parser,
+  const gchar *line, gsize len);
+static gint _omvp_vids_parse_csv_line(OMVPVidsParser *parser,
+  const gchar *line, gsize len);
+static OMVPVids *_omvp_vids_finish(OMVPVidsParser *parser);
 
 static const gchar *_omvp_vids_get_filename_ext(const gchar *filename) {
   const gchar *ext;
@@ -36,130 +68,336 @@ static const gchar *_omvp_vids_get_filename_ext(const gchar *filename) {
   return NULL;
 }
 
-OMVPVids *omvp_vids_open(const gchar *filename) {
+/* returns the next line without its LF or CRLF terminator. */
+static const gchar *_omvp_vids_next_line(const gchar **pstr, const gchar *end,
+  gsize *plen) {
+  const gchar *line;
+  const gchar *eol;
+
+  line = *pstr;
+  if (line >= end) {
+    return NULL;
+  }
+  eol = memchr(line, '\n', end - line);
+  if (eol) {
+    *pstr = eol + 1;
+  } else {
+    eol = end;
+    *pstr = end;
+  }
+  if (eol > line && *(eol - 1) == '\r') {
+    eol--;
+  }
+  *plen = eol - line;
 
-#define XSTR(A) STR(A)
-#define STR(A) #A
-#define _OMVP_MAX_STRLEN 1023
+  return line;
+}
 
-  FILE *fp;
-  int ret;
-  gchar id[_OMVP_MAX_STRLEN + 1];
-  gchar name[_OMVP_MAX_STRLEN + 1];
-  gchar uri[_OMVP_MAX_STRLEN + 1];
-  const gchar *ext;
-  gint num_vids;
+/* ids, attribute keys and attribute values repeat a lot, so they are shared. */
+static const gchar *_omvp_vids_intern(OMVPVidsParser *parser,
+  const gchar *str, gsize len) {
+
+  g_string_truncate(parser->scratch, 0);
+  g_string_append_len(parser->scratch, str, len);
+
+  return g_string_chunk_insert_const(parser->strings, parser->scratch->str);
+}
+
+/*
+  A "program" attribute of a multicast entry is passed to the source as a
+  uri parameter, so that entries of the same multi-program stream are told
+  apart by their uri. Other uris, like http ones, are kept as written.
+*/
+static gint _omvp_vids_add(OMVPVidsParser *parser, const gchar *uri,
+  gsize uri_len) {
+  OMVPVidsAttr *attr;
+  const gchar *program;
+  guint j;
   gint i;
-  OMVPVids *vids;
 
-  fp = fopen(filename, "r");
-  if (fp == NULL) {
-    return NULL;
+  if (parser->num_vids == parser->max_vids) {
+    parser->max_vids = parser->max_vids ? parser->max_vids * 2 : 64;
+    parser->ids = g_renew(gchar *, parser->ids, parser->max_vids);
+    parser->names = g_renew(gchar *, parser->names, parser->max_vids);
+    parser->uris = g_renew(gchar *, parser->uris, parser->max_vids);
+    parser->attr_offsets =
+      g_renew(gint, parser->attr_offsets, parser->max_vids + 1);
   }
-  ext = _omvp_vids_get_filename_ext(filename);
-  if (ext && g_ascii_strcasecmp(ext, "m3u") == 0) {
-#define _OMVP_EXT_HDR "#EXTINF:"
-    gchar *str;
-    gint ext_hdr_len;
-    num_vids = 0;
-    for (;;) {
-      str = fgets(uri, _OMVP_MAX_STRLEN + 1, fp);
-      if (!str) {
-        break;
-      }
-      if (*str != '#' && !g_ascii_isspace(*str) &&
-        strncmp("\xef\xbb\xbf", str, 3) != 0) {
-        num_vids++;
-      }
+  i = parser->num_vids++;
+  parser->ids[i] =
+    (gchar *)_omvp_vids_intern(parser, parser->id, parser->id_len);
+  parser->names[i] = g_string_chunk_insert_len(parser->strings,
+    parser->name, parser->name_len);
+  program = NULL;
+  for (j = parser->attr_start; j < parser->attrs->len; j++) {
+    attr = &g_array_index(parser->attrs, OMVPVidsAttr, j);
+    if (strcmp(attr->key, "program") == 0) {
+      program = attr->value;
     }
-    rewind(fp);
-    if (num_vids == 0) {
-      fclose(fp);
-      return NULL;
+  }
+  g_string_truncate(parser->scratch, 0);
+  g_string_append_len(parser->scratch, uri, uri_len);
+  if (program && *program && !strstr(parser->scratch->str, "program=") &&
+    (g_str_has_prefix(parser->scratch->str, "udp://") ||
+    g_str_has_prefix(parser->scratch->str, "rtp://") ||
+    g_str_has_prefix(parser->scratch->str, "ortp://"))) {
+    g_string_append_printf(parser->scratch, "%cprogram=%s",
+      strchr(parser->scratch->str, '?') ? '&' : '?', program);
+  }
+  parser->uris[i] = g_string_chunk_insert(parser->strings,
+    parser->scratch->str);
+  parser->attr_offsets[i] = parser->attr_start;
+  parser->attr_start = parser->attrs->len;
+
+  return 0;
+}
+
+/*
+  #EXTINF:<id> key="value" key=value,<name>
+  Commas inside quoted values don't end the attributes.
+*/
+static gint _omvp_vids_parse_extinf(OMVPVidsParser *parser,
+  const gchar *line, gsize len) {
+  OMVPVidsAttr attr;
+  const gchar *end;
+  const gchar *key;
+  const gchar *value;
+  const gchar *quote;
+  gsize key_len;
+  gsize value_len;
+
+  g_array_set_size(parser->attrs, parser->attr_start);
+
+  end = line + len;
+  parser->id = line;
+  while (line < end && !g_ascii_isspace(*line) && *line != ',') {
+    line++;
+  }
+  parser->id_len = line - parser->id;
+  parser->name_len = 0;
+
+  while (line < end) {
+    if (g_ascii_isspace(*line)) {
+      line++;
+      continue;
     }
-    ext_hdr_len = strlen(_OMVP_EXT_HDR);
-    vids = g_malloc(sizeof(OMVPVids));
-    vids->num_vids = num_vids;
-    vids->ids = g_malloc(sizeof(gchar *) * num_vids);
-    vids->names = g_malloc(sizeof(gchar *) * num_vids);
-    vids->uris = g_malloc(sizeof(gchar *) * num_vids);
-    id[0] = '\0';
-    name[0] = '\0';
-    for (i = 0; i < num_vids; i++) {
-      for (;;) {
-        str = fgets(uri, _OMVP_MAX_STRLEN + 1, fp);
-        if (!str) {
-          break;
-        }
-        if (*str == '#') {
-          if (strncmp(str, _OMVP_EXT_HDR, ext_hdr_len) == 0) {
-            str += ext_hdr_len;
-            ret = sscanf(str,
-              "%" XSTR(_OMVP_MAX_STRLEN) "[^,],%" XSTR(_OMVP_MAX_STRLEN)
-              "[^\n]", id, name);
-          }
-        } else if (strncmp("\xef\xbb\xbf", str, 3) == 0) {
-        } else if (!g_ascii_isspace(*str)) {
-          uri[strcspn(uri, "\r\n")] = '\0';
-          vids->ids[i] = g_strdup(id);
-          vids->names[i] = g_strdup(name);
-          vids->uris[i] = g_strdup(uri);
-          id[0] = '\0';
-          name[0] = '\0';
-          break;
-        }
-      }
+    if (*line == ',') {
+      parser->name = line + 1;
+      parser->name_len = end - parser->name;
+      break;
     }
-  } else {
-    num_vids = 0;
-    for (;;) {
-      ret = fscanf(fp,
-        "%" XSTR(_OMVP_MAX_STRLEN) "[^,],%" XSTR(_OMVP_MAX_STRLEN)
-        "[^,],%" XSTR(_OMVP_MAX_STRLEN) "s\n", id, name, uri);
-      if (ret != 3 || ret == EOF) {
-        break;
-      }
-      num_vids++;
+    key = line;
+    while (line < end && *line != '=' && *line != ',' &&
+      !g_ascii_isspace(*line)) {
+      line++;
     }
-    rewind(fp);
-    if (num_vids == 0) {
-      fclose(fp);
-      return NULL;
+    key_len = line - key;
+    if (line == end || *line != '=') {
+      continue;
     }
-    vids = g_malloc(sizeof(OMVPVids));
-    vids->num_vids = num_vids;
-    vids->ids = g_malloc(sizeof(gchar *) * num_vids);
-    vids->names = g_malloc(sizeof(gchar *) * num_vids);
-    vids->uris = g_malloc(sizeof(gchar *) * num_vids);
-    for (i = 0; i < num_vids; i++) {
-      ret = fscanf(fp,
-        "%" XSTR(_OMVP_MAX_STRLEN) "[^,],%" XSTR(_OMVP_MAX_STRLEN)
-        "[^,],%" XSTR(_OMVP_MAX_STRLEN) "s\n", id, name, uri);
-      if (ret != 3 || ret == EOF) {
-        break;
+    line++;
+    if (line < end && *line == '"') {
+      value = ++line;
+      quote = memchr(line, '"', end - line);
+      value_len = (quote ? quote : end) - value;
+      line = quote ? quote + 1 : end;
+    } else {
+      value = line;
+      while (line < end && *line != ',' && !g_ascii_isspace(*line)) {
+        line++;
       }
-      vids->ids[i] = g_strdup(id);
-      vids->names[i] = g_strdup(name);
-      vids->uris[i] = g_strdup(uri);
+      value_len = line - value;
+    }
+    if (key_len) {
+      attr.key = _omvp_vids_intern(parser, key, key_len);
+      attr.value = _omvp_vids_intern(parser, value, value_len);
+      g_array_append_val(parser->attrs, attr);
     }
   }
-  fclose(fp);
+
+  return 0;
+}
+
+/*
+  "#EXTINF:" lines give the id and name of the next uri line. Other comments
+  and lines starting with a space are skipped.
+*/
+static gint _omvp_vids_parse_m3u_line(OMVPVidsParser *parser,
+  const gchar *line, gsize len) {
+  gsize hdr_len;
+
+  if (len == 0 || g_ascii_isspace(*line)) {
+    return 0;
+  }
+  if (*line == '#') {
+    hdr_len = strlen(_OMVP_EXT_HDR);
+    if (len >= hdr_len && strncmp(line, _OMVP_EXT_HDR, hdr_len) == 0) {
+      _omvp_vids_parse_extinf(parser, line + hdr_len, len - hdr_len);
+    }
+    return 0;
+  }
+
+  _omvp_vids_add(parser, line, len);
+  parser->id_len = 0;
+  parser->name_len = 0;
+
+  return 0;
+}
+
+/* "id,name,uri" where the uri is the rest of the line. */
+static gint _omvp_vids_parse_csv_line(OMVPVidsParser *parser,
+  const gchar *line, gsize len) {
+  const gchar *end;
+  const gchar *comma;
+
+  end = line + len;
+  while (end > line && g_ascii_isspace(*(end - 1))) {
+    end--;
+  }
+  while (line < end && g_ascii_isspace(*line)) {
+    line++;
+  }
+  if (line == end) {
+    return 0;
+  }
+
+  comma = memchr(line, ',', end - line);
+  if (!comma) {
+    return -1;
+  }
+  parser->id = line;
+  parser->id_len = comma - line;
+  line = comma + 1;
+  comma = memchr(line, ',', end - line);
+  if (!comma || comma + 1 == end) {
+    return -1;
+  }
+  parser->name = line;
+  parser->name_len = comma - line;
+  line = comma + 1;
+
+  return _omvp_vids_add(parser, line, end - line);
+}
+
+/* moves the parsed arrays into a single block right after the struct. */
+static OMVPVids *_omvp_vids_finish(OMVPVidsParser *parser) {
+  OMVPVids *vids;
+  gsize vids_size;
+  gsize strs_size;
+  gsize attrs_size;
+  gsize offsets_size;
+  gint n;
+
+  n = parser->num_vids;
+  vids_size = sizeof(OMVPVids);
+  strs_size = sizeof(gchar *) * n;
+  attrs_size = sizeof(OMVPVidsAttr) * parser->attr_start;
+  offsets_size = sizeof(gint) * (n + 1);
+  vids = g_malloc(vids_size + strs_size * 3 + attrs_size + offsets_size);
+  vids->num_vids = n;
+  vids->ids = (gchar **)(vids + 1);
+  vids->names = vids->ids + n;
+  vids->uris = vids->names + n;
+  vids->attrs = (OMVPVidsAttr *)(vids->uris + n);
+  vids->attr_offsets = (gint *)(vids->attrs + parser->attr_start);
+  vids->strings = parser->strings;
+  memcpy(vids->ids, parser->ids, strs_size);
+  memcpy(vids->names, parser->names, strs_size);
+  memcpy(vids->uris, parser->uris, strs_size);
+  memcpy(vids->attrs, parser->attrs->data, attrs_size);
+  memcpy(vids->attr_offsets, parser->attr_offsets, sizeof(gint) * n);
+  vids->attr_offsets[n] = parser->attr_start;
+
   return vids;
 }
 
-gint omvp_vids_close(OMVPVids *vids) {
-  gint i, n;
+OMVPVids *omvp_vids_open(const gchar *filename) {
+  GMappedFile *file;
+  OMVPVids *vids;
+
+  file = g_mapped_file_new(filename, FALSE, NULL);
+  if (file == NULL) {
+    return NULL;
+  }
+  vids = omvp_vids_open_data(filename, g_mapped_file_get_contents(file),
+    g_mapped_file_get_length(file));
+  g_mapped_file_unref(file);
+
+  return vids;
+}
 
-  n = vids->num_vids;
-  for (i = 0; i < n; i++) {
-    g_free(vids->ids[i]);
-    g_free(vids->names[i]);
-    g_free(vids->uris[i]);
+/* the filename only tells m3u from csv. */
+OMVPVids *omvp_vids_open_data(const gchar *filename, const gchar *data,
+  gsize size) {
+  OMVPVidsParser parser;
+  OMVPVids *vids;
+  const gchar *str;
+  const gchar *end;
+  const gchar *line;
+  const gchar *ext;
+  gboolean m3u;
+  gsize len;
+
+  if (data == NULL || size == 0) {
+    return NULL;
+  }
+  str = data;
+  end = str + size;
+  if (end - str >= 3 && memcmp(str, _OMVP_BOM, 3) == 0) {
+    str += 3;
+  }
+
+  ext = _omvp_vids_get_filename_ext(filename);
+  m3u = ext && g_ascii_strcasecmp(ext, "m3u") == 0;
+
+  memset(&parser, 0, sizeof(parser));
+  parser.strings = g_string_chunk_new(MIN(end - str + 1, 1024 * 1024));
+  parser.scratch = g_string_new(NULL);
+  parser.attrs = g_array_new(FALSE, FALSE, sizeof(OMVPVidsAttr));
+  parser.id = "";
+  parser.name = "";
+  while ((line = _omvp_vids_next_line(&str, end, &len))) {
+    if (m3u) {
+      _omvp_vids_parse_m3u_line(&parser, line, len);
+    } else if (_omvp_vids_parse_csv_line(&parser, line, len) != 0) {
+      break;
+    }
+  }
+
+  vids = NULL;
+  if (parser.num_vids) {
+    g_array_set_size(parser.attrs, parser.attr_start);
+    vids = _omvp_vids_finish(&parser);
+  } else {
+    g_string_chunk_free(parser.strings);
   }
-  g_free(vids->ids);
-  g_free(vids->names);
-  g_free(vids->uris);
+  g_free(parser.ids);
+  g_free(parser.names);
+  g_free(parser.uris);
+  g_free(parser.attr_offsets);
+  g_array_free(parser.attrs, TRUE);
+  g_string_free(parser.scratch, TRUE);
+
+  return vids;
+}
+
+gint omvp_vids_close(OMVPVids *vids) {
+  g_string_chunk_free(vids->strings);
   g_free(vids);
 
   return 0;
 }
+
+const gchar *omvp_vids_get_attr(OMVPVids *vids, gint vid_idx,
+  const gchar *key) {
+  gint i;
+
+  for (i = vids->attr_offsets[vid_idx]; i < vids->attr_offsets[vid_idx + 1];
+    i++) {
+    if (strcmp(vids->attrs[i].key, key) == 0) {
+      return vids->attrs[i].value;
+    }
+  }
+
+  return NULL;
+}
@@ -23,14 +23,31 @@
 
 #include <glib.h>
 
+typedef struct _OMVPVidsAttr {
+  const gchar *key;
+  const gchar *value;
+} OMVPVidsAttr;
+
+/*
+  The arrays live in the same allocation as the struct and all strings live
+  in one string chunk, so a playlist is freed with two calls. The attributes
+  of vid i are attrs[attr_offsets[i]] up to attrs[attr_offsets[i + 1]].
+*/
 typedef struct _OMVPVids {
   gint num_vids;
   gchar **ids;
   gchar **names;
   gchar **uris;
+  OMVPVidsAttr *attrs;
+  gint *attr_offsets;
+  GStringChunk *strings;
 } OMVPVids;
 
 extern OMVPVids *omvp_vids_open(const gchar *filename);
+extern OMVPVids *omvp_vids_open_data(const gchar *filename,
+  const gchar *data, gsize size);
 extern gint omvp_vids_close(OMVPVids *vids);
+extern const gchar *omvp_vids_get_attr(OMVPVids *vids, gint vid_idx,
+  const gchar *key);
 
 #endif /* _OMVP_VIDS_H_ */
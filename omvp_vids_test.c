@@ -0,0 +1,192 @@
+/*
+  Oh! Multi Video Player
+  Copyright (C) 2016 Taeho Oh <ohhara@postech.edu>
+
+  This file is part of Oh! Multi Video Player.
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib/gstdio.h>
+#include "omvp_vids.h"
+
+#define _OMVP_VIDS_TEST_NUM_VIDS 100000
+/* longer than the 1023 characters a field was once limited to. */
+#define _OMVP_VIDS_TEST_LONG_LEN 4000
+
+static gchar *_omvp_vids_test_dir;
+
+static gchar *_omvp_vids_test_long_uri(void);
+static gchar *_omvp_vids_test_write(const gchar *basename, GString *str);
+static OMVPVids *_omvp_vids_test_open(const gchar *filename,
+  const gchar *kind);
+static void _omvp_vids_test_m3u(void);
+static void _omvp_vids_test_csv(void);
+static void _omvp_vids_test_program(void);
+
+static gchar *_omvp_vids_test_long_uri(void) {
+  GString *uri;
+
+  uri = g_string_new("http://example.com/live.m3u8?token=");
+  while (uri->len < _OMVP_VIDS_TEST_LONG_LEN) {
+    g_string_append_c(uri, 'a' + uri->len % 26);
+  }
+
+  return g_string_free(uri, FALSE);
+}
+
+static gchar *_omvp_vids_test_write(const gchar *basename, GString *str) {
+  gchar *filename;
+  gboolean ok;
+
+  filename = g_build_filename(_omvp_vids_test_dir, basename, NULL);
+  ok = g_file_set_contents(filename, str->str, str->len, NULL);
+  g_assert(ok);
+
+  return filename;
+}
+
+/* the time of omvp_vids_open is the benchmark result. */
+static OMVPVids *_omvp_vids_test_open(const gchar *filename,
+  const gchar *kind) {
+  OMVPVids *vids;
+  gdouble elapsed;
+
+  g_test_timer_start();
+  vids = omvp_vids_open(filename);
+  elapsed = g_test_timer_elapsed();
+  g_assert(vids);
+  g_test_message("omvp_vids_open: %d %s entries in %.1f ms", vids->num_vids,
+    kind, elapsed * 1000.0);
+
+  return vids;
+}
+
+/* BOM, CRLF, attributes and one long uri line. */
+static void _omvp_vids_test_m3u(void) {
+  OMVPVids *vids;
+  GString *str;
+  gchar *long_uri;
+  gchar *filename;
+  gchar *id;
+  gint i;
+
+  long_uri = _omvp_vids_test_long_uri();
+  str = g_string_new("\xef\xbb\xbf#EXTM3U\r\n");
+  for (i = 0; i < _OMVP_VIDS_TEST_NUM_VIDS; i++) {
+    g_string_append_printf(str,
+      "#EXTINF:%d tvg-id=\"ch%d\",Channel %d\r\n", i + 1, i, i);
+    if (i == _OMVP_VIDS_TEST_NUM_VIDS / 2) {
+      g_string_append_printf(str, "%s\r\n", long_uri);
+    } else {
+      g_string_append_printf(str, "udp://@239.1.%d.%d:1234\r\n",
+        i / 256 % 256, i % 256);
+    }
+  }
+  filename = _omvp_vids_test_write("bench.m3u", str);
+  g_string_free(str, TRUE);
+
+  vids = _omvp_vids_test_open(filename, "m3u");
+  g_assert_cmpint(vids->num_vids, ==, _OMVP_VIDS_TEST_NUM_VIDS);
+  g_assert_cmpstr(vids->ids[0], ==, "1");
+  g_assert_cmpstr(vids->names[0], ==, "Channel 0");
+  g_assert_cmpstr(vids->uris[0], ==, "udp://@239.1.0.0:1234");
+  g_assert_cmpstr(omvp_vids_get_attr(vids, 0, "tvg-id"), ==, "ch0");
+  g_assert_cmpstr(omvp_vids_get_attr(vids, 3, "tvg-id"), ==, "ch3");
+  g_assert_cmpstr(vids->uris[_OMVP_VIDS_TEST_NUM_VIDS / 2], ==, long_uri);
+  i = _OMVP_VIDS_TEST_NUM_VIDS - 1;
+  id = g_strdup_printf("%d", i + 1);
+  g_assert_cmpstr(vids->ids[i], ==, id);
+  g_free(id);
+  omvp_vids_close(vids);
+
+  g_unlink(filename);
+  g_free(filename);
+  g_free(long_uri);
+}
+
+/* a csv uri is the rest of the line, spaces included. */
+static void _omvp_vids_test_csv(void) {
+  OMVPVids *vids;
+  GString *str;
+  gchar *long_uri;
+  gchar *filename;
+  gint i;
+
+  long_uri = _omvp_vids_test_long_uri();
+  str = g_string_new("\xef\xbb\xbf");
+  for (i = 0; i < _OMVP_VIDS_TEST_NUM_VIDS; i++) {
+    if (i == _OMVP_VIDS_TEST_NUM_VIDS / 2) {
+      g_string_append_printf(str, "%d,Channel %d,%s\n", i + 1, i, long_uri);
+    } else {
+      g_string_append_printf(str,
+        "%d,Channel %d,http://example.com/live %d.m3u8\r\n", i + 1, i, i);
+    }
+  }
+  filename = _omvp_vids_test_write("bench.csv", str);
+  g_string_free(str, TRUE);
+
+  vids = _omvp_vids_test_open(filename, "csv");
+  g_assert_cmpint(vids->num_vids, ==, _OMVP_VIDS_TEST_NUM_VIDS);
+  g_assert_cmpstr(vids->ids[0], ==, "1");
+  g_assert_cmpstr(vids->names[0], ==, "Channel 0");
+  g_assert_cmpstr(vids->uris[0], ==, "http://example.com/live 0.m3u8");
+  g_assert_cmpstr(vids->uris[_OMVP_VIDS_TEST_NUM_VIDS / 2], ==, long_uri);
+  omvp_vids_close(vids);
+
+  g_unlink(filename);
+  g_free(filename);
+  g_free(long_uri);
+}
+
+/* only multicast uris get the program, http ones are kept as written. */
+static void _omvp_vids_test_program(void) {
+  static const gchar data[] =
+    "#EXTM3U\n"
+    "#EXTINF:1 program=\"101\",Channel 0\n"
+    "udp://@239.1.0.0:1234\n"
+    "#EXTINF:2 program=\"102\",Channel 1\n"
+    "rtp://239.1.0.1:5000?ttl=1\n"
+    "#EXTINF:3 program=\"103\",Channel 2\n"
+    "http://example.com/live.m3u8\n";
+  OMVPVids *vids;
+
+  vids = omvp_vids_open_data("program.m3u", data, sizeof(data) - 1);
+  g_assert(vids);
+  g_assert_cmpint(vids->num_vids, ==, 3);
+  g_assert_cmpstr(vids->uris[0], ==, "udp://@239.1.0.0:1234?program=101");
+  g_assert_cmpstr(vids->uris[1], ==, "rtp://239.1.0.1:5000?ttl=1&program=102");
+  g_assert_cmpstr(vids->uris[2], ==, "http://example.com/live.m3u8");
+  g_assert_cmpstr(omvp_vids_get_attr(vids, 2, "program"), ==, "103");
+  omvp_vids_close(vids);
+}
+
+int main(int argc, char *argv[]) {
+  gint ret;
+
+  g_test_init(&argc, &argv, NULL);
+
+  _omvp_vids_test_dir = g_dir_make_tmp("omvp_vids_test-XXXXXX", NULL);
+  g_assert(_omvp_vids_test_dir);
+
+  g_test_add_func("/vids/m3u", _omvp_vids_test_m3u);
+  g_test_add_func("/vids/csv", _omvp_vids_test_csv);
+  g_test_add_func("/vids/program", _omvp_vids_test_program);
+  ret = g_test_run();
+
+  g_rmdir(_omvp_vids_test_dir);
+  g_free(_omvp_vids_test_dir);
+
+  return ret;
+}